@@ -11,6 +11,7 @@
 #include "PyramidalLucasKanade.h"
 #include "PyramidalProesmans.h"
 #include "SparseImageExtrapolator.h"
+#include "TiledDenseMotionExtractor.h"
 #include "version.h"
 
 #include <boost/program_options.hpp>
@@ -18,10 +19,73 @@
 #include <cstring>
 #include <iostream>
 #include <string>
+#include <vector>
 
 using namespace boost::program_options;
 using namespace std;
 
+// Creates a dense motion extractor from the given options, or returns NULL 
+// if the algorithm is not dense.
+static PyramidalDenseMotionExtractor *createDenseMotionExtractor(const variables_map &vm)
+{
+  PyramidalDenseMotionExtractor *e;
+  
+  if(vm["algorithm"].as< string >() == "hornschunck")
+  {
+    HornSchunck::BoundaryConditions boundCond;
+    
+    int bc = 1;
+    if(vm.count("boundcond") > 0)
+      bc = vm["boundcond"].as< int >();
+    if(bc == 0)
+      boundCond = HornSchunck::DIRICHLET;
+    else
+      boundCond = HornSchunck::NEUMANN;
+    
+    e = new PyramidalHornSchunck(
+      vm.count("numiter") > 0    ? vm["numiter"].as< int >() : 500,
+      vm.count("alpha") > 0      ? vm["alpha"].as< float >() : 0.7,
+      vm.count("relaxcoeff") > 0 ? vm["relaxcoeff"].as< float >() : 1.9,
+      vm.count("numlevels") > 0  ? vm["numlevels"].as< int >() : 4,
+      boundCond);
+  }
+  else if(vm["algorithm"].as< string >() == "lucaskanade")
+  {
+    e = new PyramidalLucasKanade(
+      vm.count("windowradius") > 0 ? vm["windowradius"].as< int >() : 16,
+      vm.count("numlsqiter") > 0   ? vm["numlsqiter"].as< int >() : 5,
+      vm.count("tau") > 0          ? vm["tau"].as< float >() : 0.0025,
+      vm.count("sigmap") > 0       ? vm["sigmap"].as< float >() : 0.0,
+      vm.count("numlevels") > 0    ? vm["numlevels"].as< int >() : 4,
+      true);
+  }
+  else if(vm["algorithm"].as< string >() == "proesmans")
+  {
+    Proesmans::BoundaryConditions boundCond;
+    
+    int bc = 1;
+    if(vm.count("boundcond") > 0)
+      bc = vm["boundcond"].as< int >();
+    if(bc == 0)
+      boundCond = Proesmans::DIRICHLET;
+    else
+      boundCond = Proesmans::NEUMANN;
+    
+    e = new PyramidalProesmans(
+      vm.count("numdiffiter") > 0 ? vm["numdiffiter"].as< int >() : 200,
+      vm.count("lambda") > 0      ? vm["lambda"].as< float >() : 100.0,
+      vm.count("numlevels") > 0   ? vm["numlevels"].as< int >() : 4,
+      boundCond);
+  }
+  else
+    return NULL;
+  
+  if(vm.count("maskdilation") > 0)
+    e->setMaskDilationRadius(vm["maskdilation"].as< int >());
+  
+  return e;
+}
+
 int main(int argc, char **argv)
 {
   DenseMotionExtractor *denseMotionExtractor = NULL;
@@ -50,7 +114,14 @@ int main(int argc, char **argv)
   
   options_description optionalArgs("optional arguments");
   optionalArgs.add_options()
-    ("numlevels", value< int >(), "number of pyramid levels (default = 4)");
+    ("numlevels",        value< int >(), "number of pyramid levels (default = 4)")
+    ("mask",             value< std::string >(), "compute motion only near the nonzero pixels of the given image (dense algorithms only)")
+    ("maskdilation",     value< int >(), "mask dilation radius in pixels (default = 8)")
+    ("tilesize",         value< int >(), "process the images in tiles of the given size (dense algorithms only)")
+    ("halosize",         value< int >(), "tile overlap on each side (default = 64)")
+    ("numtilethreads",   value< int >(), "number of concurrently processed tiles (default = 1)")
+    ("pngcompression",   value< int >(), "compression level of the output images (0-9) (default = 6)")
+    ("numwriterthreads", value< int >(), "number of threads writing the output images (default = 2)");
   
   options_description hornSchunckArgs("Options for the Horn&Schunck algorithm");
   hornSchunckArgs.add_options()
@@ -82,14 +153,33 @@ int main(int argc, char **argv)
     ("numdiffiter", value< int >(),   "number of diffusion iterations (default = 200)")
     ("lambda",      value< float >(), "smoothness parameter (default = 100)")
     ("boundcond",   value< int >(),   "boundary conditions (0 = Dirichlet, 1 = Neumann) (default = 1)");
-  
-  std::string restrictions = "Restrictions:\n -the source images must be 8-bit grayscale images.";
+
+#ifdef WITH_HDF5
+  // options for ODIM HDF5 source images
+  options_description odimArgs("Options for ODIM HDF5 source images");
+  odimArgs.add_options()
+    ("odimdata",      value< std::string >(), "group containing the source dataset (default = dataset1/data1)")
+    ("minvalue",      value< double >(), "smallest nonzero value of the source datasets (default = 0.1)")
+    ("maxvalue",      value< double >(), "value mapped to the maximum intensity (default = 40)")
+    ("h5chunksize",   value< int >(),    "chunk size of the written motion fields (default = 256)")
+    ("h5compression", value< int >(),    "deflate compression level of the written motion fields (0-9) (default = 6)");
+
+#endif
+  std::string restrictions = "Restrictions:\n -the source images must be 8-bit grayscale images";
+#ifdef WITH_HDF5
+  restrictions += " or ODIM HDF5 files";
+#endif
+  restrictions += ".";
   
   options_description allArgs("");
   allArgs.add(generalArgs).add(mandatoryArgs).add(hornSchunckArgs).
           add(optionalArgs).add(lucasKanadeArgs).add(proesmansArgs).add(opencvArgs);
   options_description allVisibleArgs("Usage: extractmotion image1 image2 algorithm outprefix [algorithm-specific options]");
   allVisibleArgs.add(generalArgs).add(mandatoryArgs).add(optionalArgs);
+#ifdef WITH_HDF5
+  allArgs.add(odimArgs);
+  allVisibleArgs.add(odimArgs);
+#endif
   
   try {
     variables_map vm;
@@ -144,34 +234,46 @@ int main(int argc, char **argv)
     
     vm.notify();
     
-    if(vm["algorithm"].as< string >() == "hornschunck")
-    {
-      HornSchunck::BoundaryConditions boundCond;
-      
-      int bc = 1;
-      if(vm.count("boundcond") > 0)
-        bc = vm["boundcond"].as< int >();
-      if(bc == 0)
-        boundCond = HornSchunck::DIRICHLET;
-      else
-        boundCond = HornSchunck::NEUMANN;
-      
-      denseMotionExtractor = new PyramidalHornSchunck(
-        vm.count("numiter") > 0    ? vm["numiter"].as< int >() : 500,
-        vm.count("alpha") > 0      ? vm["alpha"].as< float >() : 0.7,
-        vm.count("relaxcoeff") > 0 ? vm["relaxcoeff"].as< float >() : 1.9,
-        vm.count("numlevels") > 0  ? vm["numlevels"].as< int >() : 4,
-        boundCond);
-    }
-    else if(vm["algorithm"].as< string >() == "lucaskanade")
+    AsyncImageWriter::Options writerOptions;
+    if(vm.count("pngcompression") > 0)
+      writerOptions.compressionLevel = vm["pngcompression"].as< int >();
+    if(vm.count("numwriterthreads") > 0)
+      writerOptions.numThreads = vm["numwriterthreads"].as< int >();
+    MotionExtractorDriver::setImageWriterOptions(writerOptions);
+
+#ifdef WITH_HDF5
+    MotionExtractorDriver::ODIMOptions odimOptions;
+    if(vm.count("odimdata") > 0)
+      odimOptions.dataPath = vm["odimdata"].as< string >();
+    if(vm.count("minvalue") > 0)
+      odimOptions.minValue = vm["minvalue"].as< double >();
+    if(vm.count("maxvalue") > 0)
+      odimOptions.maxValue = vm["maxvalue"].as< double >();
+    if(vm.count("h5chunksize") > 0)
+      odimOptions.chunkSize = vm["h5chunksize"].as< int >();
+    if(vm.count("h5compression") > 0)
+      odimOptions.compressionLevel = vm["h5compression"].as< int >();
+    MotionExtractorDriver::setODIMOptions(odimOptions);
+
+#endif
+    denseMotionExtractor = createDenseMotionExtractor(vm);
+    
+    if(denseMotionExtractor != NULL)
     {
-      denseMotionExtractor = new PyramidalLucasKanade(
-        vm.count("windowradius") > 0 ? vm["windowradius"].as< int >() : 16,
-        vm.count("numlsqiter") > 0   ? vm["numlsqiter"].as< int >() : 5,
-        vm.count("tau") > 0          ? vm["tau"].as< float >() : 0.0025,
-        vm.count("sigmap") > 0       ? vm["sigmap"].as< float >() : 0.0,
-        vm.count("numlevels") > 0    ? vm["numlevels"].as< int >() : 4,
-        true);
+      if(vm.count("tilesize") > 0)
+      {
+        // one motion extractor for each concurrently processed tile
+        vector< DenseMotionExtractor * > tileExtractors(1, denseMotionExtractor);
+        
+        int numTileThreads = vm.count("numtilethreads") > 0 ? vm["numtilethreads"].as< int >() : 1;
+        for(int i = 1; i < numTileThreads; i++)
+          tileExtractors.push_back(createDenseMotionExtractor(vm));
+        
+        denseMotionExtractor = new TiledDenseMotionExtractor(
+          tileExtractors,
+          vm["tilesize"].as< int >(),
+          vm.count("halosize") > 0 ? vm["halosize"].as< int >() : 64);
+      }
     }
 #if defined (WITH_OPENCV) && defined(WITH_CGAL)
     else if(vm["algorithm"].as< string >() == "opencv")
@@ -186,30 +288,12 @@ int main(int argc, char **argv)
         vm.count("epsilon") > 0      ? vm["epsilon"].as< float >() : 0.001);
     }
 #endif
-    else if(vm["algorithm"].as< string >() == "proesmans")
-    {
-      Proesmans::BoundaryConditions boundCond;
-      
-      int bc = 1;
-      if(vm.count("boundcond") > 0)
-        bc = vm["boundcond"].as< int >();
-      if(bc == 0)
-        boundCond = Proesmans::DIRICHLET;
-      else
-        boundCond = Proesmans::NEUMANN;
-      
-      denseMotionExtractor = new PyramidalProesmans(
-        vm.count("numdiffiter") > 0 ? vm["numdiffiter"].as< int >() : 200,
-        vm.count("lambda") > 0      ? vm["lambda"].as< float >() : 100.0,
-        vm.count("numlevels") > 0   ? vm["numlevels"].as< int >() : 4,
-        boundCond);
-    }
     else
     {
       std::cout<<"Invalid algorithm name."<<std::endl;
       return EXIT_FAILURE;
     }
-  
+    
     std::string srcImgFileName1 = vm["image1"].as< string >();
     std::string srcImgFileName2 = vm["image2"].as< string >();
     std::string outFilePrefix   = vm["outprefix"].as< string >();
@@ -217,7 +301,8 @@ int main(int argc, char **argv)
     if(denseMotionExtractor != NULL)
     {
       MotionExtractorDriver::runDenseMotionExtractor(
-        *denseMotionExtractor, srcImgFileName1, srcImgFileName2, outFilePrefix);
+        *denseMotionExtractor, srcImgFileName1, srcImgFileName2, outFilePrefix, 
+        vm.count("mask") > 0 ? vm["mask"].as< string >() : "");
       delete denseMotionExtractor;
     }
 #ifdef WITH_CGAL
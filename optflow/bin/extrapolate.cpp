@@ -3,8 +3,12 @@
  */
 
 #include "DenseVectorFieldIO.h"
+#include "EnsembleImageExtrapolator.h"
 #include "ImageExtrapolatorDriver.h"
 #include "InverseDenseImageExtrapolator.h"
+#ifdef WITH_HDF5
+#include "ODIMHDF5IO.h"
+#endif
 #include "SparseImageExtrapolator.h"
 #include "SparseVectorFieldIO.h"
 #include "version.h"
@@ -46,10 +50,41 @@ int main(int argc, char **argv)
   posArgs.add("numtimesteps", 1);
   posArgs.add("outprefix", 1);
   
-  options_description allArgs("Usage: extrapolate image motionfield numtimesteps outprefix");
-  allArgs.add(generalArgs).add(reqArgs);
+  options_description outputArgs("output options");
+  outputArgs.add_options()
+    ("pngcompression",   value< int >(), "compression level of the output images (0-9) (default = 6)")
+    ("numwriterthreads", value< int >(), "number of threads writing the output images (default = 2)")
+    ("numthreads",       value< int >(), "number of images computed in parallel (default = number of processors)");
+  
+  options_description extrapolationArgs("extrapolation options");
+  extrapolationArgs.add_options()
+    ("interpolation", value< std::string >(), "interpolation kernel for dense motion fields (bilinear, bicubic, lanczos) (default = bilinear)")
+    ("outofdomain",   value< std::string >(), "value of the pixels advected from outside the image (clamp, constant, nan = zero in the output images) (default = clamp)")
+    ("fillvalue",     value< double >(),      "value of the out-of-domain pixels with --outofdomain=constant (default = 0)");
   
+  options_description ensembleArgs("ensemble options (dense motion fields only)");
+  ensembleArgs.add_options()
+    ("nummembers",         value< int >(),    "number of ensemble members written into [outprefix]-ensemble.pgm (default = no ensemble)")
+    ("perturbationstddev", value< double >(), "standard deviation of the motion perturbations (pixels per time step) (default = 0.5)")
+    ("correlationlength",  value< double >(), "correlation length of the motion perturbations (pixels) (default = 32)")
+    ("seed",               value< unsigned int >(), "seed of the random number generator (default = 0)");
+  
+  options_description allArgs("Usage: extrapolate image motionfield numtimesteps outprefix");
+  allArgs.add(generalArgs).add(reqArgs).add(outputArgs).add(extrapolationArgs).add(ensembleArgs);
+
+#ifdef WITH_HDF5
+  options_description odimArgs("Options for ODIM HDF5 input files");
+  odimArgs.add_options()
+    ("odimdata", value< std::string >(), "group containing the source dataset (default = dataset1/data1)")
+    ("minvalue", value< double >(), "smallest nonzero value of the source dataset (default = 0.1)")
+    ("maxvalue", value< double >(), "value mapped to the maximum intensity (default = 40)");
+  allArgs.add(odimArgs);
+
+#endif
   std::string notes = "NOTE: If you use a dense motion field (.pdvm), it is assumed to be an inverse motion field (image2->image1).";
+#ifdef WITH_HDF5
+  notes += "\nThe image and the dense motion field can also be ODIM HDF5 files.";
+#endif
   
   try {
     variables_map vm;
@@ -85,20 +120,56 @@ int main(int argc, char **argv)
     int numTimeSteps                = vm["numtimesteps"].as< int >();
     std::string outPrefix           = vm["outprefix"].as< std::string >();
     
-    I0              = CImg< unsigned char >(imageFileName.c_str());
+    AsyncImageWriter::Options writerOptions;
+    if(vm.count("pngcompression") > 0)
+      writerOptions.compressionLevel = vm["pngcompression"].as< int >();
+    if(vm.count("numwriterthreads") > 0)
+      writerOptions.numThreads = vm["numwriterthreads"].as< int >();
+    ImageExtrapolatorDriver::setImageWriterOptions(writerOptions);
+    if(vm.count("numthreads") > 0)
+      ImageExtrapolatorDriver::setNumThreads(vm["numthreads"].as< int >());
+    ImageWarp::Interpolation interpolation = ImageWarp::BILINEAR;
+    if(vm.count("interpolation") > 0)
+      interpolation = ImageWarp::parseInterpolation(vm["interpolation"].as< std::string >());
+    ImageWarp::OutOfDomain outOfDomain = ImageWarp::CLAMP;
+    if(vm.count("outofdomain") > 0)
+      outOfDomain = ImageWarp::parseOutOfDomain(vm["outofdomain"].as< std::string >());
+    float fillValue = vm.count("fillvalue") > 0 ? vm["fillvalue"].as< double >() : 0.0;
+
+#ifdef WITH_HDF5
+    if(ODIMHDF5IO::isHDF5File(imageFileName))
+    {
+      ODIMHDF5IO::readImage(imageFileName, I0,
+                            vm.count("minvalue") > 0 ? vm["minvalue"].as< double >() : 0.1,
+                            vm.count("maxvalue") > 0 ? vm["maxvalue"].as< double >() : 40.0,
+                            NULL,
+                            vm.count("odimdata") > 0 ? vm["odimdata"].as< std::string >() : "dataset1/data1");
+    }
+    else
+#endif
+      I0 = CImg< unsigned char >(imageFileName.c_str());
     std::string ext = motionFieldFileName.substr(motionFieldFileName.size() - 4, 4);
     if(ext == "pdvm")
     {
       Vd = new CImg< double >();
       DenseVectorFieldIO::readVectorField(motionFieldFileName, *Vd);
-      denseExtrapolator = new InverseDenseImageExtrapolator();
+      denseExtrapolator = new InverseDenseImageExtrapolator(interpolation, outOfDomain, fillValue);
+    }
+#ifdef WITH_HDF5
+    else if(ODIMHDF5IO::isHDF5File(motionFieldFileName))
+    {
+      Vd = new CImg< double >();
+      ODIMHDF5IO::readVectorField(motionFieldFileName, *Vd);
+      denseExtrapolator = new InverseDenseImageExtrapolator(interpolation, outOfDomain, fillValue);
     }
+#endif
 #if defined (WITH_OPENCV) && defined(WITH_CGAL)
     else if(ext == "psvm")
     {
       Vs = new SparseVectorField();
       SparseVectorFieldIO::readVectorField(motionFieldFileName, *Vs);
-      Vs->triangulate();
+      if(!Vs->isTriangulated())
+        Vs->triangulate();
       sparseExtrapolator = new SparseImageExtrapolator();
     }
 #endif
@@ -107,13 +178,34 @@ int main(int argc, char **argv)
       std::cout<<"Unknown motion field file extension."<<std::endl;
       return EXIT_FAILURE;
     }
-    
+
+    if(vm.count("nummembers") > 0)
+    {
+      if(denseExtrapolator == NULL)
+      {
+        std::cout<<"Ensemble extrapolation requires a dense motion field."<<std::endl;
+        return EXIT_FAILURE;
+      }
+      
+      EnsembleImageExtrapolator::Options ensembleOptions;
+      ensembleOptions.numMembers   = vm["nummembers"].as< int >();
+      ensembleOptions.numLeadTimes = numTimeSteps;
+      if(vm.count("perturbationstddev") > 0)
+        ensembleOptions.perturbationStdDev = vm["perturbationstddev"].as< double >();
+      if(vm.count("correlationlength") > 0)
+        ensembleOptions.correlationLength = vm["correlationlength"].as< double >();
+      if(vm.count("seed") > 0)
+        ensembleOptions.seed = vm["seed"].as< unsigned int >();
+      
+      EnsembleImageExtrapolator ensemble(*denseExtrapolator, ensembleOptions);
+      ensemble.extrapolate(I0, *Vd, outPrefix + "-ensemble.pgm");
+    }
 #ifdef WITH_CGAL
-    if(sparseExtrapolator != NULL)
+    else if(sparseExtrapolator != NULL)
       ImageExtrapolatorDriver::runSparseImageExtrapolator(
         *sparseExtrapolator, I0, *Vs, numTimeSteps, outPrefix);
-    else
 #endif
+    else
       ImageExtrapolatorDriver::runDenseImageExtrapolator(
         *denseExtrapolator, I0, *Vd, numTimeSteps, outPrefix);
   }
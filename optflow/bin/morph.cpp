@@ -55,6 +55,10 @@ int main(int argc, char **argv)
     ("algorithm", value< std::string >()->required(), "motion extraction algorithm to use (opencv, proesmans)")
     ("outprefix", value< std::string >()->required(), "output file prefix");
   
+  options_description morphingArgs("morphing options");
+  morphingArgs.add_options()
+    ("interpolation", value< std::string >(), "interpolation kernel for dense motion fields (bilinear, bicubic, lanczos) (default = bilinear)");
+  
   positional_options_description posArgs;
   posArgs.add("image1", 1);
   posArgs.add("image2", 1);
@@ -63,7 +67,7 @@ int main(int argc, char **argv)
   posArgs.add("outprefix", 1);
   
   options_description allArgs("Usage: morph image1 image2 numtimesteps algorithm outprefix");
-  allArgs.add(generalArgs).add(mandatoryArgs);
+  allArgs.add(generalArgs).add(mandatoryArgs).add(morphingArgs);
   
   try {
     variables_map vm;
@@ -96,6 +100,9 @@ int main(int argc, char **argv)
     int numTimeSteps           = vm["numtimesteps"].as< int >();
     std::string algorithmName  = vm["algorithm"].as< std::string >();
     std::string outFilePrefix  = vm["outprefix"].as< std::string >();
+    ImageWarp::Interpolation interpolation = ImageWarp::BILINEAR;
+    if(vm.count("interpolation") > 0)
+      interpolation = ImageWarp::parseInterpolation(vm["interpolation"].as< std::string >());
     
     CImg< unsigned char > I1(image1FileName.c_str());
     CImg< unsigned char > I2(image2FileName.c_str());
@@ -158,15 +165,17 @@ int main(int argc, char **argv)
       VectorFieldIllustrator::renderDenseVectorField(V2, motionImage2, 15);
       saveMotionImages(motionImage1, motionImage2, outFilePrefix);
     
-      double dt = 1.0 / (numTimeSteps - 1);
-      int i = 1;
-      for(double t = 0; t <= 1.0; t += dt)
+      // The first and last images are the source images, and the 
+      // intermediate images are computed at once.
+      saveMorphImage(I1, 1, outFilePrefix);
+      if(numTimeSteps > 2)
       {
-        DenseImageMorpher::morph(I1, I2, V2, V1, t, M);
-        saveMorphImage(M, i, outFilePrefix);
-      
-        i++;
+        DenseImageMorpher::interpolate(I1, I2, V2, V1, numTimeSteps - 2, M, interpolation);
+        for(int i = 0; i < numTimeSteps - 2; i++)
+          saveMorphImage(M.get_slice(i), i + 2, outFilePrefix);
       }
+      if(numTimeSteps > 1)
+        saveMorphImage(I2, numTimeSteps, outFilePrefix);
     }
     else
     {
@@ -0,0 +1,200 @@
+
+#include "ActiveRegion.h"
+
+#include "CImg_config.h"
+#include <CImg.h>
+
+#include <algorithm>
+
+ActiveRegion::ActiveRegion() : width_(0), height_(0) { }
+
+ActiveRegion::ActiveRegion(int width, int height)
+{
+  assign(width, height);
+}
+
+ActiveRegion::ActiveRegion(const CImg< unsigned char > &mask, int dilationRadius)
+{
+  assign(mask, dilationRadius);
+}
+
+void ActiveRegion::assign(int width, int height)
+{
+  width_  = width;
+  height_ = height;
+  
+  spans_.resize(height_);
+  for(int y = 0; y < height_; y++)
+    spans_[y].assign(width_ > 0 ? 1 : 0, make_pair(0, width_));
+}
+
+void ActiveRegion::assign(const CImg< unsigned char > &mask, int dilationRadius)
+{
+  int x, y, yi;
+  const int R = dilationRadius;
+  
+  width_  = mask.width();
+  height_ = mask.height();
+  
+  // Extract the spans of the nonzero pixels, extended by R in the x-direction.
+  vector< vector< pair< int, int > > > rowSpans(height_);
+  for(y = 0; y < height_; y++)
+  {
+    x = 0;
+    while(x < width_)
+    {
+      if(mask(x, y) != 0)
+      {
+        int x0 = x;
+        while(x < width_ && mask(x, y) != 0)
+          x++;
+        rowSpans[y].push_back(make_pair(max(x0 - R, 0), min(x + R, width_)));
+      }
+      else
+        x++;
+    }
+    mergeSpans_(rowSpans[y]);
+  }
+  
+  // Dilate in the y-direction by taking the union of the neighbouring rows.
+  spans_.assign(height_, vector< pair< int, int > >());
+  for(y = 0; y < height_; y++)
+  {
+    for(yi = max(y - R, 0); yi <= min(y + R, height_ - 1); yi++)
+      spans_[y].insert(spans_[y].end(), rowSpans[yi].begin(), rowSpans[yi].end());
+    mergeSpans_(spans_[y]);
+  }
+}
+
+void ActiveRegion::downsample(ActiveRegion &dest) const
+{
+  dest.width_  = width_ / 2;
+  dest.height_ = height_ / 2;
+  dest.spans_.assign(dest.height_, vector< pair< int, int > >());
+  
+  for(int y = 0; y < dest.height_; y++)
+  {
+    vector< pair< int, int > > &spans = dest.spans_[y];
+    
+    for(int yi = 2*y; yi <= 2*y + 1; yi++)
+    {
+      for(unsigned int i = 0; i < spans_[yi].size(); i++)
+      {
+        int x0 = spans_[yi][i].first / 2;
+        int x1 = min((spans_[yi][i].second + 1) / 2, dest.width_);
+        if(x0 < x1)
+          spans.push_back(make_pair(x0, x1));
+      }
+    }
+    mergeSpans_(spans);
+  }
+}
+
+void ActiveRegion::fillInactive(CImg< double > &V) const
+{
+  const int C = V.spectrum();
+  int c, i, x, y;
+  
+  if(isEmpty())
+  {
+    V.fill(0.0);
+    return;
+  }
+  
+  // Propagate along the rows. Gaps between spans are filled from the 
+  // nearest span end.
+  for(y = 0; y < height_; y++)
+  {
+    const vector< pair< int, int > > &spans = spans_[y];
+    if(spans.empty())
+      continue;
+    
+    for(i = 0; i <= (int)spans.size(); i++)
+    {
+      const int X0 = i > 0 ? spans[i-1].second : 0;
+      const int X1 = i < (int)spans.size() ? spans[i].first : width_;
+      
+      for(x = X0; x < X1; x++)
+      {
+        int xs;
+        if(i == 0)
+          xs = X1;
+        else if(i == (int)spans.size())
+          xs = X0 - 1;
+        else
+          xs = x - X0 < X1 - x ? X0 - 1 : X1;
+        
+        for(c = 0; c < C; c++)
+          V(x, y, 0, c) = c < 2 ? V(xs, y, 0, c) : 0.0;
+      }
+    }
+  }
+  
+  // Copy the rows without active pixels from the nearest active row.
+  int prevActiveRow = -1;
+  for(y = 0; y < height_; y++)
+  {
+    if(!spans_[y].empty())
+    {
+      prevActiveRow = y;
+      continue;
+    }
+    
+    int nextActiveRow = y + 1;
+    while(nextActiveRow < height_ && spans_[nextActiveRow].empty())
+      nextActiveRow++;
+    
+    int ys;
+    if(prevActiveRow < 0)
+      ys = nextActiveRow;
+    else if(nextActiveRow >= height_)
+      ys = prevActiveRow;
+    else
+      ys = y - prevActiveRow <= nextActiveRow - y ? prevActiveRow : nextActiveRow;
+    
+    for(x = 0; x < width_; x++)
+      for(c = 0; c < C; c++)
+        V(x, y, 0, c) = c < 2 ? V(x, ys, 0, c) : 0.0;
+  }
+}
+
+double ActiveRegion::getActiveFraction() const
+{
+  long numActive = 0;
+  
+  if(width_ == 0 || height_ == 0)
+    return 0.0;
+  
+  for(int y = 0; y < height_; y++)
+    for(unsigned int i = 0; i < spans_[y].size(); i++)
+      numActive += spans_[y][i].second - spans_[y][i].first;
+  
+  return 1.0 * numActive / (1.0 * width_ * height_);
+}
+
+bool ActiveRegion::isEmpty() const
+{
+  for(int y = 0; y < height_; y++)
+    if(!spans_[y].empty())
+      return false;
+  
+  return true;
+}
+
+void ActiveRegion::mergeSpans_(vector< pair< int, int > > &spans)
+{
+  if(spans.size() < 2)
+    return;
+  
+  sort(spans.begin(), spans.end());
+  
+  unsigned int n = 0;
+  for(unsigned int i = 1; i < spans.size(); i++)
+  {
+    if(spans[i].first <= spans[n].second)
+      spans[n].second = max(spans[n].second, spans[i].second);
+    else
+      spans[++n] = spans[i];
+  }
+  spans.resize(n + 1);
+}
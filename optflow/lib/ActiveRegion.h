@@ -0,0 +1,81 @@
+
+#ifndef ACTIVEREGION_H
+
+#include <utility>
+#include <vector>
+
+namespace cimg_library { template < class T > class CImg; }
+
+using namespace cimg_library;
+using namespace std;
+
+/// Defines the region of an image where motion is computed.
+/**
+ * The region is stored as a list of active spans for each row. A span is a 
+ * half-open interval [first,second) of x-coordinates. The region is 
+ * constructed from a mask, where nonzero pixels are active, and it is dilated 
+ * so that the motion at the edges of the mask is also computed. The motion 
+ * extractors only iterate over the active spans, and the motion vectors 
+ * outside the region are filled from the nearest active pixels.
+ */
+class ActiveRegion
+{
+public:
+  /// Constructs an empty region.
+  ActiveRegion();
+  
+  /// Constructs a region that covers a whole image of the given size.
+  ActiveRegion(int width, int height);
+  
+  /// Constructs a region from the nonzero pixels of a mask.
+  /**
+   * @param mask the mask image, nonzero pixels are active
+   * @param dilationRadius the radius of the square dilation applied to the mask
+   */
+  ActiveRegion(const CImg< unsigned char > &mask, int dilationRadius);
+  
+  /// Reconstructs this region to cover a whole image of the given size.
+  void assign(int width, int height);
+  
+  /// Reconstructs this region from the nonzero pixels of a mask.
+  void assign(const CImg< unsigned char > &mask, int dilationRadius);
+  
+  /// Computes the region for the next (coarser) pyramid level.
+  /**
+   * A pixel of the coarser level is active if any of the four pixels it 
+   * covers is active. The dimensions of the coarser level are halved 
+   * (rounded down).
+   */
+  void downsample(ActiveRegion &dest) const;
+  
+  /// Fills the motion vectors outside the region from the nearest active pixels.
+  /**
+   * The vectors are propagated along each row from the nearest span end, and 
+   * rows without active pixels are copied from the nearest active row. The 
+   * quality channels (2,...) of the inactive pixels are set to zero. If 
+   * the region is empty, V is filled with zeros.
+   */
+  void fillInactive(CImg< double > &V) const;
+  
+  /// Returns the fraction of active pixels.
+  double getActiveFraction() const;
+  
+  int getHeight() const { return height_; }
+  
+  /// Returns the active spans [first,second) of the given row.
+  const vector< pair< int, int > > &getRowSpans(int y) const { return spans_[y]; }
+  
+  int getWidth() const { return width_; }
+  
+  /// Returns true if the region contains no active pixels.
+  bool isEmpty() const;
+private:
+  int width_, height_;
+  vector< vector< pair< int, int > > > spans_;
+  
+  static void mergeSpans_(vector< pair< int, int > > &spans);
+};
+
+#define ACTIVEREGION_H
+
+#endif
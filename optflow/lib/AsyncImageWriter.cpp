@@ -0,0 +1,266 @@
+
+#include "AsyncImageWriter.h"
+
+#include "CImg_config.h"
+#include <CImg.h>
+#include <stdexcept>
+#include <stdio.h>
+#ifdef WITH_PNG
+#include <png.h>
+#endif
+
+AsyncImageWriter::Options::Options() : numThreads(2),
+                                       queueSize(4),
+                                       compressionLevel(6)
+{ }
+
+AsyncImageWriter::AsyncImageWriter(const Options &options) : 
+  options_(options), numPending_(0), stopping_(false)
+{
+  if(options.numThreads < 0)
+    throw invalid_argument("The number of threads must be nonnegative.");
+  if(options.queueSize < 1)
+    throw invalid_argument("The queue size must be positive.");
+  if(options.compressionLevel < 0 || options.compressionLevel > 9)
+    throw invalid_argument("The compression level must be between 0 and 9.");
+
+#ifdef HAVE_PTHREADS
+  pthread_mutex_init(&mutex_, NULL);
+  pthread_cond_init(&notEmptyCond_, NULL);
+  pthread_cond_init(&notFullCond_, NULL);
+  pthread_cond_init(&doneCond_, NULL);
+  
+  for(int i = 0; i < options.numThreads; i++)
+  {
+    pthread_t thread;
+    if(pthread_create(&thread, NULL, run_, this) != 0)
+    {
+      // Fall back to the threads created so far (or to synchronous writing).
+      break;
+    }
+    threads_.push_back(thread);
+  }
+#endif
+}
+
+AsyncImageWriter::~AsyncImageWriter()
+{
+  join_();
+#ifdef HAVE_PTHREADS
+  pthread_cond_destroy(&doneCond_);
+  pthread_cond_destroy(&notFullCond_);
+  pthread_cond_destroy(&notEmptyCond_);
+  pthread_mutex_destroy(&mutex_);
+#endif
+}
+
+void AsyncImageWriter::close()
+{
+  join_();
+#ifdef HAVE_PTHREADS
+  const string ERROR_MESSAGE = takeError_();
+  if(!ERROR_MESSAGE.empty())
+    throw runtime_error(ERROR_MESSAGE);
+#endif
+}
+
+void AsyncImageWriter::flush()
+{
+#ifdef HAVE_PTHREADS
+  pthread_mutex_lock(&mutex_);
+  while(numPending_ > 0)
+    pthread_cond_wait(&doneCond_, &mutex_);
+  pthread_mutex_unlock(&mutex_);
+  
+  const string ERROR_MESSAGE = takeError_();
+  if(!ERROR_MESSAGE.empty())
+    throw runtime_error(ERROR_MESSAGE);
+#endif
+}
+
+void AsyncImageWriter::write(const CImg< unsigned char > &I, const string &fileName)
+{
+#ifdef HAVE_PTHREADS
+  if(!threads_.empty())
+  {
+    Job_ job;
+    job.image = new CImg< unsigned char >(I);
+    job.fileName = fileName;
+    
+    pthread_mutex_lock(&mutex_);
+    while((int)queue_.size() >= options_.queueSize && error_.empty())
+      pthread_cond_wait(&notFullCond_, &mutex_);
+    
+    if(!error_.empty())
+    {
+      const string ERROR_MESSAGE = error_;
+      error_ = "";
+      pthread_mutex_unlock(&mutex_);
+      delete job.image;
+      throw runtime_error(ERROR_MESSAGE);
+    }
+    
+    queue_.push_back(job);
+    numPending_++;
+    pthread_cond_signal(&notEmptyCond_);
+    pthread_mutex_unlock(&mutex_);
+    
+    return;
+  }
+#endif
+  writePNG(I, fileName, options_.compressionLevel);
+}
+
+void AsyncImageWriter::writePNG(const CImg< unsigned char > &I,
+                                const string &fileName,
+                                int compressionLevel)
+{
+#ifdef WITH_PNG
+  const int W = I.width();
+  const int H = I.height();
+  const int C = I.spectrum();
+  int colorType;
+  
+  switch(C)
+  {
+    case 1:  colorType = PNG_COLOR_TYPE_GRAY;       break;
+    case 2:  colorType = PNG_COLOR_TYPE_GRAY_ALPHA; break;
+    case 3:  colorType = PNG_COLOR_TYPE_RGB;        break;
+    case 4:  colorType = PNG_COLOR_TYPE_RGB_ALPHA;  break;
+    default: throw invalid_argument("Only images with 1-4 channels can be written as PNG.");
+  }
+  if(W < 1 || H < 1)
+    throw invalid_argument("Cannot write an empty image.");
+  
+  // The row buffer is allocated before setjmp so that it is released 
+  // normally if libpng signals an error.
+  vector< png_byte > row((size_t)W * C);
+  
+  FILE *fp = fopen(fileName.c_str(), "wb");
+  if(fp == NULL)
+    throw runtime_error("Error creating file " + fileName);
+  
+  png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+  png_infop info = png != NULL ? png_create_info_struct(png) : NULL;
+  if(info == NULL)
+  {
+    png_destroy_write_struct(&png, NULL);
+    fclose(fp);
+    throw runtime_error("Error initializing libpng.");
+  }
+  
+  if(setjmp(png_jmpbuf(png)))
+  {
+    png_destroy_write_struct(&png, &info);
+    fclose(fp);
+    throw runtime_error("Error writing PNG file " + fileName);
+  }
+  
+  png_init_io(png, fp);
+  png_set_compression_level(png, compressionLevel);
+  png_set_IHDR(png, info, W, H, 8, colorType, PNG_INTERLACE_NONE,
+               PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+  png_write_info(png, info);
+  
+  // Interleave the planar channels of each row.
+  for(int y = 0; y < H; y++)
+  {
+    for(int c = 0; c < C; c++)
+    {
+      const unsigned char *src = I.data(0, y, 0, c);
+      for(int x = 0; x < W; x++)
+        row[x * C + c] = src[x];
+    }
+    png_write_row(png, &row[0]);
+  }
+  
+  png_write_end(png, NULL);
+  png_destroy_write_struct(&png, &info);
+  
+  if(fclose(fp) != 0)
+    throw runtime_error("Error writing PNG file " + fileName);
+#else
+  I.save_png(fileName.c_str());
+#endif
+}
+
+void AsyncImageWriter::join_()
+{
+#ifdef HAVE_PTHREADS
+  if(threads_.empty())
+    return;
+  
+  pthread_mutex_lock(&mutex_);
+  stopping_ = true;
+  pthread_cond_broadcast(&notEmptyCond_);
+  pthread_mutex_unlock(&mutex_);
+  
+  // The workers empty the queue before exiting.
+  for(size_t i = 0; i < threads_.size(); i++)
+    pthread_join(threads_[i], NULL);
+  threads_.clear();
+#endif
+}
+
+#ifdef HAVE_PTHREADS
+void *AsyncImageWriter::run_(void *writer)
+{
+  AsyncImageWriter *w = (AsyncImageWriter *)writer;
+  Job_ job;
+  
+  while(true)
+  {
+    pthread_mutex_lock(&w->mutex_);
+    while(w->queue_.empty() && !w->stopping_)
+      pthread_cond_wait(&w->notEmptyCond_, &w->mutex_);
+    if(w->queue_.empty())
+    {
+      pthread_mutex_unlock(&w->mutex_);
+      break;
+    }
+    job = w->queue_.front();
+    w->queue_.pop_front();
+    pthread_cond_signal(&w->notFullCond_);
+    pthread_mutex_unlock(&w->mutex_);
+    
+    string error;
+    try
+    {
+      writePNG(*job.image, job.fileName, w->options_.compressionLevel);
+    }
+    catch(exception &e)
+    {
+      error = e.what();
+    }
+    catch(...)
+    {
+      error = "Error writing " + job.fileName;
+    }
+    delete job.image;
+    
+    pthread_mutex_lock(&w->mutex_);
+    // Only the first error is reported.
+    if(!error.empty() && w->error_.empty())
+    {
+      w->error_ = error;
+      pthread_cond_broadcast(&w->notFullCond_);
+    }
+    w->numPending_--;
+    if(w->numPending_ == 0)
+      pthread_cond_broadcast(&w->doneCond_);
+    pthread_mutex_unlock(&w->mutex_);
+  }
+  
+  return NULL;
+}
+
+string AsyncImageWriter::takeError_()
+{
+  pthread_mutex_lock(&mutex_);
+  const string ERROR_MESSAGE = error_;
+  error_ = "";
+  pthread_mutex_unlock(&mutex_);
+  
+  return ERROR_MESSAGE;
+}
+#endif
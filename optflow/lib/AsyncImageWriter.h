@@ -0,0 +1,118 @@
+
+#ifndef ASYNCIMAGEWRITER_H
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
+namespace cimg_library { template < class T > class CImg; }
+
+using namespace cimg_library;
+using namespace std;
+
+/// Writes PNG images asynchronously in worker threads.
+/**
+ * The images passed to write() are copied into a bounded queue, from 
+ * which a pool of worker threads encodes and writes them to disk. This 
+ * allows computing the next image while the previous ones are being 
+ * compressed. When the queue is full, write() blocks until a worker has 
+ * taken an image from it, which limits the memory used for pending images.
+ *
+ * Errors occurring in the worker threads are reported by flush() and 
+ * close(). The destructor waits for the pending images to be written but 
+ * does not report errors, so close() should be called before the writer 
+ * goes out of scope.
+ *
+ * If compiled with libpng (WITH_PNG), the images are encoded with the 
+ * given compression level. Otherwise they are written with 
+ * CImg::save_png and the compression level is ignored. On platforms 
+ * without POSIX threads, the images are written synchronously.
+ */
+class AsyncImageWriter
+{
+public:
+  /// Options of the writer.
+  struct Options
+  {
+    /// Initializes the default options.
+    Options();
+    
+    /// The number of worker threads (default 2), 0=write synchronously.
+    int numThreads;
+    /// The maximum number of pending images in the queue (default 4).
+    int queueSize;
+    /// The zlib compression level of the PNG images (0-9) (default 6).
+    int compressionLevel;
+  };
+  
+  /// Constructs a writer and starts its worker threads.
+  /**
+   * Throws invalid_argument if the options are invalid.
+   */
+  AsyncImageWriter(const Options &options = Options());
+  
+  /// Waits for the pending images to be written and stops the worker threads.
+  ~AsyncImageWriter();
+  
+  /// Stops accepting asynchronous writes and waits for the worker threads to finish.
+  /**
+   * Throws runtime_error if writing some of the pending images failed. 
+   * Images passed to write() after calling this method are written 
+   * synchronously.
+   */
+  void close();
+  
+  /// Waits until all images passed to write() have been written.
+  /**
+   * Throws runtime_error if writing some of them failed.
+   */
+  void flush();
+  
+  /// Queues the given image to be written into the given PNG file.
+  /**
+   * The image is copied, so it can be modified immediately after this 
+   * method returns. Blocks while the queue is full. Throws runtime_error 
+   * if writing some previously queued image has failed.
+   */
+  void write(const CImg< unsigned char > &I, const string &fileName);
+  
+  /// Writes the given image (1-4 channels) into a PNG file.
+  static void writePNG(const CImg< unsigned char > &I,
+                       const string &fileName,
+                       int compressionLevel = 6);
+private:
+  AsyncImageWriter(const AsyncImageWriter &);
+  AsyncImageWriter &operator=(const AsyncImageWriter &);
+  
+  struct Job_
+  {
+    CImg< unsigned char > *image;
+    string fileName;
+  };
+  
+  void join_();
+#ifdef HAVE_PTHREADS
+  static void *run_(void *writer);
+  string takeError_();
+  
+  pthread_mutex_t mutex_;
+  pthread_cond_t notEmptyCond_;
+  pthread_cond_t notFullCond_;
+  pthread_cond_t doneCond_;
+  vector< pthread_t > threads_;
+#endif
+  Options options_;
+  deque< Job_ > queue_;
+  int numPending_;
+  bool stopping_;
+  string error_;
+};
+
+#define ASYNCIMAGEWRITER_H
+
+#endif
@@ -1,11 +1,17 @@
 
 #ifndef DENSEIMAGEEXTRAPOLATOR_H
 
+#include <stdexcept>
+
 namespace cimg_library { template < class T > class CImg; }
 
 using namespace cimg_library;
 
 /// Abstract base class for warping images with dense motion fields.
+/**
+ * All extrapolators support 8-bit images. Support for 16-bit and 
+ * floating-point images (e.g. physical rain rates) is optional.
+ */
 class DenseImageExtrapolator
 {
 public:
@@ -20,6 +26,24 @@ public:
                            const CImg< double > &V,
                            double multiplier,
                            CImg< unsigned char > &Ie) const = 0;
+  
+  /// Warps the given 16-bit image by using a dense motion vector field.
+  virtual void extrapolate(const CImg< unsigned short > &I0,
+                           const CImg< double > &V,
+                           double multiplier,
+                           CImg< unsigned short > &Ie) const
+  {
+    throw std::runtime_error("Image extrapolator does not support 16-bit images.");
+  }
+  
+  /// Warps the given floating-point image by using a dense motion vector field.
+  virtual void extrapolate(const CImg< float > &I0,
+                           const CImg< double > &V,
+                           double multiplier,
+                           CImg< float > &Ie) const
+  {
+    throw std::runtime_error("Image extrapolator does not support floating-point images.");
+  }
 };
 
 #define DENSEIMAGEEXTRAPOLATOR_H
@@ -1,10 +1,208 @@
 
 #include "DenseImageMorpher.h"
-#include "InverseDenseImageExtrapolator.h"
+#include "WarpSampling.h"
 
 #include "CImg_config.h"
 #include <CImg.h>
+#include <algorithm>
 #include <stdexcept>
+#include <string.h>
+
+using namespace std;
+
+static void checkArguments_(int W, int H, int C,
+                            const CImg< double > &V1,
+                            const CImg< double > &V2,
+                            int W2, int H2, int C2)
+{
+  if (W2 != W || H2 != H || C2 != C ||
+      V1.width() != W || V1.height() != H || V1.spectrum() < 2 ||
+      V2.width() != W || V2.height() != H || V2.spectrum() < 2)
+    throw invalid_argument("The images and the motion fields must have the same dimensions.");
+}
+
+// Computes row y of the intermediate image at time t by bilinear 
+// interpolation. dest points to the first pixel of the row in channel 0, 
+// and channelSize is the distance between the channels.
+template < class T >
+static void morphRow_(const CImg< T > &I1,
+                      const CImg< T > &I2,
+                      const CImg< double > &V1,
+                      const CImg< double > &V2,
+                      int y,
+                      double t,
+                      bool fill,
+                      T fillValue,
+                      T *dest,
+                      size_t channelSize)
+{
+  const int W = I1.width();
+  const int H = I1.height();
+  const int C = I1.spectrum();
+  // The neighbours coincide in images having only one column or row.
+  const int STEP_X = W > 1 ? 1 : 0;
+  const int STEP_Y = H > 1 ? W : 0;
+  const float T1 = (float)(1.0 - t);
+  const float T2 = (float)t;
+  const double *u1 = V1.data(0, y, 0, 0);
+  const double *v1 = V1.data(0, y, 0, 1);
+  const double *u2 = V2.data(0, y, 0, 0);
+  const double *v2 = V2.data(0, y, 0, 1);
+
+  for (int x = 0; x < W; x++)
+  {
+    const double X1 = x + t * u1[x];
+    const double Y1 = y + t * v1[x];
+    const double X2 = x + (1.0 - t) * u2[x];
+    const double Y2 = y + (1.0 - t) * v2[x];
+
+    if (fill && (!WarpSampling::isInside(X1, Y1, W, H) || !WarpSampling::isInside(X2, Y2, W, H)))
+    {
+      for (int c = 0; c < C; c++)
+        dest[c * channelSize + x] = fillValue;
+      continue;
+    }
+
+    for (int c = 0; c < C; c++)
+    {
+      const float A = WarpSampling::sampleBilinear(I1.data(0, 0, 0, c), W, H, STEP_X, STEP_Y, X1, Y1);
+      const float B = WarpSampling::sampleBilinear(I2.data(0, 0, 0, c), W, H, STEP_X, STEP_Y, X2, Y2);
+
+      dest[c * channelSize + x] = WarpSampling::toPixel< T >(T1 * A + T2 * B);
+    }
+  }
+}
+
+// Computes the intermediate image at time t with a higher-order kernel. 
+// The images are warped separately, and the blending is done in a single 
+// pass.
+template < class T >
+static void morphWarped_(const CImg< T > &I1,
+                         const CImg< T > &I2,
+                         const CImg< double > &V1,
+                         const CImg< double > &V2,
+                         double t,
+                         ImageWarp::Interpolation interpolation,
+                         bool fill,
+                         T fillValue,
+                         CImg< T > &M)
+{
+  const int W = I1.width();
+  const int H = I1.height();
+  const int C = I1.spectrum();
+  const size_t N = (size_t)W * H;
+  const float T1 = (float)(1.0 - t);
+  const float T2 = (float)t;
+  ImageWarp w1(V1, t, interpolation), w2(V2, 1.0 - t, interpolation);
+  CImg< T > I1e, I2e;
+  CImg< unsigned char > M1, M2;
+
+  w1.apply(I1, I1e);
+  w2.apply(I2, I2e);
+  if (fill)
+  {
+    w1.getValidityMask(M1);
+    w2.getValidityMask(M2);
+  }
+
+  M.assign(W, H, 1, C);
+#pragma omp parallel for schedule(static)
+  for (int c = 0; c < C; c++)
+  {
+    const T *a = I1e.data(0, 0, 0, c);
+    const T *b = I2e.data(0, 0, 0, c);
+    T *dest = M.data(0, 0, 0, c);
+
+    for (size_t i = 0; i < N; i++)
+    {
+      if (fill && (!M1[i] || !M2[i]))
+        dest[i] = fillValue;
+      else
+        dest[i] = WarpSampling::toPixel< T >(T1 * a[i] + T2 * b[i]);
+    }
+  }
+}
+
+template < class T >
+static void morph_(const CImg< T > &I1,
+                   const CImg< T > &I2,
+                   const CImg< double > &V1,
+                   const CImg< double > &V2,
+                   double t,
+                   CImg< T > &M,
+                   ImageWarp::Interpolation interpolation)
+{
+  const int W = I1.width();
+  const int H = I1.height();
+  const int C = I1.spectrum();
+
+  if (t < 0.0 || t > 1.0)
+    throw invalid_argument("interpolation parameter t must be between 0 and 1");
+  checkArguments_(W, H, C, V1, V2, I2.width(), I2.height(), I2.spectrum());
+
+  if (interpolation != ImageWarp::BILINEAR)
+  {
+    morphWarped_(I1, I2, V1, V2, t, interpolation, false, T(0), M);
+    return;
+  }
+
+  M.assign(W, H, 1, C);
+
+#pragma omp parallel for schedule(static)
+  for (int y = 0; y < H; y++)
+    morphRow_(I1, I2, V1, V2, y, t, false, T(0), M.data(0, y), (size_t)W * H);
+}
+
+template < class T >
+static void interpolate_(const CImg< T > &I1,
+                         const CImg< T > &I2,
+                         const CImg< double > &V1,
+                         const CImg< double > &V2,
+                         int numFrames,
+                         CImg< T > &M,
+                         ImageWarp::Interpolation interpolation,
+                         ImageWarp::OutOfDomain outOfDomain,
+                         float fillValue)
+{
+  const int W = I1.width();
+  const int H = I1.height();
+  const int C = I1.spectrum();
+  const bool FILL = outOfDomain != ImageWarp::CLAMP;
+  const T FILL_VALUE = WarpSampling::getFillValue< T >(outOfDomain, fillValue);
+
+  if (numFrames < 1)
+    throw invalid_argument("The number of frames must be positive.");
+  checkArguments_(W, H, C, V1, V2, I2.width(), I2.height(), I2.spectrum());
+
+  // Reuse the output stack if it has the correct size.
+  if (M.width() != W || M.height() != H || M.depth() != numFrames || M.spectrum() != C)
+    M.assign(W, H, numFrames, C);
+
+  if (interpolation != ImageWarp::BILINEAR)
+  {
+    CImg< T > F;
+
+    for (int k = 0; k < numFrames; k++)
+    {
+      morphWarped_(I1, I2, V1, V2, (k + 1.0) / (numFrames + 1), interpolation,
+                   FILL, FILL_VALUE, F);
+      for (int c = 0; c < C; c++)
+        memcpy(M.data(0, 0, k, c), F.data(0, 0, 0, c), (size_t)W * H * sizeof(T));
+    }
+
+    return;
+  }
+
+  // All frames of a row are computed by the same thread, so the rows of the 
+  // motion fields and the source images are reused from the cache.
+#pragma omp parallel for schedule(static)
+  for (int y = 0; y < H; y++)
+  {
+    for (int k = 0; k < numFrames; k++)
+      morphRow_(I1, I2, V1, V2, y, (k + 1.0) / (numFrames + 1), FILL, FILL_VALUE,
+                M.data(0, y, k), (size_t)W * H * numFrames);
+  }
+}
 
 namespace DenseImageMorpher
 {
@@ -13,17 +211,70 @@ namespace DenseImageMorpher
              const CImg< double > &V1,
              const CImg< double > &V2,
              double t,
-             CImg< unsigned char > &M)
+             CImg< unsigned char > &M,
+             ImageWarp::Interpolation interpolation)
   {
-    if (t < 0.0 || t > 1.0)
-      throw std::invalid_argument("interpolation parameter t must be between 0 and 1");
+    morph_(I1, I2, V1, V2, t, M, interpolation);
+  }
 
-    CImg< unsigned char > I1e, I2e;
-    InverseDenseImageExtrapolator e1, e2;
+  void morph(const CImg< unsigned short > &I1,
+             const CImg< unsigned short > &I2,
+             const CImg< double > &V1,
+             const CImg< double > &V2,
+             double t,
+             CImg< unsigned short > &M,
+             ImageWarp::Interpolation interpolation)
+  {
+    morph_(I1, I2, V1, V2, t, M, interpolation);
+  }
+
+  void morph(const CImg< float > &I1,
+             const CImg< float > &I2,
+             const CImg< double > &V1,
+             const CImg< double > &V2,
+             double t,
+             CImg< float > &M,
+             ImageWarp::Interpolation interpolation)
+  {
+    morph_(I1, I2, V1, V2, t, M, interpolation);
+  }
 
-    e1.extrapolate(I1, V1, t, I1e);
-    e2.extrapolate(I2, V2, 1.0 - t, I2e);
+  void interpolate(const CImg< unsigned char > &I1,
+                   const CImg< unsigned char > &I2,
+                   const CImg< double > &V1,
+                   const CImg< double > &V2,
+                   int numFrames,
+                   CImg< unsigned char > &M,
+                   ImageWarp::Interpolation interpolation,
+                   ImageWarp::OutOfDomain outOfDomain,
+                   float fillValue)
+  {
+    interpolate_(I1, I2, V1, V2, numFrames, M, interpolation, outOfDomain, fillValue);
+  }
 
-    M = (1.0 - t) * I1e + t * I2e;
+  void interpolate(const CImg< unsigned short > &I1,
+                   const CImg< unsigned short > &I2,
+                   const CImg< double > &V1,
+                   const CImg< double > &V2,
+                   int numFrames,
+                   CImg< unsigned short > &M,
+                   ImageWarp::Interpolation interpolation,
+                   ImageWarp::OutOfDomain outOfDomain,
+                   float fillValue)
+  {
+    interpolate_(I1, I2, V1, V2, numFrames, M, interpolation, outOfDomain, fillValue);
+  }
+
+  void interpolate(const CImg< float > &I1,
+                   const CImg< float > &I2,
+                   const CImg< double > &V1,
+                   const CImg< double > &V2,
+                   int numFrames,
+                   CImg< float > &M,
+                   ImageWarp::Interpolation interpolation,
+                   ImageWarp::OutOfDomain outOfDomain,
+                   float fillValue)
+  {
+    interpolate_(I1, I2, V1, V2, numFrames, M, interpolation, outOfDomain, fillValue);
   }
-}
\ No newline at end of file
+}
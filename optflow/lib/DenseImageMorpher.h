@@ -1,6 +1,8 @@
 
 #ifndef DENSEIMAGEMORPHER_H
 
+#include "ImageWarp.h"
+
 namespace cimg_library { template < class T > class CImg; }
 
 using namespace cimg_library;
@@ -11,6 +13,14 @@ using namespace cimg_library;
  * image between two images. Before cross-fading, the algorithm warps the 
  * first and second images by using the forward and inverse motion fields, 
  * respectively. This algorithm uses dense motion vector fields.
+ *
+ * With bilinear interpolation, both images are sampled and blended in 
+ * a single pass without intermediate images, and the rows are processed 
+ * in parallel. The values are rounded only once, after blending.
+ *
+ * The interpolate functions compute a sequence of equally spaced 
+ * intermediate images into a single stack. Each thread computes all frames 
+ * of a row, so the motion vectors are read once for all frames.
  */
 namespace DenseImageMorpher
 {
@@ -20,15 +30,88 @@ namespace DenseImageMorpher
    * @param[in] I2 the second source image
    * @param[in] V1 the forward motion field (I1->I2)
    * @param[in] V2 the inverse motion field (I2->I1)
+   * Throws invalid_argument if t is not between 0 and 1 or if the 
+   * dimensions of the images and the motion fields do not match.
    * @param[in] t interpolation coefficient (0<=t<=1)
    * @param[out] M the resulting image
+   * @param[in] interpolation the kernel used for warping the images
    */
   void morph(const CImg< unsigned char > &I1,
              const CImg< unsigned char > &I2,
              const CImg< double > &V1,
              const CImg< double > &V2,
              double t,
-             CImg< unsigned char > &M);
+             CImg< unsigned char > &M,
+             ImageWarp::Interpolation interpolation = ImageWarp::BILINEAR);
+
+  /// Computes the intermediate image between two 16-bit images.
+  void morph(const CImg< unsigned short > &I1,
+             const CImg< unsigned short > &I2,
+             const CImg< double > &V1,
+             const CImg< double > &V2,
+             double t,
+             CImg< unsigned short > &M,
+             ImageWarp::Interpolation interpolation = ImageWarp::BILINEAR);
+
+  /// Computes the intermediate image between two floating-point images.
+  void morph(const CImg< float > &I1,
+             const CImg< float > &I2,
+             const CImg< double > &V1,
+             const CImg< double > &V2,
+             double t,
+             CImg< float > &M,
+             ImageWarp::Interpolation interpolation = ImageWarp::BILINEAR);
+  
+  /// Computes the given number of intermediate images between two images.
+  /**
+   * The frame k (0<=k<numFrames) of the stack is the intermediate image at 
+   * t=(k+1)/(numFrames+1), so the source images are not included. The 
+   * output stack is reused if it already has the correct dimensions. 
+   * Throws invalid_argument if numFrames is not positive or if the 
+   * dimensions of the images and the motion fields do not match.
+   * @param[in] I1 the first source image
+   * @param[in] I2 the second source image
+   * @param[in] V1 the forward motion field (I1->I2)
+   * @param[in] V2 the inverse motion field (I2->I1)
+   * @param[in] numFrames the number of intermediate images
+   * @param[out] M the intermediate images (width x height x numFrames)
+   * @param[in] interpolation the kernel used for warping the images
+   * @param[in] outOfDomain the treatment of pixels whose source location in 
+   * either image is outside the image
+   * @param[in] fillValue the value of the out-of-domain pixels for 
+   * ImageWarp::FILL_CONSTANT
+   */
+  void interpolate(const CImg< unsigned char > &I1,
+                   const CImg< unsigned char > &I2,
+                   const CImg< double > &V1,
+                   const CImg< double > &V2,
+                   int numFrames,
+                   CImg< unsigned char > &M,
+                   ImageWarp::Interpolation interpolation = ImageWarp::BILINEAR,
+                   ImageWarp::OutOfDomain outOfDomain = ImageWarp::CLAMP,
+                   float fillValue = 0.0f);
+  
+  /// Computes the given number of intermediate images between two 16-bit images.
+  void interpolate(const CImg< unsigned short > &I1,
+                   const CImg< unsigned short > &I2,
+                   const CImg< double > &V1,
+                   const CImg< double > &V2,
+                   int numFrames,
+                   CImg< unsigned short > &M,
+                   ImageWarp::Interpolation interpolation = ImageWarp::BILINEAR,
+                   ImageWarp::OutOfDomain outOfDomain = ImageWarp::CLAMP,
+                   float fillValue = 0.0f);
+  
+  /// Computes the given number of intermediate images between two floating-point images.
+  void interpolate(const CImg< float > &I1,
+                   const CImg< float > &I2,
+                   const CImg< double > &V1,
+                   const CImg< double > &V2,
+                   int numFrames,
+                   CImg< float > &M,
+                   ImageWarp::Interpolation interpolation = ImageWarp::BILINEAR,
+                   ImageWarp::OutOfDomain outOfDomain = ImageWarp::CLAMP,
+                   float fillValue = 0.0f);
 }
 
 #define DENSEIMAGEMORPHER_H
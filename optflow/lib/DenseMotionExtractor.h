@@ -1,9 +1,13 @@
 
 #ifndef DENSEMOTIONEXTRACTOR_H
 
+#include <cstddef>
 #include <stdexcept>
 
 namespace cimg_library { template < class T > class CImg; }
+class ActiveRegion;
+class FloatImagePyramid;
+class IntensityTransform;
 
 using namespace cimg_library;
 
@@ -46,6 +50,105 @@ class DenseMotionExtractor
     throw std::runtime_error("Motion extractor does not support computing dual motion fields.");
   }
   
+  /// Extracts motion between two source images within a masked region.
+  /**
+   * Extracts motion only near the nonzero pixels of a mask (e.g. areas 
+   * with precipitation). The motion vectors outside the (dilated) mask are 
+   * filled from the nearest computed vectors and their quality channels are 
+   * set to zero.
+   * @param[in] I1 the first source image
+   * @param[in] I2 the second source image
+   * @param[in] mask the mask image, nonzero pixels are active
+   * @param[out] V the computed motion vector field
+   */
+  virtual void compute(const CImg< unsigned char > &I1,
+                       const CImg< unsigned char > &I2,
+                       const CImg< unsigned char > &mask,
+                       CImg< double > &V)
+  {
+    throw std::runtime_error("Motion extractor does not support masks.");
+  }
+  
+  /// Extracts forward and backward motion within a masked region.
+  /**
+   * @param[in] I1 the first source image
+   * @param[in] I2 the second source image
+   * @param[in] mask the mask image, nonzero pixels are active
+   * @param[out] VF the computed forward motion vector field
+   * @param[out] VB the computed backward motion vector field
+   */
+  virtual void compute(const CImg< unsigned char > &I1,
+                       const CImg< unsigned char > &I2,
+                       const CImg< unsigned char > &mask,
+                       CImg< double > &VF,
+                       CImg< double > &VB)
+  {
+    throw std::runtime_error("Motion extractor does not support masks.");
+  }
+  
+  /// Extracts motion between two floating-point source images.
+  /**
+   * The pixel values (e.g. rain rates) are mapped to intensities by the 
+   * given transform when the image pyramids are constructed, so the images 
+   * need not be converted to 8-bit images first.
+   * @param[in] I1 the first source image
+   * @param[in] I2 the second source image
+   * @param[in] transform the transform mapping the pixel values to intensities
+   * @param[out] VF the computed forward motion vector field
+   * @param[out] VB the computed backward motion vector field (used only by 
+   * dual motion extractors)
+   * @param[in] mask the mask image (optional), motion is computed only near 
+   * its nonzero pixels
+   */
+  virtual void compute(const CImg< float > &I1,
+                       const CImg< float > &I2,
+                       const IntensityTransform &transform,
+                       CImg< double > &VF,
+                       CImg< double > &VB,
+                       const CImg< unsigned char > *mask = NULL)
+  {
+    throw std::runtime_error("Motion extractor does not support floating-point images.");
+  }
+  
+  /// Extracts motion between two 16-bit source images.
+  /**
+   * See the floating-point version of this method.
+   */
+  virtual void compute(const CImg< unsigned short > &I1,
+                       const CImg< unsigned short > &I2,
+                       const IntensityTransform &transform,
+                       CImg< double > &VF,
+                       CImg< double > &VB,
+                       const CImg< unsigned char > *mask = NULL)
+  {
+    throw std::runtime_error("Motion extractor does not support 16-bit images.");
+  }
+  
+  /// Extracts motion between the given levels of two image pyramids.
+  /**
+   * Single-resolution motion extractors implement this method for use with 
+   * pyramidal motion extractors. The images and their gradients are taken 
+   * from the pyramids that cache the gradients, so they are computed only 
+   * once per level.
+   * @param[in] P1 the pyramid of the first source image
+   * @param[in] P2 the pyramid of the second source image
+   * @param[in] level the pyramid level
+   * @param[in,out] VF the forward motion vector field (initial guess on input)
+   * @param[in,out] VB the backward motion vector field (used only by dual 
+   * motion extractors)
+   * @param[in] activeRegion the region where motion is computed, or NULL 
+   * for the whole image
+   */
+  virtual void computeLevel(const FloatImagePyramid &P1,
+                            const FloatImagePyramid &P2,
+                            int level,
+                            CImg< double > &VF,
+                            CImg< double > &VB,
+                            const ActiveRegion *activeRegion)
+  {
+    throw std::runtime_error("Motion extractor does not support image pyramids.");
+  }
+  
   /// Returns the number of channels in the resulting motion vector field.
   /**
    * The number of channels is 2+number of quality channels (x,y,q1,...).
@@ -60,6 +163,12 @@ class DenseMotionExtractor
   
   /// Prints information about the motion extractor and its parameters.
   virtual void printInfoText() const = 0;
+  
+  /// Sets whether the information text and progress are printed.
+  /**
+   * Motion extractors that print nothing ignore this.
+   */
+  virtual void setVerbose(bool verbose) { }
 };
 
 #define DENSEMOTIONEXTRACTOR_H
@@ -0,0 +1,481 @@
+
+#include "DenseVectorFieldArchive.h"
+#include "DenseVectorFieldIO.h"
+#include "MappedDenseVectorField.h"
+
+#include "CImg_config.h"
+#include <CImg.h>
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define HAVE_MMAP
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char MAGIC[] = "PDVA0001";
+static const size_t HEADER_SIZE = 32;
+static const size_t RECORD_HEADER_SIZE = 32;
+
+// byte offsets of the header fields
+static const size_t COMMITTED_SIZE_OFFSET = 8;
+static const size_t NUM_FRAMES_OFFSET = 16;
+
+// Fields of the archive header.
+struct ArchiveHeader
+{
+  unsigned long long committedSize;
+  unsigned long long numFrames;
+  long long lastTimestamp;
+};
+
+static void decodeHeader_(const char *src, ArchiveHeader &header)
+{
+  if(memcmp(src, MAGIC, 8) != 0)
+    throw runtime_error("Bad magic number");
+  
+  memcpy(&header.committedSize, src + COMMITTED_SIZE_OFFSET, 8);
+  memcpy(&header.numFrames, src + NUM_FRAMES_OFFSET, 8);
+  memcpy(&header.lastTimestamp, src + 24, 8);
+  
+  if(header.committedSize < HEADER_SIZE)
+    throw runtime_error("Invalid archive header.");
+}
+
+static void encodeHeader_(const ArchiveHeader &header, char *dest)
+{
+  memcpy(dest, MAGIC, 8);
+  memcpy(dest + COMMITTED_SIZE_OFFSET, &header.committedSize, 8);
+  memcpy(dest + NUM_FRAMES_OFFSET, &header.numFrames, 8);
+  memcpy(dest + 24, &header.lastTimestamp, 8);
+}
+
+// Builds the record of a frame (everything but the frame data).
+static void encodeRecordHeader_(long long timestamp,
+                                const string &parameters,
+                                size_t frameSize,
+                                vector< char > &record)
+{
+  const unsigned long long PARAMETERS_SIZE = parameters.size();
+  const unsigned long long FRAME_SIZE = frameSize;
+  const unsigned long long RECORD_SIZE = RECORD_HEADER_SIZE + PARAMETERS_SIZE + FRAME_SIZE;
+  
+  record.resize(RECORD_HEADER_SIZE + PARAMETERS_SIZE);
+  memcpy(&record[0], &RECORD_SIZE, 8);
+  memcpy(&record[8], &timestamp, 8);
+  memcpy(&record[16], &PARAMETERS_SIZE, 8);
+  memcpy(&record[24], &FRAME_SIZE, 8);
+  if(PARAMETERS_SIZE > 0)
+    memcpy(&record[RECORD_HEADER_SIZE], parameters.data(), PARAMETERS_SIZE);
+}
+
+#ifdef HAVE_MMAP
+// Writes the given bytes at the given file offset, retrying partial writes.
+static void writeFully_(int fd, const char *src, size_t size, off_t offset)
+{
+  while(size > 0)
+  {
+    ssize_t n = pwrite(fd, src, size, offset);
+    if(n < 0)
+    {
+      if(errno == EINTR)
+        continue;
+      throw runtime_error("Error writing file");
+    }
+    
+    src += n;
+    size -= n;
+    offset += n;
+  }
+}
+
+static void readFully_(int fd, char *dest, size_t size, off_t offset)
+{
+  while(size > 0)
+  {
+    ssize_t n = pread(fd, dest, size, offset);
+    if(n < 0 && errno == EINTR)
+      continue;
+    if(n <= 0)
+      throw runtime_error("Truncated archive file.");
+    
+    dest += n;
+    size -= n;
+    offset += n;
+  }
+}
+
+static void syncFile_(int fd)
+{
+#ifdef __APPLE__
+  fsync(fd);
+#else
+  fdatasync(fd);
+#endif
+}
+#endif
+
+// Releases a mapping returned by map_.
+static void unmapData_(const char *data, size_t size)
+{
+#ifdef HAVE_MMAP
+  if(data != NULL)
+    munmap((void *)data, size);
+#endif
+}
+
+DenseVectorFieldArchive::DenseVectorFieldArchive(const string &fileName) : 
+  fileName_(fileName), data_(NULL), dataSize_(0)
+{
+  const size_t COMMITTED_SIZE = readCommittedSize_();
+  
+  data_ = map_(COMMITTED_SIZE, buffer_);
+  dataSize_ = COMMITTED_SIZE;
+  
+  try
+  {
+    indexFrames_(data_, dataSize_, HEADER_SIZE, frames_);
+  }
+  catch(...)
+  {
+    unmap_();
+    throw;
+  }
+}
+
+DenseVectorFieldArchive::~DenseVectorFieldArchive()
+{
+  unmap_();
+}
+
+void DenseVectorFieldArchive::appendFrame(const string &fileName,
+                                          long long timestamp,
+                                          const string &parameters,
+                                          const char *frame,
+                                          size_t frameSize)
+{
+  char headerBytes[HEADER_SIZE];
+  ArchiveHeader header;
+  vector< char > record;
+  
+  encodeRecordHeader_(timestamp, parameters, frameSize, record);
+  
+#ifdef HAVE_MMAP
+  int fd = open(fileName.c_str(), O_RDWR | O_CREAT, 0644);
+  if(fd < 0)
+    throw runtime_error("Error creating file");
+  
+  try
+  {
+    // Serialize concurrent appends. The lock is released when the file is 
+    // closed.
+    if(flock(fd, LOCK_EX) != 0)
+      throw runtime_error("Could not lock the archive file.");
+    
+    struct stat st;
+    if(fstat(fd, &st) != 0)
+      throw runtime_error("Error reading file");
+    
+    if((size_t)st.st_size < HEADER_SIZE)
+    {
+      // A new archive. The empty header is written before any record so 
+      // that readers never see a file without a valid header.
+      header.committedSize = HEADER_SIZE;
+      header.numFrames = 0;
+      header.lastTimestamp = 0;
+      encodeHeader_(header, headerBytes);
+      writeFully_(fd, headerBytes, HEADER_SIZE, 0);
+      syncFile_(fd);
+    }
+    else
+    {
+      readFully_(fd, headerBytes, HEADER_SIZE, 0);
+      decodeHeader_(headerBytes, header);
+    }
+    
+    if(header.numFrames > 0 && timestamp < header.lastTimestamp)
+      throw runtime_error("The timestamps of the archived frames must be nondecreasing.");
+    
+    // Write the record past the committed size, overwriting any incomplete 
+    // record left by an interrupted append.
+    const off_t OFFSET = header.committedSize;
+    writeFully_(fd, &record[0], record.size(), OFFSET);
+    writeFully_(fd, frame, frameSize, OFFSET + record.size());
+    if(ftruncate(fd, OFFSET + record.size() + frameSize) != 0)
+      throw runtime_error("Error writing file");
+    syncFile_(fd);
+    
+    // Commit the record. The committed size is updated last with a single 
+    // aligned write, so readers see either the old or the new archive.
+    header.committedSize += record.size() + frameSize;
+    header.numFrames++;
+    header.lastTimestamp = timestamp;
+    encodeHeader_(header, headerBytes);
+    
+    writeFully_(fd, headerBytes + NUM_FRAMES_OFFSET, HEADER_SIZE - NUM_FRAMES_OFFSET,
+                NUM_FRAMES_OFFSET);
+    writeFully_(fd, headerBytes + COMMITTED_SIZE_OFFSET, 8, COMMITTED_SIZE_OFFSET);
+    syncFile_(fd);
+  }
+  catch(...)
+  {
+    close(fd);
+    throw;
+  }
+  
+  close(fd);
+#else
+  fstream stream(fileName.c_str(), ios::binary | ios::in | ios::out);
+  if(!stream)
+  {
+    stream.clear();
+    stream.open(fileName.c_str(), ios::binary | ios::in | ios::out | ios::trunc);
+    if(!stream)
+      throw runtime_error("Error creating file");
+  }
+  
+  stream.seekg(0, ios::end);
+  if((size_t)stream.tellg() < HEADER_SIZE)
+  {
+    // A new archive. The empty header is written before any record.
+    header.committedSize = HEADER_SIZE;
+    header.numFrames = 0;
+    header.lastTimestamp = 0;
+    encodeHeader_(header, headerBytes);
+    stream.seekp(0, ios::beg);
+    stream.write(headerBytes, HEADER_SIZE);
+    stream.flush();
+  }
+  else
+  {
+    stream.seekg(0, ios::beg);
+    stream.read(headerBytes, HEADER_SIZE);
+    decodeHeader_(headerBytes, header);
+  }
+  
+  if(header.numFrames > 0 && timestamp < header.lastTimestamp)
+    throw runtime_error("The timestamps of the archived frames must be nondecreasing.");
+  
+  stream.seekp(header.committedSize, ios::beg);
+  stream.write(&record[0], record.size());
+  stream.write(frame, frameSize);
+  stream.flush();
+  
+  header.committedSize += record.size() + frameSize;
+  header.numFrames++;
+  header.lastTimestamp = timestamp;
+  encodeHeader_(header, headerBytes);
+  
+  stream.seekp(0, ios::beg);
+  stream.write(headerBytes, HEADER_SIZE);
+  stream.close();
+  if(!stream)
+    throw runtime_error("Error writing file");
+#endif
+}
+
+int DenseVectorFieldArchive::findFrame(long long timestamp) const
+{
+  const int I = findLatestFrame(timestamp);
+  
+  if(I >= 0 && frames_[I].timestamp == timestamp)
+    return I;
+  else
+    return -1;
+}
+
+// Compares a timestamp to the timestamp of a frame.
+struct FrameTimestampLess
+{
+  template < class F >
+  bool operator()(long long timestamp, const F &frame) const
+  {
+    return timestamp < frame.timestamp;
+  }
+};
+
+int DenseVectorFieldArchive::findLatestFrame(long long timestamp) const
+{
+  // The frames are ordered by timestamp.
+  vector< Frame >::const_iterator it = 
+    upper_bound(frames_.begin(), frames_.end(), timestamp, FrameTimestampLess());
+  
+  return (int)(it - frames_.begin()) - 1;
+}
+
+const char *DenseVectorFieldArchive::getFrame(int i, size_t &size) const
+{
+  size = frames_[i].frameSize;
+  return data_ + frames_[i].frameOffset;
+}
+
+string DenseVectorFieldArchive::getParameters(int i) const
+{
+  return string(data_ + frames_[i].parametersOffset, frames_[i].parametersSize);
+}
+
+void DenseVectorFieldArchive::readFrame(int i, CImg< double > &V) const
+{
+  size_t size;
+  const char *frame = getFrame(i, size);
+  
+  MappedDenseVectorField M(frame, size);
+  DenseVectorFieldIO::readVectorField(M, V);
+}
+
+bool DenseVectorFieldArchive::refresh()
+{
+  const size_t COMMITTED_SIZE = readCommittedSize_();
+  if(COMMITTED_SIZE <= dataSize_)
+    return false;
+  
+  // Map and index the new frames into temporaries so that this archive is 
+  // left unchanged if mapping or indexing fails.
+  vector< char > buffer;
+  vector< Frame > frames;
+  const char *data = map_(COMMITTED_SIZE, buffer);
+  
+  try
+  {
+    indexFrames_(data, COMMITTED_SIZE, dataSize_, frames);
+    frames_.reserve(frames_.size() + frames.size());
+  }
+  catch(...)
+  {
+    unmapData_(data, COMMITTED_SIZE);
+    throw;
+  }
+  
+  unmap_();
+  data_ = data;
+  dataSize_ = COMMITTED_SIZE;
+  buffer_.swap(buffer);
+  frames_.insert(frames_.end(), frames.begin(), frames.end());
+  
+  return true;
+}
+
+// Indexes the records of data starting from the given offset and appends 
+// them to frames. The timestamps must not decrease from the last indexed 
+// frame of this archive.
+void DenseVectorFieldArchive::indexFrames_(const char *data, size_t size, size_t offset,
+                                           vector< Frame > &frames) const
+{
+  unsigned long long recordSize, parametersSize, frameSize;
+  Frame frame;
+  
+  while(offset < size)
+  {
+    if(size - offset < RECORD_HEADER_SIZE)
+      throw runtime_error("Corrupted archive file.");
+    
+    memcpy(&recordSize, data + offset, 8);
+    memcpy(&frame.timestamp, data + offset + 8, 8);
+    memcpy(&parametersSize, data + offset + 16, 8);
+    memcpy(&frameSize, data + offset + 24, 8);
+    
+    if(recordSize > size - offset || 
+       parametersSize > recordSize - RECORD_HEADER_SIZE || 
+       frameSize != recordSize - RECORD_HEADER_SIZE - parametersSize)
+      throw runtime_error("Corrupted archive file.");
+    
+    const Frame *last = !frames.empty() ? &frames.back() : 
+                        !frames_.empty() ? &frames_.back() : NULL;
+    if(last != NULL && frame.timestamp < last->timestamp)
+      throw runtime_error("Corrupted archive file.");
+    
+    frame.parametersOffset = offset + RECORD_HEADER_SIZE;
+    frame.parametersSize   = parametersSize;
+    frame.frameOffset      = frame.parametersOffset + parametersSize;
+    frame.frameSize        = frameSize;
+    frames.push_back(frame);
+    
+    offset += recordSize;
+  }
+}
+
+const char *DenseVectorFieldArchive::map_(size_t size, vector< char > &buffer) const
+{
+#ifdef HAVE_MMAP
+  int fd = open(fileName_.c_str(), O_RDONLY);
+  if(fd < 0)
+    throw runtime_error("File not found.");
+  
+  // Only the committed part is mapped. The file never shrinks below it, so 
+  // the mapping remains valid while frames are being appended.
+  void *addr = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if(addr == MAP_FAILED)
+    throw runtime_error("Could not map file into memory.");
+  
+  madvise(addr, size, MADV_RANDOM);
+  
+  return (const char *)addr;
+#else
+  ifstream inputStream(fileName_.c_str(), ios::binary | ios::in);
+  if(!inputStream)
+    throw runtime_error("File not found.");
+  
+  buffer.resize(size);
+  inputStream.read(&buffer[0], size);
+  if(!inputStream)
+    throw runtime_error("Truncated archive file.");
+  
+  return &buffer[0];
+#endif
+}
+
+size_t DenseVectorFieldArchive::readCommittedSize_() const
+{
+  char headerBytes[HEADER_SIZE];
+  ArchiveHeader header;
+
+#ifdef HAVE_MMAP
+  int fd = open(fileName_.c_str(), O_RDONLY);
+  if(fd < 0)
+    throw runtime_error("File not found.");
+  
+  struct stat st;
+  try
+  {
+    if(fstat(fd, &st) != 0 || (size_t)st.st_size < HEADER_SIZE)
+      throw runtime_error("Invalid archive file.");
+    readFully_(fd, headerBytes, HEADER_SIZE, 0);
+  }
+  catch(...)
+  {
+    close(fd);
+    throw;
+  }
+  close(fd);
+  
+  decodeHeader_(headerBytes, header);
+  if(header.committedSize > (unsigned long long)st.st_size)
+    throw runtime_error("Truncated archive file.");
+#else
+  ifstream inputStream(fileName_.c_str(), ios::binary | ios::in);
+  if(!inputStream)
+    throw runtime_error("File not found.");
+  
+  inputStream.read(headerBytes, HEADER_SIZE);
+  if(!inputStream)
+    throw runtime_error("Invalid archive file.");
+  decodeHeader_(headerBytes, header);
+#endif
+  
+  return header.committedSize;
+}
+
+void DenseVectorFieldArchive::unmap_()
+{
+  unmapData_(data_, dataSize_);
+  data_ = NULL;
+  dataSize_ = 0;
+}
@@ -0,0 +1,138 @@
+
+#ifndef DENSEVECTORFIELDARCHIVE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace cimg_library { template < class T > class CImg; }
+
+using namespace cimg_library;
+using namespace std;
+
+/// Implements a read-only memory-mapped view of a dense vector field archive.
+/**
+ * An archive stores a sequence of dense vector fields (frames) with 
+ * timestamps and parameter descriptions in a single file. Frames are added 
+ * with DenseVectorFieldIO::appendVectorField, and their timestamps must be 
+ * nondecreasing. The archive consists of a 32-byte header followed by the 
+ * frame records:
+ *
+ * header:
+ * - magic number "PDVA0001" (8 bytes)
+ * - committed size of the archive in bytes (64-bit unsigned integer)
+ * - number of frames (64-bit unsigned integer)
+ * - timestamp of the last frame (64-bit signed integer)
+ *
+ * frame record:
+ * - record size in bytes, including this field (64-bit unsigned integer)
+ * - timestamp (64-bit signed integer)
+ * - size of the parameter string (64-bit unsigned integer)
+ * - size of the frame (64-bit unsigned integer)
+ * - parameter string (not null-terminated)
+ * - the frame as a PDVM version 2 file (see DenseVectorFieldIO)
+ *
+ * All binary values are in native byte order. A record is written past the 
+ * committed size and the committed size is updated only after the record 
+ * has been completely written, so a reader never sees a partially written 
+ * frame. Concurrent appends are serialized with an advisory file lock. An 
+ * incomplete record left behind by an interrupted append is overwritten by 
+ * the next append.
+ *
+ * The committed part of the archive is mapped into memory when it is 
+ * opened, and the record headers are scanned to build the time index. After 
+ * that, each frame is accessed in constant time without further file 
+ * operations. Frames appended after opening become visible by calling 
+ * refresh().
+ */
+class DenseVectorFieldArchive
+{
+public:
+  /// Opens the given archive and indexes its frames.
+  /**
+   * Throws runtime_error if the file cannot be opened or if it is not 
+   * a valid archive.
+   */
+  DenseVectorFieldArchive(const string &fileName);
+  
+  ~DenseVectorFieldArchive();
+  
+  /// Appends an encoded frame to the given archive file.
+  /**
+   * The archive is created if it does not exist. Throws runtime_error if 
+   * the timestamp is smaller than that of the last frame or if the file 
+   * cannot be written.
+   * @param fileName the archive file
+   * @param timestamp the time of the frame
+   * @param parameters a free-form description of the frame
+   * @param frame the frame as a PDVM file
+   * @param frameSize the size of the frame in bytes
+   */
+  static void appendFrame(const string &fileName,
+                          long long timestamp,
+                          const string &parameters,
+                          const char *frame,
+                          size_t frameSize);
+  
+  /// Returns the index of the frame with the given timestamp, or -1 if there is none.
+  /**
+   * If several frames have the same timestamp, the last one of them is 
+   * returned.
+   */
+  int findFrame(long long timestamp) const;
+  
+  /// Returns the index of the last frame whose timestamp is not greater than the given one, or -1 if there is none.
+  int findLatestFrame(long long timestamp) const;
+  
+  /// Returns a pointer to the ith frame (a PDVM file) and its size in bytes.
+  const char *getFrame(int i, size_t &size) const;
+  
+  /// Returns the number of frames.
+  int getNumFrames() const { return frames_.size(); }
+  
+  /// Returns the parameter string of the ith frame.
+  string getParameters(int i) const;
+  
+  /// Returns the timestamp of the ith frame.
+  long long getTimestamp(int i) const { return frames_[i].timestamp; }
+  
+  /// Reads the ith frame.
+  void readFrame(int i, CImg< double > &V) const;
+  
+  /// Maps and indexes the frames appended after this archive was opened.
+  /**
+   * Returns true if new frames were found.
+   */
+  bool refresh();
+private:
+  struct Frame
+  {
+    long long timestamp;
+    size_t parametersOffset;
+    size_t parametersSize;
+    size_t frameOffset;
+    size_t frameSize;
+  };
+  
+  string fileName_;
+  const char *data_;
+  size_t dataSize_;
+  vector< char > buffer_;
+  vector< Frame > frames_;
+  
+  void indexFrames_(const char *data, size_t size, size_t offset,
+                    vector< Frame > &frames) const;
+  
+  const char *map_(size_t size, vector< char > &buffer) const;
+  
+  size_t readCommittedSize_() const;
+  
+  void unmap_();
+  
+  DenseVectorFieldArchive(const DenseVectorFieldArchive &);
+  DenseVectorFieldArchive &operator=(const DenseVectorFieldArchive &);
+};
+
+#define DENSEVECTORFIELDARCHIVE_H
+
+#endif
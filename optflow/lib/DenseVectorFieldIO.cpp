@@ -1,100 +1,595 @@
 
 #include "DenseVectorFieldIO.h"
-#include "PXMFileUtils.h"
+#include "DenseVectorFieldArchive.h"
+#include "MappedDenseVectorField.h"
 
 #include "CImg_config.h"
 #include <CImg.h>
-#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <sstream>
 #include <stdexcept>
-#include <stdlib.h>
+#include <stdio.h>
 #include <string.h>
+#include <vector>
+#ifdef WITH_ZLIB
+#include <zlib.h>
+#endif
+#ifdef WITH_ZSTD
+#include <zstd.h>
+#endif
 
-static const int TOKEN_SIZE = 100;
+// the number of bytes written with a single write call
+static const size_t WRITE_BLOCK_SIZE = 1 << 20;
 
-void DenseVectorFieldIO::readVectorField(const string &inFileName,
-                                         CImg< double > &V)
+// the int16 value that represents NaN in version 2 files
+static const short INT16_NAN = -32768;
+
+static const char *COMPRESSION_NAMES[] = { "none", "deflate", "zstd" };
+static const char *STORAGE_NAMES[] = { "float32", "float16", "int16" };
+
+// Converts a 32-bit float to a 16-bit float (round to nearest even).
+static unsigned short floatToHalf_(float f)
 {
-  char token[TOKEN_SIZE];
-  int width, height;
-  float u, v;
-  int x, y;
-  float q;
-  int qc;
-  int numQualityChannels;
-  
-  ifstream inputStream(inFileName.c_str(), ios::binary | ios::in);
-  if(!inputStream)
-    throw runtime_error("File not found.");
-  
-  PNMFileUtils::checkMagicNumber(inputStream, "PDV");
-  
-  // get dimensions
-  PNMFileUtils::extractToken(inputStream, token, TOKEN_SIZE);
-  width = atoi(token);
-  PNMFileUtils::extractToken(inputStream, token, TOKEN_SIZE);
-  height = atoi(token);
-  
-  // read the number of quality channels
-  PNMFileUtils::extractToken(inputStream, token, TOKEN_SIZE);
-  numQualityChannels = atoi(token);
-  char ch;
-  inputStream.read((char *)&ch, sizeof(char));
-  
-  V = CImg< double >(width, height, 1, 2 + numQualityChannels);
-  
-  // read data
-  for(y = 0; y < height; y++)
+  unsigned int x;
+  memcpy(&x, &f, sizeof(float));
+  
+  const unsigned int SIGN = (x >> 16) & 0x8000;
+  const int EXP = (int)((x >> 23) & 0xff) - 127 + 15;
+  unsigned int mant = x & 0x7fffff;
+  unsigned int h, rem, halfway;
+  
+  if(((x >> 23) & 0xff) == 0xff) // infinity or NaN
+    return SIGN | 0x7c00 | (mant != 0 ? 0x200 : 0);
+  if(EXP >= 31) // overflow
+    return SIGN | 0x7c00;
+  
+  if(EXP <= 0) // subnormal or zero
   {
-    for(x = 0; x < width; x++)
+    if(EXP < -10)
+      return SIGN;
+    
+    mant |= 0x800000;
+    const int SHIFT = 14 - EXP;
+    h = mant >> SHIFT;
+    rem = mant & ((1u << SHIFT) - 1);
+    halfway = 1u << (SHIFT - 1);
+  }
+  else
+  {
+    h = (EXP << 10) | (mant >> 13);
+    rem = mant & 0x1fff;
+    halfway = 0x1000;
+  }
+  
+  // A carry to the exponent correctly produces the next power of two 
+  // or infinity.
+  if(rem > halfway || (rem == halfway && (h & 1) != 0))
+    h++;
+  
+  return SIGN | h;
+}
+
+// Converts a 16-bit float to a 32-bit float.
+static float halfToFloat_(unsigned short h)
+{
+  const unsigned int SIGN = (h & 0x8000) << 16;
+  int exp = (h >> 10) & 0x1f;
+  unsigned int mant = h & 0x3ff;
+  unsigned int x;
+  float f;
+  
+  if(exp == 0)
+  {
+    if(mant == 0)
+      x = SIGN;
+    else
     {
-      inputStream.read((char *)&u, sizeof(float));
-      inputStream.read((char *)&v, sizeof(float));
-      V(x, y, 0) = u;
-      V(x, y, 1) = v;
+      // normalize the subnormal value
+      exp = 1;
+      while((mant & 0x400) == 0)
+      {
+        mant <<= 1;
+        exp--;
+      }
+      x = SIGN | ((exp + 112) << 23) | ((mant & 0x3ff) << 13);
+    }
+  }
+  else if(exp == 31)
+    x = SIGN | 0x7f800000 | (mant << 13);
+  else
+    x = SIGN | ((exp + 112) << 23) | (mant << 13);
+  
+  memcpy(&f, &x, sizeof(float));
+  return f;
+}
+
+static size_t getElementSize_(DenseVectorFieldIO::Storage storage)
+{
+  return storage == DenseVectorFieldIO::FLOAT32 ? sizeof(float) : sizeof(short);
+}
+
+static void compressChunk_(const vector< char > &src,
+                           DenseVectorFieldIO::Compression compression,
+                           int level,
+                           vector< char > &dest)
+{
+  if(compression == DenseVectorFieldIO::NO_COMPRESSION)
+    dest = src;
+  else if(compression == DenseVectorFieldIO::DEFLATE)
+  {
+#ifdef WITH_ZLIB
+    uLongf destSize = compressBound(src.size());
+    dest.resize(destSize);
+    if(compress2((Bytef *)&dest[0], &destSize, (const Bytef *)&src[0], src.size(), 
+                 level != 0 ? level : Z_DEFAULT_COMPRESSION) != Z_OK)
+      throw runtime_error("Deflate compression failed.");
+    dest.resize(destSize);
+#else
+    throw runtime_error("Deflate compression is not supported (compile with zlib).");
+#endif
+  }
+  else
+  {
+#ifdef WITH_ZSTD
+    dest.resize(ZSTD_compressBound(src.size()));
+    size_t destSize = ZSTD_compress(&dest[0], dest.size(), &src[0], src.size(), level);
+    if(ZSTD_isError(destSize))
+      throw runtime_error("Zstd compression failed.");
+    dest.resize(destSize);
+#else
+    throw runtime_error("Zstd compression is not supported (compile with zstd).");
+#endif
+  }
+}
+
+static void decompressChunk_(const char *src,
+                             size_t srcSize,
+                             DenseVectorFieldIO::Compression compression,
+                             vector< char > &dest)
+{
+  if(compression == DenseVectorFieldIO::NO_COMPRESSION)
+  {
+    if(srcSize != dest.size())
+      throw runtime_error("Corrupted PDVM chunk.");
+    memcpy(&dest[0], src, srcSize);
+  }
+  else if(compression == DenseVectorFieldIO::DEFLATE)
+  {
+#ifdef WITH_ZLIB
+    uLongf destSize = dest.size();
+    if(uncompress((Bytef *)&dest[0], &destSize, (const Bytef *)src, srcSize) != Z_OK || 
+       destSize != dest.size())
+      throw runtime_error("Corrupted PDVM chunk.");
+#else
+    throw runtime_error("Deflate compression is not supported (compile with zlib).");
+#endif
+  }
+  else
+  {
+#ifdef WITH_ZSTD
+    size_t destSize = ZSTD_decompress(&dest[0], dest.size(), src, srcSize);
+    if(ZSTD_isError(destSize) || destSize != dest.size())
+      throw runtime_error("Corrupted PDVM chunk.");
+#else
+    throw runtime_error("Zstd compression is not supported (compile with zstd).");
+#endif
+  }
+}
+
+// Decodes the chunks of a version 2 file that intersect the given region.
+static void readChunks_(const MappedDenseVectorField &M,
+                        int x0, int y0,
+                        int width, int height,
+                        CImg< double > &V)
+{
+  const int C = M.getNumChannels();
+  const int CW = M.getChunkWidth();
+  const int CH = M.getChunkHeight();
+  const size_t ELEMENT_SIZE = getElementSize_(M.getStorage());
+  
+  V.assign(width, height, 1, C);
+  if(width == 0 || height == 0)
+    return;
+  
+  const int CX0 = x0 / CW;
+  const int CX1 = (x0 + width - 1) / CW;
+  const int CY0 = y0 / CH;
+  const int CY1 = (y0 + height - 1) / CH;
+  const int NCX = CX1 - CX0 + 1;
+  const int NUM_CHUNKS = NCX * (CY1 - CY0 + 1);
+  
+  bool failed = false;
+  string errorMessage;
+
+#pragma omp parallel
+  {
+    vector< char > buffer;
+
+#pragma omp for schedule(dynamic)
+    for(int k = 0; k < NUM_CHUNKS; k++)
+    {
+      const int CX = CX0 + k % NCX;
+      const int CY = CY0 + k / NCX;
+      const int X = CX * CW;
+      const int Y = CY * CH;
+      const int W = min(CW, M.getWidth() - X);
+      const int H = min(CH, M.getHeight() - Y);
+      size_t chunkSize;
+      const char *chunk = M.getChunk(CY * M.getNumChunksX() + CX, chunkSize);
+      
+      buffer.resize((size_t)C * W * H * ELEMENT_SIZE);
+      try
+      {
+        decompressChunk_(chunk, chunkSize, M.getCompression(), buffer);
+      }
+      catch(runtime_error &e)
+      {
+#pragma omp critical
+        {
+          failed = true;
+          errorMessage = e.what();
+        }
+        continue;
+      }
+      
+      // the intersection of the chunk and the region
+      const int XS = max(X, x0), XE = min(X + W, x0 + width);
+      const int YS = max(Y, y0), YE = min(Y + H, y0 + height);
       
-      for(qc = 0; qc < numQualityChannels; qc++)
+      for(int c = 0; c < C; c++)
       {
-        inputStream.read((char *)&q, sizeof(float));
-        V(x, y, 2 + qc) = q;
+        const double SCALE  = M.getScale(c);
+        const double OFFSET = M.getOffset(c);
+        
+        for(int y = YS; y < YE; y++)
+        {
+          const size_t ROW = ((size_t)c * H + (y - Y)) * W;
+          double *dest = V.data(XS - x0, y - y0, 0, c);
+          
+          if(M.getStorage() == DenseVectorFieldIO::FLOAT32)
+          {
+            const float *src = (const float *)&buffer[0] + ROW;
+            for(int x = XS; x < XE; x++)
+              *dest++ = src[x - X] * SCALE + OFFSET;
+          }
+          else if(M.getStorage() == DenseVectorFieldIO::FLOAT16)
+          {
+            const unsigned short *src = (const unsigned short *)&buffer[0] + ROW;
+            for(int x = XS; x < XE; x++)
+              *dest++ = halfToFloat_(src[x - X]) * SCALE + OFFSET;
+          }
+          else
+          {
+            const short *src = (const short *)&buffer[0] + ROW;
+            for(int x = XS; x < XE; x++)
+              *dest++ = src[x - X] != INT16_NAN ? src[x - X] * SCALE + OFFSET : 
+                                                  numeric_limits< double >::quiet_NaN();
+          }
+        }
       }
     }
   }
   
-  inputStream.close();
+  if(failed)
+    throw runtime_error(errorMessage);
+}
+
+// Reads the given region of a version 1 file. The span of each row within 
+// the region is contiguous in the mapped payload, so it is copied into an 
+// aligned buffer and de-interleaved into the channels of V.
+static void readRows_(const MappedDenseVectorField &M,
+                      int x0, int y0,
+                      int width, int height,
+                      CImg< double > &V)
+{
+  const int C = M.getNumChannels();
+  
+  V.assign(width, height, 1, C);
+
+#pragma omp parallel
+  {
+    vector< float > row((size_t)width * C);
+
+#pragma omp for schedule(static)
+    for(int y = 0; y < height; y++)
+    {
+      if(width > 0)
+        memcpy(&row[0], M.getRow(y0 + y) + (size_t)x0 * C * sizeof(float), 
+               row.size() * sizeof(float));
+      
+      for(int c = 0; c < C; c++)
+      {
+        double *dest = V.data(0, y, 0, c);
+        const float *src = &row[0] + c;
+        
+        for(int x = 0; x < width; x++)
+          dest[x] = src[x * C];
+      }
+    }
+  }
+}
+
+// Encodes a vector field in PDVM version 2 format and writes it to the 
+// given stream.
+static void writeVectorField_(const CImg< double > &V,
+                              ostream &outputStream,
+                              DenseVectorFieldIO::Storage storage,
+                              DenseVectorFieldIO::Compression compression,
+                              int chunkSize,
+                              int compressionLevel)
+{
+  if(chunkSize < 1)
+    throw invalid_argument("The chunk size must be positive.");
+  if(V.spectrum() < 2)
+    throw invalid_argument("The vector field must have at least two channels.");
+  
+  const int W = V.width();
+  const int H = V.height();
+  const int C = V.spectrum();
+  const int NCX = (W + chunkSize - 1) / chunkSize;
+  const int NCY = (H + chunkSize - 1) / chunkSize;
+  const int NUM_CHUNKS = NCX * NCY;
+  const size_t ELEMENT_SIZE = getElementSize_(storage);
+  int c, i;
+  
+  // Choose the scale and offset of each channel so that the fixed-point 
+  // values cover the range of the finite values.
+  vector< float > scales(C, 1.0f), offsets(C, 0.0f);
+  if(storage == DenseVectorFieldIO::INT16)
+  {
+    for(c = 0; c < C; c++)
+    {
+      double minValue = numeric_limits< double >::max();
+      double maxValue = -numeric_limits< double >::max();
+      const double *src = V.data(0, 0, 0, c);
+      
+      for(size_t j = 0; j < (size_t)W * H; j++)
+      {
+        if(std::isfinite(src[j]))
+        {
+          minValue = min(minValue, src[j]);
+          maxValue = max(maxValue, src[j]);
+        }
+      }
+      
+      if(minValue <= maxValue)
+      {
+        offsets[c] = (minValue + maxValue) / 2.0;
+        if(maxValue > minValue)
+          scales[c] = (maxValue - minValue) / 65534.0;
+      }
+    }
+  }
+  
+  // Encode and compress the chunks concurrently.
+  vector< vector< char > > chunks(NUM_CHUNKS);
+  bool failed = false;
+  string errorMessage;
+
+#pragma omp parallel
+  {
+    vector< char > buffer;
+
+#pragma omp for schedule(dynamic)
+    for(int k = 0; k < NUM_CHUNKS; k++)
+    {
+      const int X = (k % NCX) * chunkSize;
+      const int Y = (k / NCX) * chunkSize;
+      const int CW = min(chunkSize, W - X);
+      const int CH = min(chunkSize, H - Y);
+      
+      buffer.resize((size_t)C * CW * CH * ELEMENT_SIZE);
+      
+      for(int c = 0; c < C; c++)
+      {
+        for(int y = 0; y < CH; y++)
+        {
+          const double *src = V.data(X, Y + y, 0, c);
+          const size_t ROW = ((size_t)c * CH + y) * CW;
+          
+          if(storage == DenseVectorFieldIO::FLOAT32)
+          {
+            float *dest = (float *)&buffer[0] + ROW;
+            for(int x = 0; x < CW; x++)
+              dest[x] = src[x];
+          }
+          else if(storage == DenseVectorFieldIO::FLOAT16)
+          {
+            unsigned short *dest = (unsigned short *)&buffer[0] + ROW;
+            for(int x = 0; x < CW; x++)
+              dest[x] = floatToHalf_(src[x]);
+          }
+          else
+          {
+            short *dest = (short *)&buffer[0] + ROW;
+            for(int x = 0; x < CW; x++)
+            {
+              if(std::isnan(src[x]))
+                dest[x] = INT16_NAN;
+              else
+              {
+                double q = floor((src[x] - offsets[c]) / scales[c] + 0.5);
+                dest[x] = (short)max(-32767.0, min(q, 32767.0));
+              }
+            }
+          }
+        }
+      }
+      
+      try
+      {
+        compressChunk_(buffer, compression, compressionLevel, chunks[k]);
+      }
+      catch(runtime_error &e)
+      {
+#pragma omp critical
+        {
+          failed = true;
+          errorMessage = e.what();
+        }
+      }
+    }
+  }
+  
+  if(failed)
+    throw runtime_error(errorMessage);
+  
+  char header[200];
+  sprintf(header, "PDV2\n%d %d\n%d\n%s %s %d %d\n", W, H, C - 2, 
+          STORAGE_NAMES[storage], COMPRESSION_NAMES[compression], chunkSize, chunkSize);
+  outputStream.write(header, strlen(header));
+  
+  for(c = 0; c < C; c++)
+  {
+    outputStream.write((const char *)&scales[c], sizeof(float));
+    outputStream.write((const char *)&offsets[c], sizeof(float));
+  }
+  
+  vector< unsigned long long > index(2 * NUM_CHUNKS);
+  unsigned long long offset = 0;
+  for(i = 0; i < NUM_CHUNKS; i++)
+  {
+    index[2*i]     = offset;
+    index[2*i + 1] = chunks[i].size();
+    offset += chunks[i].size();
+  }
+  if(NUM_CHUNKS > 0)
+    outputStream.write((const char *)&index[0], index.size() * sizeof(unsigned long long));
+  
+  for(i = 0; i < NUM_CHUNKS; i++)
+    if(!chunks[i].empty())
+      outputStream.write(&chunks[i][0], chunks[i].size());
+}
+
+void DenseVectorFieldIO::appendVectorField(const CImg< double > &V,
+                                           const string &archiveFileName,
+                                           long long timestamp,
+                                           const string &parameters,
+                                           Storage storage,
+                                           Compression compression)
+{
+  ostringstream frameStream(ios::binary | ios::out);
+  writeVectorField_(V, frameStream, storage, compression, 256, 0);
+  
+  const string FRAME = frameStream.str();
+  DenseVectorFieldArchive::appendFrame(archiveFileName, timestamp, parameters, 
+                                       FRAME.data(), FRAME.size());
+}
+
+void DenseVectorFieldIO::readArchivedVectorField(const string &archiveFileName,
+                                                 long long timestamp,
+                                                 CImg< double > &V)
+{
+  DenseVectorFieldArchive A(archiveFileName);
+  
+  const int I = A.findFrame(timestamp);
+  if(I < 0)
+    throw runtime_error("No frame with the given timestamp in the archive.");
+  
+  A.readFrame(I, V);
+}
+
+void DenseVectorFieldIO::readVectorField(const string &inFileName,
+                                         CImg< double > &V)
+{
+  MappedDenseVectorField M(inFileName);
+  
+  readVectorField(M, V);
+}
+
+void DenseVectorFieldIO::readVectorField(const MappedDenseVectorField &M,
+                                         CImg< double > &V)
+{
+  const int W = M.getWidth();
+  const int H = M.getHeight();
+  
+  if(M.getVersion() == 2)
+    readChunks_(M, 0, 0, W, H, V);
+  else
+    readRows_(M, 0, 0, W, H, V);
+}
+
+void DenseVectorFieldIO::readVectorFieldRegion(const string &inFileName,
+                                               int x0, int y0,
+                                               int width, int height,
+                                               CImg< double > &V)
+{
+  MappedDenseVectorField M(inFileName);
+  
+  if(x0 < 0 || y0 < 0 || width < 0 || height < 0 || 
+     width > M.getWidth() - x0 || height > M.getHeight() - y0)
+    throw invalid_argument("The region is outside the vector field.");
+  
+  if(M.getVersion() == 2)
+    readChunks_(M, x0, y0, width, height, V);
+  else
+    readRows_(M, x0, y0, width, height, V);
 }
 
 void DenseVectorFieldIO::writeVectorField(const CImg< double > &V,
                                           const string &outFileName)
 {
-  float u, v;
-  int x, y;
-  float q;
-  int qc;
+  const int W = V.width();
+  const int H = V.height();
+  const int C = V.spectrum();
+  int c, x, y;
   
   ofstream outputStream(outFileName.c_str(), ios::binary | ios::out);
   if(!outputStream)
     throw runtime_error("Error creating file");
   
   char header[100];
-  sprintf(header,"PDV\n%d %d\n%d\n", V.width(), V.height(), V.spectrum() - 2);
+  sprintf(header,"PDV\n%d %d\n%d\n", W, H, C - 2);
   outputStream.write(header, strlen(header));
   
-  // write data
-  for(y = 0; y < V.height(); y++)
+  // Interleave blocks of rows into a buffer and write each block with 
+  // a single call.
+  const size_t ROW_SIZE = (size_t)W * C;
+  const int ROWS_PER_BLOCK = max(1, (int)(WRITE_BLOCK_SIZE / (sizeof(float) * max(ROW_SIZE, (size_t)1))));
+  vector< float > block(ROWS_PER_BLOCK * ROW_SIZE);
+  
+  for(int y0 = 0; y0 < H; y0 += ROWS_PER_BLOCK)
   {
-    for(x = 0; x < V.width(); x++)
+    const int NUM_ROWS = min(ROWS_PER_BLOCK, H - y0);
+    
+    for(y = 0; y < NUM_ROWS; y++)
     {
-      u = V(x, y, 0);
-      v = V(x, y, 1);
-      outputStream.write((const char *)&u, sizeof(float));
-      outputStream.write((const char *)&v, sizeof(float));
-      for(qc = 0; qc < V.spectrum() - 2; qc++)
+      for(c = 0; c < C; c++)
       {
-        q = V(x, y, 2 + qc);
-        outputStream.write((const char *)&q, sizeof(float));
+        const double *src = V.data(0, y0 + y, 0, c);
+        float *dest = &block[y * ROW_SIZE] + c;
+        
+        for(x = 0; x < W; x++)
+          dest[x * C] = src[x];
       }
     }
+    
+    if(NUM_ROWS * ROW_SIZE > 0)
+      outputStream.write((const char *)&block[0], NUM_ROWS * ROW_SIZE * sizeof(float));
   }
   
   outputStream.close();
+  if(!outputStream)
+    throw runtime_error("Error writing file");
+}
+
+void DenseVectorFieldIO::writeVectorField(const CImg< double > &V,
+                                          const string &outFileName,
+                                          Storage storage,
+                                          Compression compression,
+                                          int chunkSize,
+                                          int compressionLevel)
+{
+  ofstream outputStream(outFileName.c_str(), ios::binary | ios::out);
+  if(!outputStream)
+    throw runtime_error("Error creating file");
+  
+  writeVectorField_(V, outputStream, storage, compression, chunkSize, compressionLevel);
+  
+  outputStream.close();
+  if(!outputStream)
+    throw runtime_error("Error writing file");
 }
@@ -5,6 +5,8 @@
 
 namespace cimg_library { template < class T > class CImg; }
 
+class MappedDenseVectorField;
+
 using namespace cimg_library;
 using namespace std;
 
@@ -12,8 +14,9 @@ using namespace std;
 /**
  * This class implements methods for reading and writing dense 
  * motion vector fields in PDVM format (an extension of the PGM format).
+ * Two versions of the format are supported.
  *
- * A PDVM header is of the form:
+ * A version 1 PDVM header is of the form:
  * PDV
  * [width] [height]
  * [numqualitychannels]
@@ -21,17 +24,127 @@ using namespace std;
  * The data consists of 2+q -dimensional sequentially 
  * ordered vectors originating from each pixel in the raster, 
  * q is the number of quality channels.
+ *
+ * A version 2 PDVM header is of the form:
+ * PDV2
+ * [width] [height]
+ * [numqualitychannels]
+ * [storage] [compression] [chunkwidth] [chunkheight]
+ *
+ * where storage is float32, float16 or int16 and compression is none, 
+ * deflate or zstd. The header is followed by a single whitespace character 
+ * and the following binary sections:
+ * - scale and offset of each channel (2 x 32-bit floats per channel), 
+ *   the stored values are decoded as value*scale+offset
+ * - chunk index: offset and size of each chunk (2 x 64-bit unsigned 
+ *   integers per chunk) relative to the beginning of the chunk data, 
+ *   the chunks are in row-major order
+ * - chunk data
+ *
+ * The field is divided into chunks of chunkwidth x chunkheight pixels 
+ * (smaller at the right and bottom edges). Each chunk is compressed 
+ * separately and stores its channels one after another, each channel in 
+ * row-major order. In the int16 storage, the value -32768 represents NaN. 
+ * All binary values are in native byte order, as in version 1.
+ *
+ * The files are read through a memory mapping (see MappedDenseVectorField) 
+ * and written in large blocks.
+ *
+ * Sequences of vector fields can also be appended to a single archive file 
+ * indexed by time (see DenseVectorFieldArchive), each frame stored as 
+ * a version 2 PDVM file.
  */
 class DenseVectorFieldIO
 {
 public:
-  /// Reads a vector field from a file in PDVM format.
+  /// Storage types of the vector components in version 2 files.
+  /**
+   * - FLOAT32: 32-bit floating point (lossless)
+   * - FLOAT16: 16-bit floating point
+   * - INT16: 16-bit fixed point, the scale and offset of each channel are 
+   *   chosen to cover its value range
+   */
+  enum Storage { FLOAT32, FLOAT16, INT16 };
+  
+  /// Compression methods of the chunks in version 2 files.
+  enum Compression { NO_COMPRESSION, DEFLATE, ZSTD };
+  
+  /// Appends a vector field to an archive file.
+  /**
+   * The archive is created if it does not exist. The frame is stored as 
+   * a version 2 PDVM file with the given storage type and compression. It 
+   * is safe to append while the archive is being read, see 
+   * DenseVectorFieldArchive. Throws runtime_error if the timestamp is 
+   * smaller than that of the last frame in the archive.
+   * @param V the vector field to append
+   * @param archiveFileName the archive file
+   * @param timestamp the time of the frame (e.g. seconds since the epoch)
+   * @param parameters a free-form description of the parameters used for 
+   * computing the vector field
+   * @param storage the storage type of the vector components
+   * @param compression the compression method of the chunks
+   */
+  static void appendVectorField(const CImg< double > &V,
+                                const string &archiveFileName,
+                                long long timestamp,
+                                const string &parameters = "",
+                                Storage storage = FLOAT32,
+                                Compression compression = NO_COMPRESSION);
+  
+  /// Reads the vector field with the given timestamp from an archive file.
+  /**
+   * Throws runtime_error if the archive has no frame with the given 
+   * timestamp. For reading multiple frames, open the archive once with 
+   * DenseVectorFieldArchive.
+   */
+  static void readArchivedVectorField(const string &archiveFileName,
+                                      long long timestamp,
+                                      CImg< double > &V);
+  
+  /// Reads a vector field from a file in PDVM format (version 1 or 2).
   static void readVectorField(const string &inFileName,
                               CImg< double > &V);
   
-  /// Writes a vector field to a file in PDVM format.
+  /// Decodes a vector field from a mapped PDVM file.
+  static void readVectorField(const MappedDenseVectorField &M,
+                              CImg< double > &V);
+  
+  /// Reads a rectangular subregion of a vector field from a PDVM file.
+  /**
+   * For version 2 files, only the chunks intersecting the region are 
+   * decompressed.
+   * @param inFileName the file to read from
+   * @param x0 x-coordinate of the upper-left corner of the region
+   * @param y0 y-coordinate of the upper-left corner of the region
+   * @param width width of the region
+   * @param height height of the region
+   * @param[out] V the vector field of the region
+   */
+  static void readVectorFieldRegion(const string &inFileName,
+                                    int x0, int y0,
+                                    int width, int height,
+                                    CImg< double > &V);
+  
+  /// Writes a vector field to a file in PDVM format (version 1).
   static void writeVectorField(const CImg< double > &V,
                                const string &outFileName);
+  
+  /// Writes a vector field to a file in PDVM version 2 format.
+  /**
+   * @param V the vector field to write
+   * @param outFileName the file to write to
+   * @param storage the storage type of the vector components
+   * @param compression the compression method of the chunks
+   * @param chunkSize the width and height of the chunks
+   * @param compressionLevel the compression level, or zero for the 
+   * default level of the compression method
+   */
+  static void writeVectorField(const CImg< double > &V,
+                               const string &outFileName,
+                               Storage storage,
+                               Compression compression,
+                               int chunkSize = 256,
+                               int compressionLevel = 0);
 };
 
 #define VECTORFIELDIO_H
@@ -0,0 +1,254 @@
+
+#include "DenseImageExtrapolator.h"
+#include "EnsembleImageExtrapolator.h"
+
+#include "CImg_config.h"
+#include <CImg.h>
+#include <fstream>
+#include <math.h>
+#include <stdexcept>
+#include <string.h>
+
+// The SplitMix64 generator. It is small and fast, and its output does not 
+// depend on the platform, so the perturbations are reproducible.
+static unsigned long long nextRandom_(unsigned long long &state)
+{
+  unsigned long long z = (state += 0x9E3779B97F4A7C15ULL);
+  
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  
+  return z ^ (z >> 31);
+}
+
+// Returns a uniformly distributed random number in (0,1).
+static double uniform_(unsigned long long &state)
+{
+  return ((nextRandom_(state) >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+}
+
+EnsembleImageExtrapolator::Options::Options() : numMembers(20),
+                                                numLeadTimes(12),
+                                                timeStep(1.0),
+                                                perturbationStdDev(0.5),
+                                                correlationLength(32.0),
+                                                seed(0)
+{ }
+
+EnsembleImageExtrapolator::EnsembleImageExtrapolator(const DenseImageExtrapolator &e,
+                                                     const Options &options) : 
+  e_(e), options_(options)
+{
+  if(options.numMembers < 1)
+    throw invalid_argument("The number of ensemble members must be positive.");
+  if(options.numLeadTimes < 1)
+    throw invalid_argument("The number of lead times must be positive.");
+  if(options.perturbationStdDev < 0.0)
+    throw invalid_argument("The standard deviation of the perturbations must be nonnegative.");
+  if(options.correlationLength < 0.0)
+    throw invalid_argument("The correlation length must be nonnegative.");
+}
+
+void EnsembleImageExtrapolator::extrapolate(const CImg< unsigned char > &I0,
+                                            const CImg< double > &V,
+                                            CImg< unsigned char > &E) const
+{
+  extrapolate_(I0, V, E);
+}
+
+void EnsembleImageExtrapolator::extrapolate(const CImg< unsigned short > &I0,
+                                            const CImg< double > &V,
+                                            CImg< unsigned short > &E) const
+{
+  extrapolate_(I0, V, E);
+}
+
+void EnsembleImageExtrapolator::extrapolate(const CImg< float > &I0,
+                                            const CImg< double > &V,
+                                            CImg< float > &E) const
+{
+  extrapolate_(I0, V, E);
+}
+
+void EnsembleImageExtrapolator::extrapolate(const CImg< unsigned char > &I0,
+                                            const CImg< double > &V,
+                                            const string &fileName) const
+{
+  const int W = I0.width();
+  const int H = I0.height();
+  const int L = options_.numLeadTimes;
+  const size_t MEMBER_SIZE = (size_t)W * H * L;
+  
+  if(V.width() != W || V.height() != H || V.spectrum() < 2)
+    throw invalid_argument("The image and the motion field must have the same dimensions.");
+  
+  ofstream outputStream(fileName.c_str(), ios::out | ios::binary);
+  if(!outputStream)
+    throw runtime_error("Error creating file " + fileName);
+  
+  outputStream<<"P5\n";
+  outputStream<<"# optflow ensemble: "<<options_.numMembers<<" members, "<<L<<" lead times\n";
+  outputStream<<W<<" "<<(long long)H * L * options_.numMembers<<"\n255\n";
+  
+  bool failed = false;
+  string errorMessage;
+  
+  // The members are written in order, so each thread holds at most one 
+  // member that has not been written.
+#pragma omp parallel
+  {
+    CImg< unsigned char > M;
+
+#pragma omp for ordered schedule(static, 1)
+    for(int m = 0; m < options_.numMembers; m++)
+    {
+      string memberError;
+      
+      try
+      {
+        extrapolateMember_(I0, V, m, M);
+      }
+      catch(exception &e)
+      {
+        memberError = e.what();
+      }
+
+#pragma omp ordered
+      {
+        if(!failed && !memberError.empty())
+        {
+          failed = true;
+          errorMessage = memberError;
+        }
+        else if(!failed)
+          outputStream.write((const char *)M.data(), MEMBER_SIZE);
+      }
+    }
+  }
+  
+  if(failed)
+    throw runtime_error(errorMessage);
+  
+  outputStream.close();
+  if(!outputStream)
+    throw runtime_error("Error writing file " + fileName);
+}
+
+void EnsembleImageExtrapolator::generatePerturbation(int width, int height,
+                                                     int member,
+                                                     CImg< double > &P) const
+{
+  // Derive an independent stream for each member. The member index is 
+  // added to the scrambled seed and the sum is scrambled again, so that 
+  // swapping the seed and the member index gives a different stream.
+  unsigned long long seedState = options_.seed;
+  unsigned long long memberState = nextRandom_(seedState) + 
+    (unsigned long long)member * 0x9E3779B97F4A7C15ULL;
+  unsigned long long state = nextRandom_(memberState);
+  const size_t N = (size_t)width * height;
+  
+  P.assign(width, height, 1, 2);
+  
+  // Box-Muller transform
+  for(size_t i = 0; i + 1 < P.size(); i += 2)
+  {
+    const double R = sqrt(-2.0 * log(uniform_(state)));
+    const double THETA = 2.0 * M_PI * uniform_(state);
+    P[i]     = R * cos(THETA);
+    P[i + 1] = R * sin(THETA);
+  }
+  if(P.size() % 2 != 0)
+    P[P.size() - 1] = sqrt(-2.0 * log(uniform_(state))) * cos(2.0 * M_PI * uniform_(state));
+  
+  if(options_.correlationLength > 0.0)
+    P.blur((float)options_.correlationLength);
+  
+  // Scale the components to the given root mean square. The mean is not 
+  // removed, so a long correlation length gives a nearly uniform offset.
+  for(int c = 0; c < 2; c++)
+  {
+    double *p = P.data(0, 0, 0, c);
+    double sumSq = 0.0;
+    size_t i;
+    
+    for(i = 0; i < N; i++)
+      sumSq += p[i] * p[i];
+    
+    const double SCALE = sumSq > 0.0 ? options_.perturbationStdDev / sqrt(sumSq / N) : 0.0;
+    for(i = 0; i < N; i++)
+      p[i] *= SCALE;
+  }
+}
+
+template < class T >
+void EnsembleImageExtrapolator::extrapolateMember_(const CImg< T > &I0,
+                                                   const CImg< double > &V,
+                                                   int member,
+                                                   CImg< T > &E) const
+{
+  const int W = I0.width();
+  const int H = I0.height();
+  CImg< double > Vm;
+  CImg< T > Ie;
+  
+  generatePerturbation(W, H, member, Vm);
+  for(int c = 0; c < 2; c++)
+  {
+    const double *v = V.data(0, 0, 0, c);
+    double *vm = Vm.data(0, 0, 0, c);
+    
+    for(size_t i = 0; i < (size_t)W * H; i++)
+      vm[i] += v[i];
+  }
+  
+  E.assign(W, H, options_.numLeadTimes, 1);
+  for(int k = 0; k < options_.numLeadTimes; k++)
+  {
+    e_.extrapolate(I0, Vm, (k + 1) * options_.timeStep, Ie);
+    memcpy(E.data(0, 0, k), Ie.data(), (size_t)W * H * sizeof(T));
+  }
+}
+
+template < class T >
+void EnsembleImageExtrapolator::extrapolate_(const CImg< T > &I0,
+                                             const CImg< double > &V,
+                                             CImg< T > &E) const
+{
+  const int W = I0.width();
+  const int H = I0.height();
+  const size_t MEMBER_SIZE = (size_t)W * H * options_.numLeadTimes;
+  
+  if(V.width() != W || V.height() != H || V.spectrum() < 2)
+    throw invalid_argument("The image and the motion field must have the same dimensions.");
+  
+  E.assign(W, H, options_.numLeadTimes, options_.numMembers);
+  
+  bool failed = false;
+  string errorMessage;
+
+#pragma omp parallel
+  {
+    CImg< T > M;
+
+#pragma omp for schedule(dynamic)
+    for(int m = 0; m < options_.numMembers; m++)
+    {
+      try
+      {
+        extrapolateMember_(I0, V, m, M);
+        memcpy(E.data(0, 0, 0, m), M.data(), MEMBER_SIZE * sizeof(T));
+      }
+      catch(exception &e)
+      {
+#pragma omp critical
+        {
+          failed = true;
+          errorMessage = e.what();
+        }
+      }
+    }
+  }
+  
+  if(failed)
+    throw runtime_error(errorMessage);
+}
@@ -0,0 +1,122 @@
+
+#ifndef ENSEMBLEIMAGEEXTRAPOLATOR_H
+
+#include <string>
+
+namespace cimg_library { template < class T > class CImg; }
+class DenseImageExtrapolator;
+
+using namespace cimg_library;
+using namespace std;
+
+/// Generates an ensemble of extrapolations with perturbed motion fields.
+/**
+ * Each ensemble member extrapolates the same source image by using the 
+ * motion field V+P, where P is a spatially correlated random perturbation. 
+ * The components of P are white Gaussian noise fields smoothed with a 
+ * Gaussian filter whose standard deviation is the correlation length, 
+ * and scaled to the given standard deviation. The random numbers of each 
+ * member are generated from the seed and the member index, so the results 
+ * are reproducible and do not depend on the number of threads.
+ *
+ * The members are computed in parallel (if compiled with OpenMP), and the 
+ * source image is shared between them. Any dense image extrapolator can be 
+ * used for advecting the members. Its extrapolate methods must be 
+ * thread-safe, which is the case for the extrapolators in this library.
+ */
+class EnsembleImageExtrapolator
+{
+public:
+  /// Options of the ensemble.
+  struct Options
+  {
+    /// Initializes the default options.
+    Options();
+    
+    /// The number of ensemble members (default 20).
+    int numMembers;
+    /// The number of lead times per member (default 12).
+    int numLeadTimes;
+    /// The time step between successive lead times (default 1).
+    double timeStep;
+    /// The standard deviation of the motion perturbations (pixels per unit time) (default 0.5).
+    double perturbationStdDev;
+    /// The correlation length of the motion perturbations (pixels) (default 32).
+    double correlationLength;
+    /// The seed of the random number generator (default 0).
+    unsigned long long seed;
+  };
+  
+  /// Constructs an ensemble extrapolator.
+  /**
+   * Throws invalid_argument if the options are invalid.
+   * @param e the extrapolator used for the members
+   * @param options the options of the ensemble
+   */
+  EnsembleImageExtrapolator(const DenseImageExtrapolator &e,
+                            const Options &options = Options());
+  
+  /// Computes the ensemble.
+  /**
+   * Throws invalid_argument if the dimensions of I0 and V do not match.
+   * @param[in] I0 the image to extrapolate
+   * @param[in] V the unperturbed motion field
+   * @param[out] E W x H x numLeadTimes x numMembers stack of the 
+   * extrapolated images. Slice k (the z-coordinate) of channel m contains 
+   * member m at lead time (k+1)*timeStep.
+   */
+  void extrapolate(const CImg< unsigned char > &I0,
+                   const CImg< double > &V,
+                   CImg< unsigned char > &E) const;
+  
+  /// Computes the ensemble of a 16-bit image.
+  void extrapolate(const CImg< unsigned short > &I0,
+                   const CImg< double > &V,
+                   CImg< unsigned short > &E) const;
+  
+  /// Computes the ensemble of a floating-point image.
+  void extrapolate(const CImg< float > &I0,
+                   const CImg< double > &V,
+                   CImg< float > &E) const;
+  
+  /// Computes the ensemble and writes it into a file.
+  /**
+   * The file is an 8-bit PGM image of width W and height 
+   * H*numLeadTimes*numMembers. The images of member 0 are written first in 
+   * the order of lead times, followed by member 1 etc. The members are 
+   * written in order as they are completed, so at most one member per 
+   * thread is held in memory. Throws runtime_error if the file cannot be 
+   * written.
+   */
+  void extrapolate(const CImg< unsigned char > &I0,
+                   const CImg< double > &V,
+                   const string &fileName) const;
+  
+  /// Generates the motion perturbation of the given member.
+  /**
+   * @param[in] width the width of the motion field
+   * @param[in] height the height of the motion field
+   * @param[in] member the index of the member
+   * @param[out] P the perturbation (two channels)
+   */
+  void generatePerturbation(int width, int height, int member,
+                            CImg< double > &P) const;
+private:
+  const DenseImageExtrapolator &e_;
+  Options options_;
+  
+  template < class T >
+  void extrapolateMember_(const CImg< T > &I0,
+                          const CImg< double > &V,
+                          int member,
+                          CImg< T > &E) const;
+  
+  template < class T >
+  void extrapolate_(const CImg< T > &I0,
+                    const CImg< double > &V,
+                    CImg< T > &E) const;
+};
+
+#define ENSEMBLEIMAGEEXTRAPOLATOR_H
+
+#endif
@@ -0,0 +1,301 @@
+
+#include "FloatImagePyramid.h"
+#include "IntensityTransform.h"
+
+#include "CImg_config.h"
+#include <CImg.h>
+#include <algorithm>
+
+FloatImagePyramid::FloatImagePyramid() { }
+
+// Returns I(x,y), or zero if (x,y) is outside the image.
+static inline float zeroPaddedAt_(const CImg< float > &I, int x, int y)
+{
+  if(x < 0 || y < 0 || x >= I.width() || y >= I.height())
+    return 0.0f;
+  else
+    return I(x, y);
+}
+
+// Reads the pixels without bounds checking.
+struct UncheckedAccess_
+{
+  explicit UncheckedAccess_(const CImg< float > &I) : I_(I) { }
+  
+  float operator()(int x, int y) const { return I_(x, y); }
+  
+  const CImg< float > &I_;
+};
+
+// Reads the pixels outside the image as zero.
+struct ZeroPaddedAccess_
+{
+  explicit ZeroPaddedAccess_(const CImg< float > &I) : I_(I) { }
+  
+  float operator()(int x, int y) const { return zeroPaddedAt_(I_, x, y); }
+  
+  const CImg< float > &I_;
+};
+
+// 3x3 Sobel stencil.
+struct Sobel_
+{
+  static const int RADIUS = 1;
+  
+  template < class A >
+  static inline void apply(const A &I, int x, int y, CImg< float > &G)
+  {
+    G(x, y, 0, 0) = (I(x+1, y-1) - I(x-1, y-1) +
+                     2.0f * (I(x+1, y) - I(x-1, y)) +
+                     I(x+1, y+1) - I(x-1, y+1)) / 8.0f;
+    G(x, y, 0, 1) = (I(x-1, y+1) - I(x-1, y-1) +
+                     2.0f * (I(x, y+1) - I(x, y-1)) +
+                     I(x+1, y+1) - I(x+1, y-1)) / 8.0f;
+  }
+};
+
+// Five-point central difference stencil.
+struct Central5_
+{
+  static const int RADIUS = 2;
+  
+  template < class A >
+  static inline void apply(const A &I, int x, int y, CImg< float > &G)
+  {
+    G(x, y, 0, 0) = (I(x-2, y) - 8.0f * I(x-1, y) +
+                     8.0f * I(x+1, y) - I(x+2, y)) / 12.0f;
+    G(x, y, 0, 1) = (I(x, y-2) - 8.0f * I(x, y-1) +
+                     8.0f * I(x, y+1) - I(x, y+2)) / 12.0f;
+  }
+};
+
+// Applies the stencil with zero padding. Only the pixels within RADIUS of 
+// the image boundary are bounds-checked, so the interior loop has no 
+// branches.
+template < class Stencil >
+static void computeStencil_(const CImg< float > &I, CImg< float > &G)
+{
+  const int W = I.width();
+  const int H = I.height();
+  const int R = Stencil::RADIUS;
+  const UncheckedAccess_ UNCHECKED(I);
+  const ZeroPaddedAccess_ PADDED(I);
+  
+  for(int y = 0; y < H; y++)
+  {
+    if(y < R || y >= H - R)
+    {
+      for(int x = 0; x < W; x++)
+        Stencil::apply(PADDED, x, y, G);
+      continue;
+    }
+    
+    const int X0 = min(R, W);
+    const int X1 = max(W - R, X0);
+    int x;
+    
+    for(x = 0; x < X0; x++)
+      Stencil::apply(PADDED, x, y, G);
+    for(; x < X1; x++)
+      Stencil::apply(UNCHECKED, x, y, G);
+    for(; x < W; x++)
+      Stencil::apply(PADDED, x, y, G);
+  }
+}
+
+FloatImagePyramid::FloatImagePyramid(const CImg< unsigned char > &I0, int n,
+                                     float intensityScale)
+{
+  assign(I0, n, intensityScale);
+}
+
+void FloatImagePyramid::assign(const CImg< unsigned char > &I0, int n,
+                               float intensityScale)
+{
+  assign_(I0, n, IntensityTransform(intensityScale));
+}
+
+void FloatImagePyramid::assign(const CImg< unsigned char > &I0, int n,
+                               const IntensityTransform &transform)
+{
+  assign_(I0, n, transform);
+}
+
+void FloatImagePyramid::assign(const CImg< unsigned short > &I0, int n,
+                               const IntensityTransform &transform)
+{
+  assign_(I0, n, transform);
+}
+
+void FloatImagePyramid::assign(const CImg< float > &I0, int n,
+                               const IntensityTransform &transform)
+{
+  assign_(I0, n, transform);
+}
+
+// Applies the transform to the source image. If L1 is not NULL, the second 
+// pyramid level is computed in the same pass: each pair of transformed rows 
+// is averaged while it is still in the cache.
+template < class T >
+static void transformBaseLevel_(const CImg< T > &I0,
+                                const IntensityTransform &transform,
+                                CImg< float > &L0,
+                                CImg< float > *L1)
+{
+  const int W = I0.width();
+  const int H = I0.height();
+  int x, y = 0;
+  
+  if(L1 != NULL)
+  {
+    const int W1 = L1->width();
+    const int H1 = L1->height();
+    
+    for(; y < 2 * H1; y += 2)
+    {
+      const T *src0 = I0.data(0, y);
+      const T *src1 = I0.data(0, y + 1);
+      float *dest0 = L0.data(0, y);
+      float *dest1 = L0.data(0, y + 1);
+      float *next = L1->data(0, y / 2);
+      
+      for(x = 0; x < W; x++)
+      {
+        dest0[x] = transform.apply(src0[x]);
+        dest1[x] = transform.apply(src1[x]);
+      }
+      for(x = 0; x < W1; x++)
+        next[x] = (dest0[2*x] + dest0[2*x+1] + dest1[2*x] + dest1[2*x+1]) / 4.0f;
+    }
+  }
+  
+  for(; y < H; y++)
+  {
+    const T *src = I0.data(0, y);
+    float *dest = L0.data(0, y);
+    
+    for(x = 0; x < W; x++)
+      dest[x] = transform.apply(src[x]);
+  }
+}
+
+template < class T >
+void FloatImagePyramid::assign_(const CImg< T > &I0, int n,
+                                const IntensityTransform &transform)
+{
+  int w = I0.width();
+  int h = I0.height();
+  // Smoothing must be done before downsampling, so the passes can be fused 
+  // only without it.
+  const bool FILTER = transform.getFilterStdDev() > 0.0;
+  
+  levels_.resize(n);
+  
+  levels_[0].assign(w, h);
+  if(n > 1)
+    levels_[1].assign(w / 2, h / 2);
+  
+  transformBaseLevel_(I0, transform, levels_[0], n > 1 && !FILTER ? &levels_[1] : NULL);
+  
+  if(FILTER)
+  {
+    levels_[0].blur((float)transform.getFilterStdDev());
+    if(n > 1)
+      computeNextLevel_(levels_[0], levels_[1]);
+  }
+  
+  w /= 2;
+  h /= 2;
+  for(int l = 2; l < n; l++)
+  {
+    w /= 2;
+    h /= 2;
+    
+    levels_[l].assign(w, h);
+    computeNextLevel_(levels_[l-1], levels_[l]);
+  }
+  
+  for(int s = 0; s < NUM_GRADIENT_STENCILS; s++)
+  {
+    gradients_[s].resize(n);
+    gradientsValid_[s].assign(n, false);
+  }
+}
+
+const CImg< float > &FloatImagePyramid::getGradientLevel(int i, GradientStencil stencil) const
+{
+  CImg< float > &G = gradients_[stencil][i];
+  
+  if(!gradientsValid_[stencil][i])
+  {
+    computeGradient_(levels_[i], stencil, G);
+    gradientsValid_[stencil][i] = true;
+  }
+  
+  return G;
+}
+
+const CImg< float > &FloatImagePyramid::getImageLevel(int i) const
+{
+  return levels_[i];
+}
+
+int FloatImagePyramid::getNumLevels() const
+{
+  return levels_.size();
+}
+
+void FloatImagePyramid::computeGradient_(const CImg< float > &I,
+                                         GradientStencil stencil,
+                                         CImg< float > &G) const
+{
+  const int W = I.width();
+  const int H = I.height();
+  int x, y;
+  
+  G.assign(W, H, 1, 2);
+  
+  if(stencil == FORWARD_2X2)
+  {
+    for(y = 0; y < H - 1; y++)
+    {
+      for(x = 0; x < W - 1; x++)
+      {
+        G(x, y, 0, 0) = (I(x+1, y) - I(x, y) + I(x+1, y+1) - I(x, y+1)) / 2.0f;
+        G(x, y, 0, 1) = (I(x, y+1) - I(x, y) + I(x+1, y+1) - I(x+1, y)) / 2.0f;
+      }
+    }
+    
+    // Copy edge values from neighbours.
+    for(y = 0; y < H; y++)
+    {
+      G(W-1, y, 0, 0) = W > 1 ? G(W-2, y, 0, 0) : 0.0f;
+      G(W-1, y, 0, 1) = W > 1 ? G(W-2, y, 0, 1) : 0.0f;
+    }
+    for(x = 0; x < W; x++)
+    {
+      G(x, H-1, 0, 0) = H > 1 ? G(x, H-2, 0, 0) : 0.0f;
+      G(x, H-1, 0, 1) = H > 1 ? G(x, H-2, 0, 1) : 0.0f;
+    }
+  }
+  else if(stencil == SOBEL_3X3)
+    computeStencil_< Sobel_ >(I, G);
+  else
+    computeStencil_< Central5_ >(I, G);
+}
+
+void FloatImagePyramid::computeNextLevel_(const CImg< float > &src,
+                                          CImg< float > &dest)
+{
+  const int DW = dest.width();
+  const int DH = dest.height();
+  
+  for(int y = 0; y < DH; y++)
+  {
+    for(int x = 0; x < DW; x++)
+    {
+      dest(x, y) = (src(2*x, 2*y)   + src(2*x+1, 2*y) +
+                    src(2*x, 2*y+1) + src(2*x+1, 2*y+1)) / 4.0f;
+    }
+  }
+}
@@ -0,0 +1,109 @@
+
+#ifndef FLOATIMAGEPYRAMID_H
+
+#include <vector>
+
+namespace cimg_library { template < class T > class CImg; }
+class IntensityTransform;
+
+using namespace cimg_library;
+using namespace std;
+
+/// Implements a floating-point image pyramid with cached gradient images.
+/**
+ * This class implements an image pyramid whose levels are stored as
+ * floating-point images, so that no precision is lost when averaging the
+ * levels. The pixel values are mapped to intensities when the first level 
+ * is constructed, either by scaling them (by default, 8-bit intensities 
+ * are mapped to [0,1]) or by an IntensityTransform. The source images can 
+ * be 8-bit, 16-bit or floating-point images. The transform is fused with 
+ * the construction of the first two levels, so no intermediate copies of 
+ * the source images are made.
+ *
+ * Gradient images of each level are computed on demand with the requested
+ * difference stencil and cached, so that each gradient is computed only once
+ * per level regardless of how many times it is requested.
+ */
+class FloatImagePyramid
+{
+public:
+  /// Difference stencils for computing gradients.
+  /**
+   * - FORWARD_2X2: forward differences averaged over a 2x2 neighbourhood
+   *   (Horn&Schunck), the last row and column are copied from their neighbours
+   * - SOBEL_3X3: 3x3 Sobel operator
+   * - CENTRAL_5: 5-point central differences
+   *
+   * The pixels outside the image are treated as zeros in the SOBEL_3X3 and
+   * CENTRAL_5 stencils.
+   */
+  enum GradientStencil { FORWARD_2X2, SOBEL_3X3, CENTRAL_5, NUM_GRADIENT_STENCILS };
+  
+  /// Constructs an empty image pyramid.
+  FloatImagePyramid();
+  
+  /// Constructs an n-level pyramid from a given source image.
+  /**
+   * @param I0 source image
+   * @param n number of levels
+   * @param intensityScale multiplier applied to the pixel values of I0
+   */
+  FloatImagePyramid(const CImg< unsigned char > &I0, int n,
+                    float intensityScale = 1.0f / 255.0f);
+  
+  /// Reconstructs this pyramid from a given source image.
+  /**
+   * The memory of the existing levels and gradient images is reused if the 
+   * dimensions of the source image and the number of levels do not change. 
+   * The cached gradients are invalidated.
+   * @param I0 source image
+   * @param n number of levels
+   * @param intensityScale multiplier applied to the pixel values of I0
+   */
+  void assign(const CImg< unsigned char > &I0, int n,
+              float intensityScale = 1.0f / 255.0f);
+  
+  /// Reconstructs this pyramid from a given 8-bit source image by using an intensity transform.
+  void assign(const CImg< unsigned char > &I0, int n,
+              const IntensityTransform &transform);
+  
+  /// Reconstructs this pyramid from a given 16-bit source image by using an intensity transform.
+  void assign(const CImg< unsigned short > &I0, int n,
+              const IntensityTransform &transform);
+  
+  /// Reconstructs this pyramid from a given floating-point source image by using an intensity transform.
+  void assign(const CImg< float > &I0, int n,
+              const IntensityTransform &transform);
+  
+  /// Returns a two-channel gradient image (x,y) of the ith level.
+  /**
+   * The gradient is computed by using the given stencil when it is requested
+   * for the first time. Subsequent requests return the cached image.
+   */
+  const CImg< float > &getGradientLevel(int i, GradientStencil stencil) const;
+  
+  /// Returns a reference to the ith level of this image pyramid.
+  const CImg< float > &getImageLevel(int i) const;
+  
+  /// Returns the number of levels in this image pyramid.
+  int getNumLevels() const;
+private:
+  vector< CImg< float > > levels_;
+  mutable vector< CImg< float > > gradients_[NUM_GRADIENT_STENCILS];
+  mutable vector< bool > gradientsValid_[NUM_GRADIENT_STENCILS];
+  
+  template < class T >
+  void assign_(const CImg< T > &I0, int n,
+               const IntensityTransform &transform);
+  
+  void computeGradient_(const CImg< float > &I,
+                        GradientStencil stencil,
+                        CImg< float > &G) const;
+  
+  void computeNextLevel_(const CImg< float > &src,
+                         CImg< float > &dest);
+};
+
+#define FLOATIMAGEPYRAMID_H
+
+#endif
@@ -0,0 +1,285 @@
+
+#include "ForwardDenseImageExtrapolator.h"
+#include "WarpSampling.h"
+
+#include "CImg_config.h"
+#include <CImg.h>
+#include <algorithm>
+#include <math.h>
+#include <stdexcept>
+#include <vector>
+#ifdef WITH_OPENMP
+#include <omp.h>
+#endif
+
+using namespace cimg_library;
+using namespace std;
+
+// The splatted values and weights of the destination rows y0,...,y1-1.
+struct SplatBuffer_
+{
+  int y0, y1;
+  vector< float > values;
+  vector< float > weights;
+};
+
+// Splats the source rows ys,...,ye-1 into the given buffer.
+template < class T >
+static void splat_(const CImg< T > &I0,
+                   const CImg< double > &V,
+                   double t,
+                   int ys,
+                   int ye,
+                   SplatBuffer_ &B)
+{
+  const int W = I0.width();
+  const int H = I0.height();
+  double minY = H, maxY = -1.0;
+  int x, y;
+  
+  // Allocate only the destination rows reachable from the source rows. 
+  // Destinations outside the image are not splatted, and NaN coordinates 
+  // fail the comparisons, so they do not affect the range.
+  for(y = ys; y < ye; y++)
+  {
+    const double *v = V.data(0, y, 0, 1);
+    for(x = 0; x < W; x++)
+    {
+      const double YD = y + t * v[x];
+      
+      if(YD > -1.0 && YD < H)
+      {
+        minY = min(minY, YD);
+        maxY = max(maxY, YD);
+      }
+    }
+  }
+  
+  // The range is clamped to [-1,H] before the conversion so that it fits 
+  // into an int.
+  minY = min(max(minY, -1.0), (double)H);
+  maxY = min(max(maxY, -1.0), (double)H);
+  B.y0 = max((int)floor(minY), 0);
+  B.y1 = min((int)floor(maxY) + 2, H);
+  if(B.y1 <= B.y0)
+  {
+    B.y0 = B.y1 = 0;
+    return;
+  }
+  B.values.assign((size_t)(B.y1 - B.y0) * W, 0.0f);
+  B.weights.assign((size_t)(B.y1 - B.y0) * W, 0.0f);
+  
+  for(y = ys; y < ye; y++)
+  {
+    const T *src = I0.data(0, y);
+    const double *u = V.data(0, y, 0, 0);
+    const double *v = V.data(0, y, 0, 1);
+    
+    for(x = 0; x < W; x++)
+    {
+      const double XD = x + t * u[x];
+      const double YD = y + t * v[x];
+      
+      // Non-finite destinations fail the comparisons and are skipped.
+      if(!(XD > -1.0 && XD < W && YD > -1.0 && YD < H))
+        continue;
+      
+      const int X0 = (int)floor(XD);
+      const int Y0 = (int)floor(YD);
+      const float FX = (float)(XD - X0);
+      const float FY = (float)(YD - Y0);
+      const float VALUE = (float)src[x];
+      const float WEIGHTS[4] = { (1.0f - FX) * (1.0f - FY), FX * (1.0f - FY),
+                                 (1.0f - FX) * FY,          FX * FY };
+      
+      for(int i = 0; i < 4; i++)
+      {
+        const int XI = X0 + i % 2;
+        const int YI = Y0 + i / 2;
+        
+        if(XI >= 0 && XI < W && YI >= B.y0 && YI < B.y1)
+        {
+          const size_t OFFSET = (size_t)(YI - B.y0) * W + XI;
+          B.values[OFFSET]  += WEIGHTS[i] * VALUE;
+          B.weights[OFFSET] += WEIGHTS[i];
+        }
+      }
+    }
+  }
+}
+
+// Fills the pixels having weight less than one by interpolating a coarser 
+// level of the image. C contains the normalized values and Wt the weights 
+// clamped to [0,1]. The coarser level is computed recursively until there 
+// are no holes left.
+static void pushPull_(CImg< float > &C, CImg< float > &Wt)
+{
+  const int W = C.width();
+  const int H = C.height();
+  bool holes = false;
+  
+  for(size_t i = 0; i < C.size(); i++)
+  {
+    if(Wt[i] < 1.0f)
+    {
+      holes = true;
+      break;
+    }
+  }
+  if(!holes || (W == 1 && H == 1))
+    return;
+  
+  const int W2 = (W + 1) / 2;
+  const int H2 = (H + 1) / 2;
+  CImg< float > C2(W2, H2), Wt2(W2, H2);
+  
+  // push: the weighted average of the 2x2 children
+#pragma omp parallel for schedule(static)
+  for(int y = 0; y < H2; y++)
+  {
+    for(int x = 0; x < W2; x++)
+    {
+      float ws = 0.0f, cs = 0.0f;
+      
+      for(int i = 0; i < 4; i++)
+      {
+        const int XI = 2 * x + i % 2;
+        const int YI = 2 * y + i / 2;
+        
+        if(XI < W && YI < H)
+        {
+          ws += Wt(XI, YI);
+          cs += Wt(XI, YI) * C(XI, YI);
+        }
+      }
+      C2(x, y)  = ws > 0.0f ? cs / ws : 0.0f;
+      Wt2(x, y) = min(ws, 1.0f);
+    }
+  }
+  
+  pushPull_(C2, Wt2);
+  
+  // pull: blend the holes with the bilinearly upsampled coarser level
+#pragma omp parallel for schedule(static)
+  for(int y = 0; y < H; y++)
+  {
+    const float YC = min(max(0.5f * y - 0.25f, 0.0f), H2 - 1.0f);
+    const int Y0 = (int)YC;
+    const int Y1 = min(Y0 + 1, H2 - 1);
+    const float FY = YC - Y0;
+    
+    for(int x = 0; x < W; x++)
+    {
+      const float WEIGHT = Wt(x, y);
+      if(WEIGHT >= 1.0f)
+        continue;
+      
+      const float XC = min(max(0.5f * x - 0.25f, 0.0f), W2 - 1.0f);
+      const int X0 = (int)XC;
+      const int X1 = min(X0 + 1, W2 - 1);
+      const float FX = XC - X0;
+      const float C0 = C2(X0, Y0) + FX * (C2(X1, Y0) - C2(X0, Y0));
+      const float C1 = C2(X0, Y1) + FX * (C2(X1, Y1) - C2(X0, Y1));
+      
+      C(x, y) = WEIGHT * C(x, y) + (1.0f - WEIGHT) * (C0 + FY * (C1 - C0));
+      Wt(x, y) = 1.0f;
+    }
+  }
+}
+
+template < class T >
+static void extrapolate_(const CImg< T > &I0,
+                         const CImg< double > &V,
+                         double t,
+                         CImg< T > &Ie)
+{
+  const int W = I0.width();
+  const int H = I0.height();
+  
+  if(V.width() != W || V.height() != H || V.spectrum() < 2)
+    throw invalid_argument("The image and the motion field must have the same dimensions.");
+  
+  CImg< float > C(W, H), Wt(W, H);
+  vector< SplatBuffer_ > buffers;
+
+#pragma omp parallel
+  {
+#ifdef WITH_OPENMP
+    const int NUM_THREADS = omp_get_num_threads();
+    const int THREAD = omp_get_thread_num();
+#else
+    const int NUM_THREADS = 1;
+    const int THREAD = 0;
+#endif
+
+#pragma omp single
+    buffers.resize(NUM_THREADS);
+    
+    splat_(I0, V, t, (int)((long long)THREAD * H / NUM_THREADS),
+           (int)((long long)(THREAD + 1) * H / NUM_THREADS), buffers[THREAD]);
+
+#pragma omp barrier
+    
+    // Sum the buffers and normalize the splatted values.
+#pragma omp for schedule(static)
+    for(int y = 0; y < H; y++)
+    {
+      float *c = C.data(0, y);
+      float *w = Wt.data(0, y);
+      int x;
+      
+      fill(c, c + W, 0.0f);
+      fill(w, w + W, 0.0f);
+      for(size_t i = 0; i < buffers.size(); i++)
+      {
+        const SplatBuffer_ &B = buffers[i];
+        if(y < B.y0 || y >= B.y1)
+          continue;
+        
+        const float *bc = &B.values[(size_t)(y - B.y0) * W];
+        const float *bw = &B.weights[(size_t)(y - B.y0) * W];
+        for(x = 0; x < W; x++)
+        {
+          c[x] += bc[x];
+          w[x] += bw[x];
+        }
+      }
+      
+      for(x = 0; x < W; x++)
+      {
+        c[x] = w[x] > 0.0f ? c[x] / w[x] : 0.0f;
+        w[x] = min(w[x], 1.0f);
+      }
+    }
+  }
+  
+  pushPull_(C, Wt);
+  
+  Ie.assign(W, H, 1, 1);
+  for(size_t i = 0; i < C.size(); i++)
+    Ie[i] = WarpSampling::toPixel< T >(C[i]);
+}
+
+void ForwardDenseImageExtrapolator::extrapolate(const CImg< unsigned char > &I0,
+                                                const CImg< double > &V,
+                                                double t,
+                                                CImg< unsigned char > &Ie) const
+{
+  extrapolate_(I0, V, t, Ie);
+}
+
+void ForwardDenseImageExtrapolator::extrapolate(const CImg< unsigned short > &I0,
+                                                const CImg< double > &V,
+                                                double t,
+                                                CImg< unsigned short > &Ie) const
+{
+  extrapolate_(I0, V, t, Ie);
+}
+
+void ForwardDenseImageExtrapolator::extrapolate(const CImg< float > &I0,
+                                                const CImg< double > &V,
+                                                double t,
+                                                CImg< float > &Ie) const
+{
+  extrapolate_(I0, V, t, Ie);
+}
@@ -3,8 +3,6 @@
 
 #include "DenseImageExtrapolator.h"
 
-// TODO: This is not implemented.
-
 /// Implements forward image extrapolation with dense motion fields.
 /**
  * Forward image extrapolation by computing the coordinates of each pixel in 
@@ -12,6 +10,19 @@
  * motion field between two images. All pixels in the destination image do not 
  * necessarily get a value. Hence, additional postprocessing is needed for 
  * filling the "holes".
+ *
+ * Each source pixel is splatted to its displaced location with bilinear 
+ * weights, and the destination pixels are normalized by the sum of the 
+ * weights they received. Differently to InverseDenseImageExtrapolator, 
+ * this uses a forward motion field (image1->image2), and diverging motion 
+ * does not duplicate image features. The holes are filled by a multiscale 
+ * push-pull pass: the splatted image is downsampled until the holes are 
+ * covered, and the holes are filled by interpolating the coarser levels.
+ *
+ * The source rows are divided between the threads, and each thread 
+ * splats into its own buffer covering the destination rows it can reach. 
+ * The buffers are then summed row by row, so no atomic operations are 
+ * needed.
  */
 class ForwardDenseImageExtrapolator : public DenseImageExtrapolator
 {
@@ -20,6 +31,16 @@ public:
                    const CImg< double > &V,
                    double t,
                    CImg< unsigned char > &Ie) const;
+  
+  void extrapolate(const CImg< unsigned short > &I0,
+                   const CImg< double > &V,
+                   double t,
+                   CImg< unsigned short > &Ie) const;
+  
+  void extrapolate(const CImg< float > &I0,
+                   const CImg< double > &V,
+                   double t,
+                   CImg< float > &Ie) const;
 };
 
 #define FORWARDDENSEIMAGEEXTRAPOLATOR_H
@@ -1,13 +1,14 @@
 
+#include <algorithm>
 #include <iostream>
 
 #include "HornSchunck.h"
 
 HornSchunck::HornSchunck() : BOUNDARY_CONDITIONS_(NEUMANN),
-                             INTENSITY_SCALE_(1.0 / 255.0),
                              ALPHA_(75.0),
                              RELAX_COEFF_(1.95),
-                             NUM_ITERATIONS_(200)
+                             NUM_ITERATIONS_(200),
+                             verbose_(true)
 { }
 
 HornSchunck::HornSchunck(int numIterations_,
@@ -15,63 +16,94 @@ HornSchunck::HornSchunck(int numIterations_,
                          double relaxCoeff_,
                          BoundaryConditions boundaryConditions_) : 
   BOUNDARY_CONDITIONS_(boundaryConditions_),
-  INTENSITY_SCALE_(1.0 / 255.0),
   ALPHA_(alpha_),
   RELAX_COEFF_(relaxCoeff_),
-  NUM_ITERATIONS_(numIterations_)
+  NUM_ITERATIONS_(numIterations_),
+  verbose_(true)
 { }
 
 void HornSchunck::compute(const CImg< unsigned char > &I1,
                           const CImg< unsigned char > &I2,
                           CImg< double > &V)
 {
-  int x, y, i;
+  FloatImagePyramid P1(I1, 1);
+  FloatImagePyramid P2(I2, 1);
+  CImg< double > VB; // not used
+  
+  computeLevel(P1, P2, 0, V, VB, NULL);
+}
+
+void HornSchunck::computeLevel(const FloatImagePyramid &P1,
+                               const FloatImagePyramid &P2,
+                               int level,
+                               CImg< double > &VF,
+                               CImg< double > &VB,
+                               const ActiveRegion *activeRegion)
+{
+  int x, y, i, s;
   double uAvg, vAvg;
   double numer, denom;
   
-  width_  = I1.width();
-  height_ = I1.height();
+  I_[0].assign(P1.getImageLevel(level), true);
+  I_[1].assign(P2.getImageLevel(level), true);
+  
+  width_  = I_[0].width();
+  height_ = I_[0].height();
+  
+  if(activeRegion == NULL)
+  {
+    fullRegion_.assign(width_, height_);
+    activeRegion = &fullRegion_;
+  }
   
   CImg< double > V_;
-  V_.assign(V, true);
+  V_.assign(VF, true);
   
-  computeGradients_(I1, I2);
+  computeGradients_(P1.getGradientLevel(level, FloatImagePyramid::FORWARD_2X2),
+                    P2.getGradientLevel(level, FloatImagePyramid::FORWARD_2X2));
   
   for(i = 0; i < NUM_ITERATIONS_; i++)
   {
     for(y = 1; y < height_ - 1; y++)
     {
-      //#pragma omp parallel for ordered schedule(static) shared(V_) private(numer,denom,uAvg,vAvg)
-      for(x = 1; x < width_ - 1; x++)
+      const vector< pair< int, int > > &spans = activeRegion->getRowSpans(y);
+      
+      for(s = 0; s < (int)spans.size(); s++)
       {
-        uAvg = (V_(x, y-1, 0)   + V_(x+1, y, 0) + 
-                V_(x, y+1, 0)   + V_(x-1, y, 0)) / 6.0 + 
-               (V_(x-1, y-1, 0) + V_(x+1, y-1, 0) + 
-                V_(x-1, y+1, 0) + V_(x+1, y+1, 0)) / 12.0;
-        
-        vAvg = (V_(x, y-1, 1)   + V_(x+1, y, 1) + 
-                V_(x, y+1, 1)   + V_(x-1, y, 1)) / 6.0 + 
-               (V_(x-1, y-1, 1) + V_(x+1, y-1, 1) + 
-                V_(x-1, y+1, 1) + V_(x+1, y+1, 1)) / 12.0;
-        
-        numer = Gx_(x, y)*uAvg + Gy_(x, y)*vAvg + Gt_(x, y);
-        denom = ALPHA_*ALPHA_ + Gx_(x, y)*Gx_(x, y) + Gy_(x, y)*Gy_(x, y);
-        
-        //#pragma omp ordered
-        V_(x, y, 0) = (1.0 - RELAX_COEFF_) * V_(x, y, 0) + 
-                      RELAX_COEFF_ * (uAvg - Gx_(x, y)*numer/denom);
-        V_(x, y, 1) = (1.0 - RELAX_COEFF_) * V_(x, y, 1) + 
-                      RELAX_COEFF_ * (vAvg - Gy_(x, y)*numer/denom);
-        V_(x, y, 2) = 1.0;
+        //#pragma omp parallel for ordered schedule(static) shared(V_) private(numer,denom,uAvg,vAvg)
+        for(x = max(spans[s].first, 1); x < min(spans[s].second, width_ - 1); x++)
+        {
+          uAvg = (V_(x, y-1, 0)   + V_(x+1, y, 0) + 
+                  V_(x, y+1, 0)   + V_(x-1, y, 0)) / 6.0 + 
+                 (V_(x-1, y-1, 0) + V_(x+1, y-1, 0) + 
+                  V_(x-1, y+1, 0) + V_(x+1, y+1, 0)) / 12.0;
+          
+          vAvg = (V_(x, y-1, 1)   + V_(x+1, y, 1) + 
+                  V_(x, y+1, 1)   + V_(x-1, y, 1)) / 6.0 + 
+                 (V_(x-1, y-1, 1) + V_(x+1, y-1, 1) + 
+                  V_(x-1, y+1, 1) + V_(x+1, y+1, 1)) / 12.0;
+          
+          numer = Gx_(x, y)*uAvg + Gy_(x, y)*vAvg + Gt_(x, y);
+          denom = ALPHA_*ALPHA_ + Gx_(x, y)*Gx_(x, y) + Gy_(x, y)*Gy_(x, y);
+          
+          //#pragma omp ordered
+          V_(x, y, 0) = (1.0 - RELAX_COEFF_) * V_(x, y, 0) + 
+                        RELAX_COEFF_ * (uAvg - Gx_(x, y)*numer/denom);
+          V_(x, y, 1) = (1.0 - RELAX_COEFF_) * V_(x, y, 1) + 
+                        RELAX_COEFF_ * (vAvg - Gy_(x, y)*numer/denom);
+          V_(x, y, 2) = 1.0;
+        }
       }
     }
     
     repairEdges_(V_);
     
-    printProgressBar_(1.0*i / (NUM_ITERATIONS_ - 1));
+    if(verbose_)
+      printProgressBar_(1.0*i / (NUM_ITERATIONS_ - 1));
   }
   
-  std::cout<<std::endl;
+  if(verbose_)
+    std::cout<<std::endl;
 }
 
 void HornSchunck::printInfoText() const
@@ -92,54 +124,44 @@ void HornSchunck::printInfoText() const
     cout<<"Dirichlet"<<endl;
 }
 
-void HornSchunck::computeGradients_(const CImg< unsigned char > &I1,
-                                    const CImg< unsigned char > &I2)
+void HornSchunck::computeGradients_(const CImg< float > &G1,
+                                    const CImg< float > &G2)
 {
   int x, y;
-  double I00, I10, I20, I30; 
-  double I01, I11, I21, I31;
-  
-  Gx_ = CImg< double >(width_, height_);
-  Gx_.fill(0);
-  Gy_ = CImg< double >(width_, height_);
-  Gy_.fill(0);
-  Gt_ = CImg< double >(width_, height_);
+  
+  workspace_.getImage(GX_BUFFER, width_, height_, 1, Gx_);
+  workspace_.getImage(GY_BUFFER, width_, height_, 1, Gy_);
+  workspace_.getImage(GT_BUFFER, width_, height_, 1, Gt_);
   Gt_.fill(0);
   
+  // The spatial derivatives are averages of the 2x2 forward differences 
+  // of both images.
+  for(y = 0; y < height_; y++)
+  {
+    for(x = 0; x < width_; x++)
+    {
+      Gx_(x, y) = (G1(x, y, 0, 0) + G2(x, y, 0, 0)) / 2.0;
+      Gy_(x, y) = (G1(x, y, 0, 1) + G2(x, y, 0, 1)) / 2.0;
+    }
+  }
+  
   for(y = 0; y < height_-1; y++)
   {
     for(x = 0; x < width_-1; x++)
     {
-      I00 = I1(x, y) * INTENSITY_SCALE_;
-      I10 = I1(x+1, y) * INTENSITY_SCALE_;
-      I20 = I1(x, y+1) * INTENSITY_SCALE_;
-      I30 = I1(x+1, y+1) * INTENSITY_SCALE_;
-      
-      I01 = I2(x, y) * INTENSITY_SCALE_;
-      I11 = I2(x+1, y) * INTENSITY_SCALE_;
-      I21 = I2(x, y+1) * INTENSITY_SCALE_;
-      I31 = I2(x+1, y+1) * INTENSITY_SCALE_;
-      
-      Gx_(x, y) = (I10 - I00 + I30 - I20 + I11 - I01 + I31 - I21) / 4.0;
-      Gy_(x, y) = (I20 - I00 + I30 - I10 + I21 - I01 + I31 - I11) / 4.0;
-      Gt_(x, y) = (I01 - I00 + I11 - I10 + I21 - I20 + I31 - I30) / 4.0;
+      Gt_(x, y) = (I_[1](x, y)   - I_[0](x, y)   + I_[1](x+1, y)   - I_[0](x+1, y) + 
+                   I_[1](x, y+1) - I_[0](x, y+1) + I_[1](x+1, y+1) - I_[0](x+1, y+1)) / 4.0;
     }
   }
   
   // Copy edge values from neighbours.
-  for(y = 0; y < height_; y++)
-  {
-    Gx_(x, height_-1) = Gx_(x, height_-2);
-    Gy_(x, height_-1) = Gy_(x, height_-2);
-    Gt_(x, height_-1) = Gt_(x, height_-2);
-  }
+  if(width_ > 1)
+    for(y = 0; y < height_; y++)
+      Gt_(width_-1, y) = Gt_(width_-2, y);
   
-  for(y = 0; y < width_; y++)
-  {
-    Gx_(width_-1, y) = Gx_(width_-2, y);
-    Gy_(width_-1, y) = Gy_(width_-2, y);
-    Gt_(width_-1, y) = Gt_(width_-2, y);
-  }
+  if(height_ > 1)
+    for(x = 0; x < width_; x++)
+      Gt_(x, height_-1) = Gt_(x, height_-2);
 }
 
 void HornSchunck::printProgressBar_(double pct)
@@ -1,7 +1,10 @@
 
 #ifndef HORNSCHUNCK_H
 
+#include "ActiveRegion.h"
 #include "DenseMotionExtractor.h"
+#include "FloatImagePyramid.h"
+#include "Workspace.h"
 
 #include "CImg_config.h"
 #include <CImg.h>
@@ -42,6 +45,13 @@ public:
                const CImg< unsigned char > &I2,
                CImg< double > &V);
   
+  void computeLevel(const FloatImagePyramid &P1,
+                    const FloatImagePyramid &P2,
+                    int level,
+                    CImg< double > &VF,
+                    CImg< double > &VB,
+                    const ActiveRegion *activeRegion);
+  
   double getAlpha() const { return ALPHA_; }
   
   BoundaryConditions getBoundaryConditions() const { return BOUNDARY_CONDITIONS_; }
@@ -57,20 +67,26 @@ public:
   bool isDual() const { return false; }
   
   void printInfoText() const;
+  
+  void setVerbose(bool verbose) { verbose_ = verbose; }
 private:
   const double ALPHA_;
   const BoundaryConditions BOUNDARY_CONDITIONS_;
-  const double INTENSITY_SCALE_;
   const int NUM_ITERATIONS_;
   const double RELAX_COEFF_;
+  bool verbose_;
+  
+  enum WorkspaceBuffers { GX_BUFFER, GY_BUFFER, GT_BUFFER };
   
-  CImg< unsigned char > I_[2];
+  ActiveRegion fullRegion_;
+  CImg< float > I_[2];
   CImg< double > Gx_, Gy_, Gt_;
+  Workspace workspace_;
   
   int width_, height_;
   
-  void computeGradients_(const CImg< unsigned char > &I1,
-                         const CImg< unsigned char > &I2);
+  void computeGradients_(const CImg< float > &G1,
+                         const CImg< float > &G2);
   
   void printProgressBar_(double pct);
   
@@ -8,6 +8,138 @@
 #include <iomanip>
 #include <sstream>
 #include <stdexcept>
+#ifdef WITH_OPENMP
+#include <omp.h>
+#endif
+
+static AsyncImageWriter::Options imageWriterOptions_;
+static int numThreads_ = 0;
+
+// Computes one step of a dense extrapolation.
+struct DenseStep_
+{
+  const DenseImageExtrapolator &e;
+  const CImg< unsigned char > &I0;
+  const CImg< double > &V;
+  
+  void operator()(int t, CImg< unsigned char > &Ie) const
+  {
+    e.extrapolate(I0, V, t, Ie);
+  }
+};
+
+#ifdef WITH_CGAL
+// Computes one step of a sparse extrapolation.
+struct SparseStep_
+{
+  const SparseImageExtrapolator &e;
+  const CImg< unsigned char > &I0;
+  const SparseVectorField &V;
+  
+  void operator()(int t, CImg< unsigned char > &Ie) const
+  {
+    e.extrapolate(I0, V, t, Ie);
+  }
+};
+
+// Computes one step of a sparse extrapolation from a dense motion field.
+struct SparseGridStep_
+{
+  const SparseImageExtrapolator &e;
+  const CImg< unsigned char > &I0;
+  const CImg< double > &V;
+  double spacing;
+  
+  void operator()(int t, CImg< unsigned char > &Ie) const
+  {
+    e.extrapolate(I0, V, t, spacing, Ie);
+  }
+};
+#endif
+
+// Computes the steps 1,...,numSteps in parallel and writes the results in 
+// order. Each thread computes one image at a time, and the image is copied 
+// to the writer before the thread proceeds to its next step. Thus, the 
+// number of images held in memory is bounded by the number of threads and 
+// the queue size of the writer.
+template < class Step >
+static void runSteps_(const Step &step,
+                      const CImg< unsigned char > &I0,
+                      int numSteps,
+                      const string &resultFileNamePrefix)
+{
+  AsyncImageWriter writer(imageWriterOptions_);
+  bool failed = false;
+  string errorMessage;
+#ifdef WITH_OPENMP
+  const int NUM_THREADS = numThreads_ > 0 ? numThreads_ : omp_get_max_threads();
+
+#pragma omp parallel num_threads(NUM_THREADS)
+#endif
+  {
+    CImg< unsigned char > Ie = I0;
+    ostringstream ostr;
+
+#pragma omp for ordered schedule(static, 1)
+    for(int t = 1; t <= numSteps; t++)
+    {
+      string stepError;
+      
+      try
+      {
+        step(t, Ie);
+      }
+      catch(exception &e)
+      {
+        stepError = e.what();
+      }
+      
+      // The ordered sections are executed one at a time in the order of 
+      // the steps, so the error state needs no further synchronization.
+#pragma omp ordered
+      {
+        if(!failed && !stepError.empty())
+        {
+          failed = true;
+          errorMessage = stepError;
+        }
+        else if(!failed)
+        {
+          ostr.clear();
+          ostr.str("");
+          ostr<<setfill('0')<<setw(2)<<t;
+          try
+          {
+            writer.write(Ie, resultFileNamePrefix + "-extrapolated-" + ostr.str() + ".png");
+          }
+          catch(exception &e)
+          {
+            failed = true;
+            errorMessage = e.what();
+          }
+        }
+      }
+    }
+  }
+  
+  if(failed)
+    throw runtime_error(errorMessage);
+  
+  writer.close();
+}
+
+void ImageExtrapolatorDriver::setImageWriterOptions(const AsyncImageWriter::Options &options)
+{
+  imageWriterOptions_ = options;
+}
+
+void ImageExtrapolatorDriver::setNumThreads(int numThreads)
+{
+  if(numThreads < 0)
+    throw invalid_argument("The number of threads must be nonnegative.");
+  
+  numThreads_ = numThreads;
+}
 
 void ImageExtrapolatorDriver::runDenseImageExtrapolator(const DenseImageExtrapolator &e,
                                                         const CImg< unsigned char > &I0,
@@ -15,17 +147,8 @@ void ImageExtrapolatorDriver::runDenseImageExtrapolator(const DenseImageExtrapol
                                                         int numSteps,
                                                         const string &resultFileNamePrefix)
 {
-  CImg< unsigned char > Ie = I0;
-  ostringstream ostr;
-  
-  for(int t = 1; t <= numSteps; t++)
-  {
-    e.extrapolate(I0, V, t, Ie);
-    ostr.clear();
-    ostr.str("");
-    ostr<<setfill('0')<<setw(2)<<t;
-    Ie.save_png((resultFileNamePrefix + "-extrapolated-" + ostr.str() + ".png").c_str());
-  }
+  const DenseStep_ STEP = { e, I0, V };
+  runSteps_(STEP, I0, numSteps, resultFileNamePrefix);
 }
 
 #ifdef WITH_CGAL
@@ -36,17 +159,8 @@ void ImageExtrapolatorDriver::runSparseImageExtrapolator(const SparseImageExtrap
                                                          int numSteps,
                                                          const string &resultFileNamePrefix)
 {
-  CImg< unsigned char > Ie = I0;
-  ostringstream ostr;
-  
-  for(int t = 1; t <= numSteps; t++)
-  {
-    e.extrapolate(I0, V, t, Ie);
-    ostr.clear();
-    ostr.str("");
-    ostr<<setfill('0')<<setw(2)<<t;
-    Ie.save_png((resultFileNamePrefix + "-extrapolated-" + ostr.str() + ".png").c_str());
-  }
+  const SparseStep_ STEP = { e, I0, V };
+  runSteps_(STEP, I0, numSteps, resultFileNamePrefix);
 }
 
 void ImageExtrapolatorDriver::runSparseImageExtrapolator(const SparseImageExtrapolator &e,
@@ -56,17 +170,8 @@ void ImageExtrapolatorDriver::runSparseImageExtrapolator(const SparseImageExtrap
                                                          double spacing,
                                                          const string &resultFileNamePrefix)
 {
-  CImg< unsigned char > Ie = I0;
-  ostringstream ostr;
-  
-  for(int t = 1; t <= numSteps; t++)
-  {
-    e.extrapolate(I0, V, t, spacing, Ie);
-    ostr.clear();
-    ostr.str("");
-    ostr<<setfill('0')<<setw(2)<<t;
-    Ie.save_png((resultFileNamePrefix + "-extrapolated-" + ostr.str() + ".png").c_str());
-  }
+  const SparseGridStep_ STEP = { e, I0, V, spacing };
+  runSteps_(STEP, I0, numSteps, resultFileNamePrefix);
 }
 
 #endif
@@ -1,6 +1,8 @@
 
 #ifndef EXTRAPOLATORDRIVER_H
 
+#include "AsyncImageWriter.h"
+
 #include <string>
 
 namespace cimg_library { template < class T > class CImg; }
@@ -16,10 +18,29 @@ using namespace std;
 /**
  * The names of the warped images are of the form [prefix]-[n].png, where 
  * n is the index of the image in the warped sequence.
+ *
+ * The images are written asynchronously by an AsyncImageWriter, so that 
+ * the next image is computed while the previous ones are being compressed.
+ *
+ * If compiled with OpenMP, the steps of a sequence are computed in 
+ * parallel. The images are still written in the order of the steps, and 
+ * each thread holds at most one image that has not been passed to the 
+ * writer.
  */
 class ImageExtrapolatorDriver
 {
 public:
+  /// Sets the options of the writer used for the result images.
+  static void setImageWriterOptions(const AsyncImageWriter::Options &options);
+  
+  /// Sets the number of steps computed in parallel (0=number of processors).
+  /**
+   * This also bounds the number of result images held in memory in 
+   * addition to the queue of the writer. Throws invalid_argument if 
+   * numThreads is negative.
+   */
+  static void setNumThreads(int numThreads);
+  
   /// Runs a dense image extrapolator.
   /**
    * @param e image extrapolation algorithm
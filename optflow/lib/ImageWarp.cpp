@@ -0,0 +1,322 @@
+
+#include "ImageWarp.h"
+#include "WarpSampling.h"
+
+#include "CImg_config.h"
+#include <CImg.h>
+#include <algorithm>
+#include <math.h>
+#include <stdexcept>
+#include <string.h>
+
+// The resolution of the kernel weight tables (entries per pixel).
+static const int TABLE_RES = 256;
+
+// Catmull-Rom cubic convolution kernel (a=-0.5).
+static double bicubic_(double t)
+{
+  t = fabs(t);
+  if(t < 1.0)
+    return (1.5 * t - 2.5) * t * t + 1.0;
+  else if(t < 2.0)
+    return ((-0.5 * t + 2.5) * t - 4.0) * t + 2.0;
+  else
+    return 0.0;
+}
+
+// Lanczos kernel with two lobes (a=2).
+static double lanczos_(double t)
+{
+  t = fabs(t);
+  if(t < 1e-12)
+    return 1.0;
+  else if(t < 2.0)
+    return 2.0 * sin(M_PI * t) * sin(M_PI * t / 2.0) / (M_PI * M_PI * t * t);
+  else
+    return 0.0;
+}
+
+// The weights of the four taps at the fractional positions i/TABLE_RES, 
+// normalized to unit sum.
+struct KernelTable_
+{
+  explicit KernelTable_(double (*kernel)(double))
+  {
+    for(int i = 0; i <= TABLE_RES; i++)
+    {
+      const double F = (double)i / TABLE_RES;
+      double sum = 0.0;
+      
+      for(int j = 0; j < 4; j++)
+        sum += kernel(F + 1.0 - j);
+      for(int j = 0; j < 4; j++)
+        weights[i][j] = (float)(kernel(F + 1.0 - j) / sum);
+    }
+  }
+  
+  float weights[TABLE_RES + 1][4];
+};
+
+static const KernelTable_ BICUBIC_TABLE_(bicubic_);
+static const KernelTable_ LANCZOS_TABLE_(lanczos_);
+
+// Sets the out-of-domain pixels of a destination row to the fill value.
+template < class T >
+static inline void fillRow_(T *dest, const unsigned char *valid, int W, T fillValue)
+{
+  for(int x = 0; x < W; x++)
+  {
+    if(!valid[x])
+      dest[x] = fillValue;
+  }
+}
+
+ImageWarp::ImageWarp() : width_(0), height_(0), interpolation_(BILINEAR),
+  outOfDomain_(CLAMP), fillValue_(0.0f) { }
+
+ImageWarp::ImageWarp(const CImg< double > &V, double multiplier,
+                     Interpolation interpolation) : 
+  width_(0), height_(0), interpolation_(BILINEAR), outOfDomain_(CLAMP),
+  fillValue_(0.0f)
+{
+  assign(V, multiplier, interpolation);
+}
+
+void ImageWarp::assign(const CImg< double > &V, double multiplier,
+                       Interpolation interpolation)
+{
+  const int W = V.width();
+  const int H = V.height();
+  // For bilinear interpolation, the upper-left pixel is chosen so that its 
+  // right and lower neighbours are always within the image, and the weight 
+  // is one at the right and lower edges. The four-tap kernels read the 
+  // padded image, which has one extra column and row before the image and 
+  // two after it.
+  const bool IS_BILINEAR = interpolation == BILINEAR;
+  const int MAX_X0 = IS_BILINEAR ? max(W - 2, 0) : W - 1;
+  const int MAX_Y0 = IS_BILINEAR ? max(H - 2, 0) : H - 1;
+  const int STRIDE = IS_BILINEAR ? W : W + 3;
+  
+  if(V.spectrum() < 2)
+    throw invalid_argument("The motion field must have two channels.");
+  
+  width_  = W;
+  height_ = H;
+  interpolation_ = interpolation;
+  offsets_.resize((size_t)W * H);
+  wx_.resize((size_t)W * H);
+  wy_.resize((size_t)W * H);
+  valid_.resize((size_t)W * H);
+
+#pragma omp parallel for schedule(static)
+  for(int y = 0; y < H; y++)
+  {
+    const double *u = V.data(0, y, 0, 0);
+    const double *v = V.data(0, y, 0, 1);
+    const size_t ROW = (size_t)y * W;
+    
+    for(int x = 0; x < W; x++)
+    {
+      const double XS = x + multiplier * u[x];
+      const double YS = y + multiplier * v[x];
+      const double XC = WarpSampling::clampCoordinate(XS, W);
+      const double YC = WarpSampling::clampCoordinate(YS, H);
+      const int X0 = min((int)XC, MAX_X0);
+      const int Y0 = min((int)YC, MAX_Y0);
+      
+      offsets_[ROW + x] = Y0 * STRIDE + X0;
+      wx_[ROW + x] = (float)(XC - X0);
+      wy_[ROW + x] = (float)(YC - Y0);
+      valid_[ROW + x] = WarpSampling::isInside(XS, YS, W, H);
+    }
+  }
+}
+
+void ImageWarp::apply(const CImg< unsigned char > &I, CImg< unsigned char > &Ie) const
+{
+  apply_(I, Ie);
+}
+
+void ImageWarp::apply(const CImg< unsigned short > &I, CImg< unsigned short > &Ie) const
+{
+  apply_(I, Ie);
+}
+
+void ImageWarp::apply(const CImg< float > &I, CImg< float > &Ie) const
+{
+  apply_(I, Ie);
+}
+
+void ImageWarp::getValidityMask(CImg< unsigned char > &M) const
+{
+  M.assign(width_, height_, 1, 1);
+  if(!valid_.empty())
+    memcpy(M.data(), &valid_[0], valid_.size());
+}
+
+ImageWarp::Interpolation ImageWarp::parseInterpolation(const string &name)
+{
+  if(name == "bilinear")
+    return BILINEAR;
+  else if(name == "bicubic")
+    return BICUBIC;
+  else if(name == "lanczos")
+    return LANCZOS;
+  else
+    throw invalid_argument("Invalid interpolation method: " + name);
+}
+
+ImageWarp::OutOfDomain ImageWarp::parseOutOfDomain(const string &name)
+{
+  if(name == "clamp")
+    return CLAMP;
+  else if(name == "constant")
+    return FILL_CONSTANT;
+  else if(name == "nan")
+    return FILL_NAN;
+  else
+    throw invalid_argument("Invalid out-of-domain treatment: " + name);
+}
+
+void ImageWarp::setOutOfDomain(OutOfDomain outOfDomain, float fillValue)
+{
+  outOfDomain_ = outOfDomain;
+  fillValue_   = fillValue;
+}
+
+template < class T >
+void ImageWarp::apply_(const CImg< T > &I, CImg< T > &Ie) const
+{
+  if(I.width() != width_ || I.height() != height_ || I.depth() != 1)
+    throw invalid_argument("The image and the warp must have the same dimensions.");
+  
+  Ie.assign(width_, height_, 1, I.spectrum());
+  
+  if(interpolation_ == BILINEAR)
+    applyBilinear_(I, Ie);
+  else
+    applyKernel_(I, Ie);
+}
+
+template < class T >
+void ImageWarp::applyBilinear_(const CImg< T > &I, CImg< T > &Ie) const
+{
+  const int W = width_;
+  const int H = height_;
+  const int C = I.spectrum();
+  // The neighbours coincide in images having only one column or row.
+  const int STEP_X = W > 1 ? 1 : 0;
+  const int STEP_Y = H > 1 ? W : 0;
+  const bool FILL = outOfDomain_ != CLAMP;
+  const T FILL_VALUE = WarpSampling::getFillValue< T >(outOfDomain_, fillValue_);
+
+#pragma omp parallel for schedule(static)
+  for(int y = 0; y < H; y++)
+  {
+    const size_t ROW = (size_t)y * W;
+    const int *offsets = &offsets_[ROW];
+    const float *wx = &wx_[ROW];
+    const float *wy = &wy_[ROW];
+    
+    for(int c = 0; c < C; c++)
+    {
+      const T *src = I.data(0, 0, 0, c);
+      T *dest = Ie.data(0, y, 0, c);
+      
+      for(int x = 0; x < W; x++)
+      {
+        const float F = WarpSampling::interpolateBilinear(src + offsets[x], STEP_X, STEP_Y,
+                                                          wx[x], wy[x]);
+        
+        dest[x] = WarpSampling::toPixel< T >(F);
+      }
+      
+      if(FILL)
+        fillRow_(dest, &valid_[ROW], W, FILL_VALUE);
+    }
+  }
+}
+
+template < class T >
+void ImageWarp::applyKernel_(const CImg< T > &I, CImg< T > &Ie) const
+{
+  const int W = width_;
+  const int H = height_;
+  const int C = I.spectrum();
+  const int STRIDE = W + 3;
+  const bool FILL = outOfDomain_ != CLAMP;
+  const T FILL_VALUE = WarpSampling::getFillValue< T >(outOfDomain_, fillValue_);
+  const KernelTable_ &TABLE = interpolation_ == BICUBIC ? BICUBIC_TABLE_ : LANCZOS_TABLE_;
+  // The source image converted to float and padded by replicating the 
+  // boundary pixels.
+  CImg< float > P(STRIDE, H + 3, 1, C);
+
+#pragma omp parallel
+  {
+    // The indices of the kernel weights of the pixels of a row.
+    vector< int > ix(W), iy(W);
+
+#pragma omp for schedule(static)
+    for(int y = 0; y < H + 3; y++)
+    {
+      const int YS = min(max(y - 1, 0), H - 1);
+      
+      for(int c = 0; c < C; c++)
+      {
+        const T *src = I.data(0, YS, 0, c);
+        float *dest = P.data(0, y, 0, c);
+        
+        dest[0] = src[0];
+        for(int x = 0; x < W; x++)
+          dest[x + 1] = src[x];
+        dest[W + 1] = dest[W + 2] = src[W - 1];
+      }
+    }
+
+#pragma omp for schedule(static)
+    for(int y = 0; y < H; y++)
+    {
+      const size_t ROW = (size_t)y * W;
+      const int *offsets = &offsets_[ROW];
+      const float *wx = &wx_[ROW];
+      const float *wy = &wy_[ROW];
+      
+      // Compute the table indices once for all channels.
+      for(int x = 0; x < W; x++)
+      {
+        ix[x] = (int)(wx[x] * TABLE_RES + 0.5f);
+        iy[x] = (int)(wy[x] * TABLE_RES + 0.5f);
+      }
+      
+      for(int c = 0; c < C; c++)
+      {
+        const float *src = P.data(0, 0, 0, c);
+        T *dest = Ie.data(0, y, 0, c);
+        
+        // The taps of a source row are contiguous in the padded image, so 
+        // the four rows are first combined with the vertical weights tap 
+        // by tap (four-wide vector operations), and the result is then 
+        // combined with the horizontal weights. The weights are read from 
+        // the table, which stays in the L1 cache.
+        for(int x = 0; x < W; x++)
+        {
+          const float *p0 = src + offsets[x];
+          const float *p1 = p0 + STRIDE;
+          const float *p2 = p1 + STRIDE;
+          const float *p3 = p2 + STRIDE;
+          const float *KX = TABLE.weights[ix[x]];
+          const float *KY = TABLE.weights[iy[x]];
+          float r[4];
+          
+          for(int j = 0; j < 4; j++)
+            r[j] = KY[0] * p0[j] + KY[1] * p1[j] + KY[2] * p2[j] + KY[3] * p3[j];
+          
+          dest[x] = WarpSampling::toPixel< T >(KX[0] * r[0] + KX[1] * r[1] + KX[2] * r[2] + KX[3] * r[3]);
+        }
+        
+        if(FILL)
+          fillRow_(dest, &valid_[ROW], W, FILL_VALUE);
+      }
+    }
+  }
+}
@@ -0,0 +1,159 @@
+
+#ifndef IMAGEWARP_H
+
+#include <string>
+#include <vector>
+
+namespace cimg_library { template < class T > class CImg; }
+
+using namespace cimg_library;
+using namespace std;
+
+/// Precomputed source coordinates and bilinear weights of an inverse warp.
+/**
+ * The warp maps each destination pixel x to the source location 
+ * x+multiplier*V(x), where V is an inverse motion field. The locations are 
+ * clamped to the image (Neumann boundary conditions). The coordinates and 
+ * the bilinear interpolation weights are computed once by assign() and can 
+ * then be applied to any number of images of the same size, e.g. several 
+ * co-registered fields advected with the same motion field.
+ *
+ * apply() processes the image row by row, and all channels of a row are 
+ * warped while the coordinates of the row are in the cache.
+ *
+ * Besides bilinear interpolation, the separable four-tap bicubic 
+ * (Catmull-Rom) and Lanczos (a=2) kernels are supported. They blur less 
+ * than bilinear interpolation when the images are warped repeatedly. Their 
+ * weights are read from tables precomputed at 1/256 pixel resolution, and 
+ * the source image is padded so that the inner loops have no boundary 
+ * checks. They are slower than bilinear interpolation: on a 1024x1024 
+ * image (single thread, -O3), they take about 2.2 times the bilinear time 
+ * for 8-bit and 16-bit images and about 3.4 times for floating-point 
+ * images. Each pixel reads 16 source values instead of four, and every 
+ * call converts the source image into a padded floating-point copy. The 
+ * bilinear path of floating-point images is faster than that of integer 
+ * images, so the ratio is larger for them.
+ *
+ * The destination pixels whose source location is outside the image (or 
+ * undefined due to a NaN motion vector) are out of domain. By default, 
+ * they are interpolated from the nearest boundary pixels. Alternatively, 
+ * they can be set to a constant or NaN (see setOutOfDomain), and 
+ * getValidityMask returns the pixels that are within the domain.
+ */
+class ImageWarp
+{
+public:
+  /// The interpolation kernels.
+  enum Interpolation { BILINEAR, BICUBIC, LANCZOS };
+  
+  /// Treatments of the out-of-domain pixels.
+  /**
+   * - CLAMP: interpolate from the nearest boundary pixels
+   * - FILL_CONSTANT: set to the fill value
+   * - FILL_NAN: set to NaN (zero in integer images)
+   */
+  enum OutOfDomain { CLAMP, FILL_CONSTANT, FILL_NAN };
+  
+  /// Constructs an empty warp.
+  ImageWarp();
+  
+  /// Constructs a warp from the given motion field.
+  /**
+   * @param V inverse motion field
+   * @param multiplier multiplier for the motion vectors
+   * @param interpolation the interpolation kernel
+   */
+  ImageWarp(const CImg< double > &V, double multiplier,
+            Interpolation interpolation = BILINEAR);
+  
+  /// Computes the warp from the given motion field.
+  /**
+   * @param V inverse motion field
+   * @param multiplier multiplier for the motion vectors
+   * @param interpolation the interpolation kernel
+   */
+  void assign(const CImg< double > &V, double multiplier,
+              Interpolation interpolation = BILINEAR);
+  
+  /// Applies the warp to all channels of the given image.
+  /**
+   * Throws invalid_argument if the dimensions of I and the warp do not 
+   * match. Integer images are rounded to the nearest value and clamped to 
+   * the range of the pixel type.
+   * @param[in] I the image to warp
+   * @param[out] Ie the warped image
+   */
+  void apply(const CImg< unsigned char > &I, CImg< unsigned char > &Ie) const;
+  
+  /// Applies the warp to all channels of the given 16-bit image.
+  void apply(const CImg< unsigned short > &I, CImg< unsigned short > &Ie) const;
+  
+  /// Applies the warp to all channels of the given floating-point image.
+  void apply(const CImg< float > &I, CImg< float > &Ie) const;
+  
+  /// Returns the height of the warp.
+  int getHeight() const { return height_; }
+  
+  /// Returns the interpolation kernel of the warp.
+  Interpolation getInterpolation() const { return interpolation_; }
+  
+  /// Returns the treatment of the out-of-domain pixels.
+  OutOfDomain getOutOfDomain() const { return outOfDomain_; }
+  
+  /// Computes the mask of the pixels within the domain.
+  /**
+   * @param[out] M W x H image, one for the pixels whose source location is 
+   * within the image and zero for the out-of-domain pixels
+   */
+  void getValidityMask(CImg< unsigned char > &M) const;
+  
+  /// Returns the width of the warp.
+  int getWidth() const { return width_; }
+  
+  /// Returns the interpolation kernel having the given name.
+  /**
+   * Throws invalid_argument if the name is not one of "bilinear", 
+   * "bicubic" or "lanczos".
+   */
+  static Interpolation parseInterpolation(const string &name);
+  
+  /// Returns the out-of-domain treatment having the given name.
+  /**
+   * Throws invalid_argument if the name is not one of "clamp", "constant" 
+   * or "nan".
+   */
+  static OutOfDomain parseOutOfDomain(const string &name);
+  
+  /// Sets the treatment of the out-of-domain pixels (default CLAMP).
+  /**
+   * @param outOfDomain the treatment
+   * @param fillValue the value of the out-of-domain pixels with 
+   * FILL_CONSTANT (rounded and clamped in integer images)
+   */
+  void setOutOfDomain(OutOfDomain outOfDomain, float fillValue = 0.0f);
+private:
+  int width_, height_;
+  Interpolation interpolation_;
+  OutOfDomain outOfDomain_;
+  float fillValue_;
+  // the index of the upper-left source pixel of each destination pixel
+  // (in the padded image for the four-tap kernels)
+  vector< int > offsets_;
+  // the horizontal and vertical interpolation weights
+  vector< float > wx_, wy_;
+  // nonzero for the pixels within the domain
+  vector< unsigned char > valid_;
+  
+  template < class T >
+  void apply_(const CImg< T > &I, CImg< T > &Ie) const;
+  
+  template < class T >
+  void applyBilinear_(const CImg< T > &I, CImg< T > &Ie) const;
+  
+  template < class T >
+  void applyKernel_(const CImg< T > &I, CImg< T > &Ie) const;
+};
+
+#define IMAGEWARP_H
+
+#endif
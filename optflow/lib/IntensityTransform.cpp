@@ -0,0 +1,49 @@
+
+#include "IntensityTransform.h"
+
+#include <stdexcept>
+
+using namespace std;
+
+IntensityTransform::IntensityTransform(double scale) : 
+  gain_(1.0), offset_(0.0), threshold_(false),
+  minValue_(0.0), maxValue_(0.0), belowMinValue_(0.0), logTransform_(false),
+  outputOffset_(0.0), outputScale_(scale), filterStdDev_(0.0)
+{ }
+
+IntensityTransform::IntensityTransform(double minValue,
+                                       double maxValue,
+                                       double belowMinValue,
+                                       bool logTransform,
+                                       double gain,
+                                       double offset) : 
+  gain_(gain), offset_(offset), threshold_(true),
+  minValue_(minValue), maxValue_(maxValue), belowMinValue_(belowMinValue),
+  logTransform_(logTransform), filterStdDev_(0.0)
+{
+  if(maxValue <= minValue)
+    throw invalid_argument("maxValue must be greater than minValue.");
+  if(belowMinValue > minValue)
+    throw invalid_argument("belowMinValue must not be greater than minValue.");
+  if(logTransform && belowMinValue <= 0.0)
+    throw invalid_argument("belowMinValue must be positive if the logarithmic transform is used.");
+  
+  if(logTransform)
+  {
+    outputOffset_ = log(belowMinValue);
+    outputScale_ = 1.0 / (log(maxValue) - outputOffset_);
+  }
+  else
+  {
+    outputOffset_ = belowMinValue;
+    outputScale_ = 1.0 / (maxValue - belowMinValue);
+  }
+}
+
+void IntensityTransform::setFilterStdDev(double stdDev)
+{
+  if(stdDev < 0.0)
+    throw invalid_argument("The standard deviation must be nonnegative.");
+  
+  filterStdDev_ = stdDev;
+}
@@ -0,0 +1,99 @@
+
+#ifndef INTENSITYTRANSFORM_H
+
+#include <math.h>
+#include <string.h>
+
+/// Maps input pixel values (e.g. rain rates or reflectivities) to intensities.
+/**
+ * This class implements the scaling and thresholding that is applied to 
+ * the source images when the image pyramids are constructed. This allows 
+ * extracting motion directly from 16-bit or floating-point fields without 
+ * converting them to 8-bit images first. A thresholding transform maps an 
+ * input value v as follows:
+ *
+ * x = gain*v + offset 
+ * x = belowMinValue, if x < minValue or x is not finite 
+ * x = maxValue,      if x > maxValue 
+ * x = log(x),        if the logarithmic transform is used
+ *
+ * and scales x linearly so that belowMinValue maps to zero and maxValue 
+ * maps to one. Without the logarithmic transform and quantization, this is 
+ * the same mapping as in pyoptflow.utils.rainfall_to_ubyte and 
+ * dBZ_to_ubyte divided by 255. With the logarithmic transform, the mapping 
+ * differs from rainfall_to_ubyte, which subtracts belowMinValue instead of 
+ * its logarithm from the transformed values.
+ *
+ * Optionally, the transformed base level of the pyramid is smoothed with 
+ * a Gaussian filter.
+ */
+class IntensityTransform
+{
+public:
+  /// Constructs a linear transform v*scale.
+  explicit IntensityTransform(double scale = 1.0);
+  
+  /// Constructs a thresholding transform.
+  /**
+   * Throws invalid_argument if maxValue is not greater than minValue, if 
+   * belowMinValue is greater than minValue or if the logarithmic transform 
+   * is used with a nonpositive belowMinValue.
+   * @param minValue values smaller than this are set to belowMinValue
+   * @param maxValue values greater than this are set to maxValue
+   * @param belowMinValue the value assigned to values below minValue and 
+   * to missing (non-finite) values
+   * @param logTransform if true, apply a logarithmic transform
+   * @param gain multiplier applied to the input values before thresholding
+   * @param offset offset applied to the input values before thresholding
+   */
+  IntensityTransform(double minValue,
+                     double maxValue,
+                     double belowMinValue,
+                     bool logTransform = false,
+                     double gain = 1.0,
+                     double offset = 0.0);
+  
+  /// Returns the intensity corresponding to the given input value.
+  float apply(double v) const
+  {
+    double x = gain_ * v + offset_;
+    
+    if(threshold_)
+    {
+      // The test is done on the bit pattern because comparisons with NaN 
+      // are not reliable when compiled with -ffast-math.
+      if(!isFinite_(x) || x < minValue_)
+        x = belowMinValue_;
+      else if(x > maxValue_)
+        x = maxValue_;
+      if(logTransform_)
+        x = log(x);
+    }
+    
+    return (float)((x - outputOffset_) * outputScale_);
+  }
+  
+  /// Returns the standard deviation of the Gaussian filter (0=no filtering).
+  double getFilterStdDev() const { return filterStdDev_; }
+  
+  /// Sets the standard deviation of the Gaussian filter (default = 0).
+  void setFilterStdDev(double stdDev);
+private:
+  double gain_, offset_;
+  bool threshold_;
+  double minValue_, maxValue_, belowMinValue_;
+  bool logTransform_;
+  double outputOffset_, outputScale_;
+  double filterStdDev_;
+  
+  static bool isFinite_(double x)
+  {
+    unsigned long long bits;
+    memcpy(&bits, &x, sizeof(double));
+    return (bits & 0x7ff0000000000000ULL) != 0x7ff0000000000000ULL;
+  }
+};
+
+#define INTENSITYTRANSFORM_H
+
+#endif
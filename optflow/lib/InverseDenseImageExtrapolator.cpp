@@ -3,29 +3,80 @@
 
 #include "CImg_config.h"
 #include <CImg.h>
+#include <stdexcept>
 
 using namespace cimg_library;
 
+InverseDenseImageExtrapolator::InverseDenseImageExtrapolator(ImageWarp::Interpolation interpolation,
+                                                             ImageWarp::OutOfDomain outOfDomain,
+                                                             float fillValue) : 
+  interpolation_(interpolation), outOfDomain_(outOfDomain), fillValue_(fillValue) { }
+
 void InverseDenseImageExtrapolator::extrapolate(const CImg< unsigned char > &I0,
                                                 const CImg< double > &V,
                                                 double multiplier,
                                                 CImg< unsigned char > &Ie) const
 {
-  const int W = I0.width();
-  const int H = I0.height();
-  
-  double u, v;
+  extrapolate_(I0, V, multiplier, Ie, NULL);
+}
+
+void InverseDenseImageExtrapolator::extrapolate(const CImg< unsigned short > &I0,
+                                                const CImg< double > &V,
+                                                double multiplier,
+                                                CImg< unsigned short > &Ie) const
+{
+  extrapolate_(I0, V, multiplier, Ie, NULL);
+}
+
+void InverseDenseImageExtrapolator::extrapolate(const CImg< float > &I0,
+                                                const CImg< double > &V,
+                                                double multiplier,
+                                                CImg< float > &Ie) const
+{
+  extrapolate_(I0, V, multiplier, Ie, NULL);
+}
+
+void InverseDenseImageExtrapolator::extrapolate(const CImg< unsigned char > &I0,
+                                                const CImg< double > &V,
+                                                double multiplier,
+                                                CImg< unsigned char > &Ie,
+                                                CImg< unsigned char > &M) const
+{
+  extrapolate_(I0, V, multiplier, Ie, &M);
+}
+
+void InverseDenseImageExtrapolator::extrapolate(const CImg< unsigned short > &I0,
+                                                const CImg< double > &V,
+                                                double multiplier,
+                                                CImg< unsigned short > &Ie,
+                                                CImg< unsigned char > &M) const
+{
+  extrapolate_(I0, V, multiplier, Ie, &M);
+}
+
+void InverseDenseImageExtrapolator::extrapolate(const CImg< float > &I0,
+                                                const CImg< double > &V,
+                                                double multiplier,
+                                                CImg< float > &Ie,
+                                                CImg< unsigned char > &M) const
+{
+  extrapolate_(I0, V, multiplier, Ie, &M);
+}
+
+template < class T >
+void InverseDenseImageExtrapolator::extrapolate_(const CImg< T > &I0,
+                                                 const CImg< double > &V,
+                                                 double multiplier,
+                                                 CImg< T > &Ie,
+                                                 CImg< unsigned char > *M) const
+{
+  if(V.width() != I0.width() || V.height() != I0.height() || V.spectrum() < 2)
+    throw invalid_argument("The image and the motion field must have the same dimensions.");
   
-  Ie = CImg< unsigned char >(I0.width(), I0.height(), 1, 1);
-  Ie.fill(0);
+  ImageWarp warp(V, multiplier, interpolation_);
   
-  for(int i = 0; i < H; i++)
-  {
-    for(int j = 0; j < W; j++)
-    {
-      u = V(j, i, 0, 0);
-      v = V(j, i, 0, 1);
-      Ie(j, i) = I0.linear_atXY(j + multiplier * u, i + multiplier * v);
-    }
-  }
+  warp.setOutOfDomain(outOfDomain_, fillValue_);
+  warp.apply(I0, Ie);
+  if(M != NULL)
+    warp.getValidityMask(*M);
 }
@@ -2,20 +2,90 @@
 #ifndef INVERSEDENSEIMAGEEXTRAPOLATOR_H
 
 #include "DenseImageExtrapolator.h"
+#include "ImageWarp.h"
 
 /// Implements inverse-mapped image extrapolation with dense motion fields.
 /**
  * For each pixel in the destination image, the method implemented in this 
  * class finds the corresponding pixel in the source image. This is done by 
- * using an inverse motion field between the source images.
+ * using an inverse motion field between the source images. All channels 
+ * of the source image are extrapolated, and the source coordinates are 
+ * computed only once for them. Use ImageWarp directly for advecting 
+ * several fields of different types with the same motion field.
+ *
+ * The pixels whose source location is outside the image are interpolated 
+ * from the nearest boundary pixels by default. They can also be set to 
+ * a constant or NaN, and a validity mask can be computed together with the 
+ * extrapolated image.
  */
 class InverseDenseImageExtrapolator : public DenseImageExtrapolator
 {
 public:
+  /// Constructs an extrapolator.
+  /**
+   * @param interpolation the kernel used for interpolating the source image
+   * @param outOfDomain the treatment of the pixels whose source location is 
+   * outside the image
+   * @param fillValue the value of these pixels with ImageWarp::FILL_CONSTANT
+   */
+  InverseDenseImageExtrapolator(ImageWarp::Interpolation interpolation = ImageWarp::BILINEAR,
+                                ImageWarp::OutOfDomain outOfDomain = ImageWarp::CLAMP,
+                                float fillValue = 0.0f);
+  
   void extrapolate(const CImg< unsigned char > &I0, 
                    const CImg< double > &V,
                    double multiplier,
                    CImg< unsigned char > &Ie) const;
+  
+  void extrapolate(const CImg< unsigned short > &I0,
+                   const CImg< double > &V,
+                   double multiplier,
+                   CImg< unsigned short > &Ie) const;
+  
+  void extrapolate(const CImg< float > &I0,
+                   const CImg< double > &V,
+                   double multiplier,
+                   CImg< float > &Ie) const;
+  
+  /// Extrapolates the given image and computes its validity mask.
+  /**
+   * @param[in] I0 the image to extrapolate
+   * @param[in] V the motion field
+   * @param[in] multiplier multiplier for the motion vectors
+   * @param[out] Ie the extrapolated image
+   * @param[out] M the validity mask, one for the pixels whose source 
+   * location is within the image and zero otherwise
+   */
+  void extrapolate(const CImg< unsigned char > &I0, 
+                   const CImg< double > &V,
+                   double multiplier,
+                   CImg< unsigned char > &Ie,
+                   CImg< unsigned char > &M) const;
+  
+  /// Extrapolates the given 16-bit image and computes its validity mask.
+  void extrapolate(const CImg< unsigned short > &I0,
+                   const CImg< double > &V,
+                   double multiplier,
+                   CImg< unsigned short > &Ie,
+                   CImg< unsigned char > &M) const;
+  
+  /// Extrapolates the given floating-point image and computes its validity mask.
+  void extrapolate(const CImg< float > &I0,
+                   const CImg< double > &V,
+                   double multiplier,
+                   CImg< float > &Ie,
+                   CImg< unsigned char > &M) const;
+private:
+  ImageWarp::Interpolation interpolation_;
+  ImageWarp::OutOfDomain outOfDomain_;
+  float fillValue_;
+  
+  template < class T >
+  void extrapolate_(const CImg< T > &I0,
+                    const CImg< double > &V,
+                    double multiplier,
+                    CImg< T > &Ie,
+                    CImg< unsigned char > *M) const;
 };
 
 #define INVERSEDENSEIMAGEEXTRAPOLATOR_H
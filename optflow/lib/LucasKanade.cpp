@@ -9,7 +9,6 @@
 #include <CImg.h>
 
 LucasKanade::LucasKanade() : COMPUTE_RESIDUALS_(true),
-                             INTENSITY_SCALE_(1.0 / 255.0),
                              WINDOW_RADIUS_(16),
                              NUM_ITERATIONS_(5),
                              TAU_(0.0025),
@@ -27,7 +26,6 @@ LucasKanade::LucasKanade(int windowRadius,
                          float sigmap,
                          bool useWeightingKernel) : 
   COMPUTE_RESIDUALS_(true),
-  INTENSITY_SCALE_(1.0 / 255.0),
   WINDOW_RADIUS_(windowRadius),
   NUM_ITERATIONS_(numIterations),
   TAU_(tau),
@@ -54,19 +52,39 @@ void LucasKanade::compute(const CImg< unsigned char > &I1,
                           const CImg< unsigned char > &I2,
                           CImg< double > &V)
 {
-  int baseIndex = 0, index;
-  int i;
+  FloatImagePyramid P1(I1, 1);
+  FloatImagePyramid P2(I2, 1);
+  CImg< double > VB; // not used
+  
+  computeLevel(P1, P2, 0, V, VB, NULL);
+}
+
+void LucasKanade::computeLevel(const FloatImagePyramid &P1,
+                               const FloatImagePyramid &P2,
+                               int level,
+                               CImg< double > &V,
+                               CImg< double > &VB,
+                               const ActiveRegion *activeRegion)
+{
+  int i, s;
   int x, y;
+  int roiX = 0, roiY = 0;
   LSQInput lsqInput;
   LSQResults lsqResults;
   
-  width_  = I1.width();
-  height_ = I1.height();
+  I1_.assign(P1.getImageLevel(level), true);
+  I2_.assign(P2.getImageLevel(level), true);
   
-  I1_.assign(I1, true);
-  I2_.assign(I2, true);
+  width_  = I1_.width();
+  height_ = I1_.height();
   
-  computeGradients_(I1_, G1_);
+  if(activeRegion == NULL)
+  {
+    fullRegion_.assign(width_, height_);
+    activeRegion = &fullRegion_;
+  }
+  
+  G1_.assign(P1.getGradientLevel(level, FloatImagePyramid::CENTRAL_5), true);
   
   if(COMPUTE_RESIDUALS_ == true)
   {
@@ -82,28 +100,33 @@ void LucasKanade::compute(const CImg< unsigned char > &I1,
   
   for(y = 0; y < height_; y++)
   {
-    index = baseIndex;
-
-    for(x = 0; x < width_; x++)
+    const vector< pair< int, int > > &spans = activeRegion->getRowSpans(y);
+    
+    for(s = 0; s < (int)spans.size(); s++)
     {
-      lsqInput.x = x;
-      lsqInput.y = y;
-      lsqInput.ivx = V(x, y, 0, 0);
-      lsqInput.ivy = V(x, y, 0, 1);
-      
-      computeLSQVelocity_(lsqInput, lsqResults);
+      // Move the ROI to the beginning of the span.
+      roi_.translate(spans[s].first - roiX, y - roiY);
+      roiX = spans[s].first;
+      roiY = y;
       
-      V(x, y, 0, 0) = lsqResults.vx;
-      V(x, y, 0, 1) = lsqResults.vy;
-      for(i = 0; i < getNumResultQualityChannels(); i++)
-	V(x, y, 0, 2 + i) = lsqResults.quality[i];
-      
-      index++;
-      roi_.translate(1, 0);
+      for(x = spans[s].first; x < spans[s].second; x++)
+      {
+        lsqInput.x = x;
+        lsqInput.y = y;
+        lsqInput.ivx = V(x, y, 0, 0);
+        lsqInput.ivy = V(x, y, 0, 1);
+        
+        computeLSQVelocity_(lsqInput, lsqResults);
+        
+        V(x, y, 0, 0) = lsqResults.vx;
+        V(x, y, 0, 1) = lsqResults.vy;
+        for(i = 0; i < getNumResultQualityChannels(); i++)
+          V(x, y, 0, 2 + i) = lsqResults.quality[i];
+        
+        roi_.translate(1, 0);
+        roiX++;
+      }
     }
-    
-    baseIndex += width_;
-    roi_.translate(-width_, 1);
   }
 }
 
@@ -166,30 +189,6 @@ void LucasKanade::computeEigenValues_(double a, double b, double c,
   lambda2 = 0.5 * (a + c - sqrt(4.0*b*b + (a - c)*(a - c)));
 }
 
-void LucasKanade::computeGradients_(const CImg< unsigned char > &I,
-                                    CImg< double > &G)
-{
-  G = CImg< double >(width_, height_, 1, 2);
-  
-  CImg< double > Kx = CImg< double >(5, 1);
-  CImg< double > Ky = CImg< double >(1, 5);
-  
-  Kx(0, 0) = -1.0 / 12.0 * INTENSITY_SCALE_;
-  Kx(1, 0) = 8.0 / 12.0 * INTENSITY_SCALE_;
-  Kx(2, 0) = 0.0;
-  Kx(3, 0) = -8.0 / 12.0 * INTENSITY_SCALE_;
-  Kx(4, 0) = 1.0 / 12.0 * INTENSITY_SCALE_;
-  
-  Ky(0, 0) = -1.0 / 12.0 * INTENSITY_SCALE_;
-  Ky(0, 1) = 8.0 / 12.0 * INTENSITY_SCALE_;
-  Ky(0, 2) = 0.0;
-  Ky(0, 3) = -8.0 / 12.0 * INTENSITY_SCALE_;
-  Ky(0, 4) = 1.0 / 12.0 * INTENSITY_SCALE_;
-  
-  G.get_shared_channel(0) = I.get_convolve(Kx, 0);
-  G.get_shared_channel(1) = I.get_convolve(Ky, 0);
-}
-
 void LucasKanade::computeLSQVelocity_(const LSQInput &input,
                                       LSQResults &results)
 {
@@ -254,8 +253,8 @@ void LucasKanade::computeLSQVelocity_(const LSQInput &input,
           gxs = G1_.linear_atXY(x1Abs, y1Abs, 0, 0);
           gys = G1_.linear_atXY(x1Abs, y1Abs, 0, 1);
           
-          I1s = I1_.linear_atXY(x1Abs, y1Abs) * INTENSITY_SCALE_;
-          I2s = I2_.linear_atXY(x2Abs, y2Abs) * INTENSITY_SCALE_;
+          I1s = I1_.linear_atXY(x1Abs, y1Abs);
+          I2s = I2_.linear_atXY(x2Abs, y2Abs);
           
           if(W_ != NULL)
             w = (*W_)(xw + WINDOW_RADIUS_, yw + WINDOW_RADIUS_);
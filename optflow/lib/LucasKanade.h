@@ -2,7 +2,9 @@
 #ifndef LUCASKANADE_H
 
 #include "LucasKanadeROI.h"
+#include "ActiveRegion.h"
 #include "DenseMotionExtractor.h"
+#include "FloatImagePyramid.h"
 
 #include <string>
 
@@ -47,6 +49,13 @@ class LucasKanade : public DenseMotionExtractor
                const CImg< unsigned char > &I2,
                CImg< double > &V);
   
+  void computeLevel(const FloatImagePyramid &P1,
+                    const FloatImagePyramid &P2,
+                    int level,
+                    CImg< double > &VF,
+                    CImg< double > &VB,
+                    const ActiveRegion *activeRegion);
+  
   string getName() const;
   
   int getNumIterations() const;
@@ -76,7 +85,6 @@ private:
   };
   
   const bool COMPUTE_RESIDUALS_;
-  const double INTENSITY_SCALE_;
   
   const int WINDOW_RADIUS_;
   const int NUM_ITERATIONS_;
@@ -84,21 +92,19 @@ private:
   const double SIGMAP_;
   const int WINDOW_SIZE_;
   
+  ActiveRegion fullRegion_;
   double residualSum_;
   double maxResidual_;
   int numResidualSumTerms_;
   LucasKanadeROI roi_;
   CImg< double > *W_;
   int width_, height_;
-  CImg< unsigned char > I1_, I2_;
-  CImg< double > G1_;
+  CImg< float > I1_, I2_;
+  CImg< float > G1_;
   
   void computeEigenValues_(double a, double b, double c,
                            double &lambda1, double &lambda2);
   
-  void computeGradients_(const CImg< unsigned char > &I,
-                         CImg< double > &G);
-  
   void computeLSQVelocity_(const LSQInput &input, LSQResults &results);
 };
 
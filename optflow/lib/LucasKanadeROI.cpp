@@ -1,12 +1,12 @@
  
 #include "LucasKanadeROI.h"
 
-LucasKanadeROI::LucasKanadeROI(int x, int y, int w, int h, const CImg< unsigned char > &I_, const CImg< double > &G_):
+LucasKanadeROI::LucasKanadeROI(int x, int y, int w, int h, const CImg< float > &I_, const CImg< float > &G_):
   ROI(x, y, w, h, NULL), G(G_), I(I_)
 {
 }
 
-LucasKanadeROI::LucasKanadeROI(int x, int y, int w, int h, const CImg< unsigned char > &I_, const CImg< double > &G_, const CImg< double > *W):
+LucasKanadeROI::LucasKanadeROI(int x, int y, int w, int h, const CImg< float > &I_, const CImg< float > &G_, const CImg< double > *W):
   ROI(x, y, w, h, W), G(G_), I(I_)
 {
 }
@@ -15,7 +15,7 @@ void LucasKanadeROI::addNewTerm(int x, int y)
 {
   double gxs = G(x, y, 0, 0);
   double gys = G(x, y, 0, 1);
-  int I1s = I(x, y);
+  double I1s = I(x, y);
   double w;
   
   if(W_ != NULL)
@@ -56,7 +56,7 @@ void LucasKanadeROI::initialize()
   int wx, wy;
   double gxs, gys;
   double w;
-  int I1s;
+  double I1s;
   
   //coordHandler = CoordinateHandler< int >(0, 0, IW - 1, IH - 1);
   
@@ -102,7 +102,7 @@ void LucasKanadeROI::subtractOldTerm(int x, int y)
 {
   double gxs = G(x, y, 0, 0);
   double gys = G(x, y, 0, 1);
-  int I1s = I(x, y);
+  double I1s = I(x, y);
   double w;
   
   if(W_ != NULL)
@@ -27,12 +27,12 @@ public:
   LucasKanadeROI() { }
 
   LucasKanadeROI(int x, int y, int w, int h,
-                 const CImg< unsigned char > &I_,
-                 const CImg< double > &G_);
+                 const CImg< float > &I_,
+                 const CImg< float > &G_);
 
   LucasKanadeROI(int x, int y, int w, int h,
-                 const CImg< unsigned char > &I_,
-                 const CImg< double > &G_,
+                 const CImg< float > &I_,
+                 const CImg< float > &G_,
                  const CImg< double > *W);
 
   void addNewTerm(int x, int y);
@@ -48,8 +48,8 @@ public:
   void subtractOldTerm(int x, int y);
 private:
   double GWG[2][2];
-  CImg< double > G;
-  CImg< unsigned char > I;
+  CImg< float > G;
+  CImg< float > I;
 };
 
 #define LUCASKANADEROI_H
@@ -0,0 +1,220 @@
+
+#include "MappedDenseVectorField.h"
+#include "PXMFileUtils.h"
+
+#include <fstream>
+#include <limits.h>
+#include <stdexcept>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define HAVE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedDenseVectorField::MappedDenseVectorField(const string &fileName) : 
+  data_(NULL), dataSize_(0), mapped_(false)
+{
+#ifdef HAVE_MMAP
+  int fd = open(fileName.c_str(), O_RDONLY);
+  if(fd < 0)
+    throw runtime_error("File not found.");
+  
+  struct stat st;
+  if(fstat(fd, &st) != 0 || st.st_size == 0)
+  {
+    close(fd);
+    throw runtime_error("Invalid PDVM file.");
+  }
+  dataSize_ = st.st_size;
+  
+  void *addr = mmap(NULL, dataSize_, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if(addr == MAP_FAILED)
+    throw runtime_error("Could not map file into memory.");
+  
+  // The payload is read sequentially.
+  madvise(addr, dataSize_, MADV_SEQUENTIAL);
+  data_ = (const char *)addr;
+  mapped_ = true;
+#else
+  ifstream inputStream(fileName.c_str(), ios::binary | ios::in);
+  if(!inputStream)
+    throw runtime_error("File not found.");
+  
+  inputStream.seekg(0, ios::end);
+  dataSize_ = inputStream.tellg();
+  inputStream.seekg(0, ios::beg);
+  
+  buffer_.resize(dataSize_);
+  if(dataSize_ > 0)
+    inputStream.read(&buffer_[0], dataSize_);
+  data_ = dataSize_ > 0 ? &buffer_[0] : NULL;
+#endif
+  
+  try
+  {
+    parseHeader_();
+  }
+  catch(...)
+  {
+#ifdef HAVE_MMAP
+    if(mapped_)
+      munmap((void *)data_, dataSize_);
+#endif
+    throw;
+  }
+}
+
+MappedDenseVectorField::MappedDenseVectorField(const char *data, size_t size) : 
+  data_(data), dataSize_(size), mapped_(false)
+{
+  parseHeader_();
+}
+
+MappedDenseVectorField::~MappedDenseVectorField()
+{
+#ifdef HAVE_MMAP
+  if(mapped_)
+    munmap((void *)data_, dataSize_);
+#endif
+}
+
+float MappedDenseVectorField::at(int x, int y, int c) const
+{
+  float value;
+  memcpy(&value, getRow(y) + ((size_t)x * getNumChannels() + c) * sizeof(float), 
+         sizeof(float));
+  
+  return value;
+}
+
+const char *MappedDenseVectorField::getChunk(int i, size_t &size) const
+{
+  size = chunkSizes_[i];
+  return payload_ + chunkOffsets_[i];
+}
+
+int MappedDenseVectorField::getNumChunksX() const
+{
+  return width_ / chunkWidth_ + (width_ % chunkWidth_ != 0);
+}
+
+int MappedDenseVectorField::getNumChunksY() const
+{
+  return height_ / chunkHeight_ + (height_ % chunkHeight_ != 0);
+}
+
+const char *MappedDenseVectorField::getRow(int y) const
+{
+  return payload_ + (size_t)y * width_ * getNumChannels() * sizeof(float);
+}
+
+void MappedDenseVectorField::parseHeader_()
+{
+  PNMFileUtils::HeaderParser parser(data_, dataSize_);
+  string token;
+  size_t pos;
+  int c;
+  
+  token = parser.readToken();
+  if(token == "PDV")
+    version_ = 1;
+  else if(token == "PDV2")
+    version_ = 2;
+  else
+    throw runtime_error("Bad magic number");
+  
+  width_ = parser.readInt(0, INT_MAX);
+  height_ = parser.readInt(0, INT_MAX);
+  numQualityChannels_ = parser.readInt(0, 1024);
+  
+  const int C = getNumChannels();
+  
+  if(version_ == 1)
+  {
+    storage_     = DenseVectorFieldIO::FLOAT32;
+    compression_ = DenseVectorFieldIO::NO_COMPRESSION;
+    chunkWidth_  = width_;
+    chunkHeight_ = height_;
+    scales_.assign(C, 1.0f);
+    offsets_.assign(C, 0.0f);
+    
+    pos = parser.endHeader();
+    payload_ = data_ + pos;
+    
+    // Compare by division so that a crafted header cannot overflow the 
+    // payload size.
+    const size_t PIXEL_SIZE = (size_t)C * sizeof(float);
+    const size_t AVAILABLE = dataSize_ - pos;
+    
+    if(width_ > 0 && height_ > 0 && 
+       ((size_t)width_ > AVAILABLE / PIXEL_SIZE || 
+        (size_t)height_ > AVAILABLE / ((size_t)width_ * PIXEL_SIZE)))
+      throw runtime_error("Truncated PDVM file.");
+    
+    return;
+  }
+  
+  token = parser.readToken();
+  if(token == "float32")
+    storage_ = DenseVectorFieldIO::FLOAT32;
+  else if(token == "float16")
+    storage_ = DenseVectorFieldIO::FLOAT16;
+  else if(token == "int16")
+    storage_ = DenseVectorFieldIO::INT16;
+  else
+    throw runtime_error("Invalid PDVM storage type.");
+  
+  token = parser.readToken();
+  if(token == "none")
+    compression_ = DenseVectorFieldIO::NO_COMPRESSION;
+  else if(token == "deflate")
+    compression_ = DenseVectorFieldIO::DEFLATE;
+  else if(token == "zstd")
+    compression_ = DenseVectorFieldIO::ZSTD;
+  else
+    throw runtime_error("Invalid PDVM compression method.");
+  
+  chunkWidth_ = parser.readInt(1, INT_MAX);
+  chunkHeight_ = parser.readInt(1, INT_MAX);
+  
+  const size_t NUM_CHUNKS = (size_t)getNumChunksX() * getNumChunksY();
+  const size_t SCALES_SIZE = 2 * C * sizeof(float);
+  const size_t INDEX_SIZE = 2 * NUM_CHUNKS * sizeof(unsigned long long);
+  
+  pos = parser.endHeader();
+  if(NUM_CHUNKS > (dataSize_ - pos) / (2 * sizeof(unsigned long long)) || 
+     SCALES_SIZE + INDEX_SIZE > dataSize_ - pos)
+    throw runtime_error("Truncated PDVM file.");
+  
+  scales_.resize(C);
+  offsets_.resize(C);
+  for(c = 0; c < C; c++)
+  {
+    memcpy(&scales_[c], data_ + pos, sizeof(float));
+    memcpy(&offsets_[c], data_ + pos + sizeof(float), sizeof(float));
+    pos += 2 * sizeof(float);
+  }
+  
+  chunkOffsets_.resize(NUM_CHUNKS);
+  chunkSizes_.resize(NUM_CHUNKS);
+  for(size_t i = 0; i < NUM_CHUNKS; i++)
+  {
+    memcpy(&chunkOffsets_[i], data_ + pos, sizeof(unsigned long long));
+    memcpy(&chunkSizes_[i], data_ + pos + sizeof(unsigned long long), sizeof(unsigned long long));
+    pos += 2 * sizeof(unsigned long long);
+  }
+  
+  payload_ = data_ + pos;
+  
+  for(size_t i = 0; i < NUM_CHUNKS; i++)
+  {
+    if(chunkOffsets_[i] > dataSize_ - pos || chunkSizes_[i] > dataSize_ - pos - chunkOffsets_[i])
+      throw runtime_error("Truncated PDVM file.");
+  }
+}
@@ -0,0 +1,125 @@
+
+#ifndef MAPPEDDENSEVECTORFIELD_H
+
+#include "DenseVectorFieldIO.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/// Implements a read-only memory-mapped view of a PDVM file.
+/**
+ * The file is mapped into memory and its header is parsed, after which the 
+ * vectors can be accessed directly from the mapped payload without copying. 
+ * In version 1 files, the payload consists of interleaved native-endian 
+ * 32-bit floats, 2+q per pixel in row-major order, where q is the number 
+ * of quality channels. In version 2 files, the chunks are accessed via 
+ * getChunk() and decoded by DenseVectorFieldIO. See DenseVectorFieldIO for 
+ * the file format.
+ *
+ * On platforms without mmap, the file is read into memory with a single 
+ * read call. A PDVM file embedded in another file (e.g. a frame in 
+ * a DenseVectorFieldArchive) can also be parsed directly from memory.
+ */
+class MappedDenseVectorField
+{
+public:
+  /// Maps the given PDVM file and parses its header.
+  /**
+   * Throws runtime_error if the file cannot be opened or if it is not 
+   * a valid PDVM file.
+   */
+  MappedDenseVectorField(const string &fileName);
+  
+  /// Parses a PDVM file stored in the given memory block.
+  /**
+   * The memory block is not copied, and it must remain valid during the 
+   * lifetime of this object. Throws runtime_error if the block does not 
+   * contain a valid PDVM file.
+   */
+  MappedDenseVectorField(const char *data, size_t size);
+  
+  ~MappedDenseVectorField();
+  
+  /// Returns the value of channel c of the vector at (x,y) (version 1 only).
+  float at(int x, int y, int c) const;
+  
+  /// Returns a pointer to the ith chunk and its size in bytes (version 2 only).
+  const char *getChunk(int i, size_t &size) const;
+  
+  /// Returns the chunk height (version 2 only).
+  int getChunkHeight() const { return chunkHeight_; }
+  
+  /// Returns the chunk width (version 2 only).
+  int getChunkWidth() const { return chunkWidth_; }
+  
+  /// Returns the compression method of the chunks.
+  DenseVectorFieldIO::Compression getCompression() const { return compression_; }
+  
+  /// Returns the height of the vector field.
+  int getHeight() const { return height_; }
+  
+  /// Returns the number of chunks in the x-direction (version 2 only).
+  int getNumChunksX() const;
+  
+  /// Returns the number of chunks in the y-direction (version 2 only).
+  int getNumChunksY() const;
+  
+  /// Returns the number of channels (2+number of quality channels).
+  int getNumChannels() const { return 2 + numQualityChannels_; }
+  
+  /// Returns the number of quality channels.
+  int getNumQualityChannels() const { return numQualityChannels_; }
+  
+  /// Returns the offset added to the stored values of channel c.
+  float getOffset(int c) const { return offsets_[c]; }
+  
+  /// Returns a pointer to the beginning of the interleaved payload (version 1 only).
+  /**
+   * The payload is not necessarily aligned to a float boundary, so it 
+   * should be accessed with memcpy or via at().
+   */
+  const char *getPayload() const { return payload_; }
+  
+  /// Returns a pointer to the beginning of the given row in the payload (version 1 only).
+  const char *getRow(int y) const;
+  
+  /// Returns the multiplier of the stored values of channel c.
+  float getScale(int c) const { return scales_[c]; }
+  
+  /// Returns the storage type of the vector components.
+  DenseVectorFieldIO::Storage getStorage() const { return storage_; }
+  
+  /// Returns the format version (1 or 2).
+  int getVersion() const { return version_; }
+  
+  /// Returns the width of the vector field.
+  int getWidth() const { return width_; }
+private:
+  const char *data_;
+  size_t dataSize_;
+  bool mapped_;
+  vector< char > buffer_;
+  const char *payload_;
+  int version_;
+  int width_, height_;
+  int numQualityChannels_;
+  
+  // version 2 only
+  DenseVectorFieldIO::Storage storage_;
+  DenseVectorFieldIO::Compression compression_;
+  int chunkWidth_, chunkHeight_;
+  vector< float > scales_, offsets_;
+  vector< unsigned long long > chunkOffsets_, chunkSizes_;
+  
+  void parseHeader_();
+  
+  MappedDenseVectorField(const MappedDenseVectorField &);
+  MappedDenseVectorField &operator=(const MappedDenseVectorField &);
+};
+
+#define MAPPEDDENSEVECTORFIELD_H
+
+#endif
@@ -8,6 +8,9 @@
 #include "DualDenseMotionExtractor.h"
 #include "ImageExtrapolatorDriver.h"
 #include "MotionExtractorDriver.h"
+#ifdef WITH_HDF5
+#include "ODIMHDF5IO.h"
+#endif
 #include "SparseVectorFieldIO.h"
 #include "VectorFieldIllustrator.h"
 
@@ -15,6 +18,29 @@ using namespace cimg_library;
 
 namespace MotionExtractorDriver
 {
+#ifdef WITH_HDF5
+  ODIMOptions::ODIMOptions() : dataPath("dataset1/data1"),
+                               minValue(0.1),
+                               maxValue(40.0),
+                               chunkSize(256),
+                               compressionLevel(6)
+  { }
+  
+  static ODIMOptions odimOptions_;
+  
+  void setODIMOptions(const ODIMOptions &options)
+  {
+    odimOptions_ = options;
+  }
+#endif
+  
+  static AsyncImageWriter::Options imageWriterOptions_;
+  
+  void setImageWriterOptions(const AsyncImageWriter::Options &options)
+  {
+    imageWriterOptions_ = options;
+  }
+  
   static string getBaseName_(const string &fileName)
   {
     size_t last = fileName.find_last_of(".");
@@ -24,6 +50,20 @@ namespace MotionExtractorDriver
       return fileName;
   }
   
+  // Reads a source image. ODIM HDF5 files are converted to 8-bit images.
+  static void readSourceImage_(const string &fileName, CImg< unsigned char > &I)
+  {
+#ifdef WITH_HDF5
+    if(ODIMHDF5IO::isHDF5File(fileName))
+    {
+      ODIMHDF5IO::readImage(fileName, I, odimOptions_.minValue, odimOptions_.maxValue,
+                            NULL, odimOptions_.dataPath);
+      return;
+    }
+#endif
+    I = CImg< unsigned char >(fileName.c_str());
+  }
+  
   static void preProcess_(const CImg< unsigned char > &I1,
                           const CImg< unsigned char > &I2,
                           CImg< unsigned char > &I1_smoothed,
@@ -52,6 +92,7 @@ namespace MotionExtractorDriver
   static void saveResultImages_(const string &srcFileName1,
                                 const string &srcFileName2,
                                 const string &outFilePrefix,
+                                AsyncImageWriter &writer,
                                 const CImg< unsigned char > &I1_smoothed,
                                 const CImg< unsigned char > &I2_smoothed,
                                 const CImg< unsigned char > &motionImageF,
@@ -59,17 +100,17 @@ namespace MotionExtractorDriver
   {
     string smoothedFileName1 = getBaseName_(srcFileName1.substr(srcFileName1.find_last_of(
       "/")+1, string::npos)) + "-smoothed.png";
-    I1_smoothed.save_png(smoothedFileName1.c_str());
+    writer.write(I1_smoothed, smoothedFileName1);
     string smoothedFileName2 = getBaseName_(srcFileName2.substr(srcFileName1.find_last_of(
       "/")+1, string::npos)) + "-smoothed.png";
-    I2_smoothed.save_png(smoothedFileName2.c_str());
+    writer.write(I2_smoothed, smoothedFileName2);
     
     if(motionImageB == NULL)
-      motionImageF.save_png((outFilePrefix + "-motion.png").c_str());
+      writer.write(motionImageF, outFilePrefix + "-motion.png");
     else
     {
-      motionImageF.save_png((outFilePrefix + "-motionF.png").c_str());
-      motionImageB->save_png((outFilePrefix + "-motionB.png").c_str());
+      writer.write(motionImageF, outFilePrefix + "-motionF.png");
+      writer.write(*motionImageB, outFilePrefix + "-motionB.png");
     }
   }
   
@@ -85,41 +126,90 @@ namespace MotionExtractorDriver
       DenseVectorFieldIO::writeVectorField(*VB, outFilePrefix + "-motionB.pdvm");
     }
   }
-  
+
+#ifdef WITH_HDF5
+  // Saves the motion fields as ODIM HDF5 products if both source images 
+  // are ODIM HDF5 files. The georeferencing is copied from the first one.
+  static void saveResultMotionFieldODIM_(const string &srcFileName1,
+                                         const string &srcFileName2,
+                                         const CImg< double > &VF,
+                                         const string &outFilePrefix,
+                                         const CImg< double > *VB = NULL)
+  {
+    if(!ODIMHDF5IO::isHDF5File(srcFileName1) || !ODIMHDF5IO::isHDF5File(srcFileName2))
+      return;
+    
+    ODIMHDF5IO::Metadata metadata, metadata2;
+    ODIMHDF5IO::readMetadata(srcFileName1, metadata);
+    ODIMHDF5IO::readMetadata(srcFileName2, metadata2);
+    
+    metadata.startdate = metadata.date;
+    metadata.starttime = metadata.time;
+    metadata.enddate   = metadata2.date;
+    metadata.endtime   = metadata2.time;
+    metadata.date      = metadata2.date;
+    metadata.time      = metadata2.time;
+    
+    if(VB == NULL)
+      ODIMHDF5IO::writeVectorField(VF, outFilePrefix + "-motion.h5", metadata,
+                                   odimOptions_.chunkSize, odimOptions_.compressionLevel);
+    else
+    {
+      ODIMHDF5IO::writeVectorField(VF, outFilePrefix + "-motionF.h5", metadata,
+                                   odimOptions_.chunkSize, odimOptions_.compressionLevel);
+      ODIMHDF5IO::writeVectorField(*VB, outFilePrefix + "-motionB.h5", metadata,
+                                   odimOptions_.chunkSize, odimOptions_.compressionLevel);
+    }
+  }
+#endif
+
 #ifdef WITH_CGAL
   static void saveResultMotionField_(const SparseVectorField &V,
                                      const string &outFilePrefix)
   {
-    SparseVectorFieldIO::writeVectorField(V, outFilePrefix + "-motion.psvm");
+    SparseVectorFieldIO::writeVectorField(V, outFilePrefix + "-motion.psvm", true);
   }
 #endif
   
   void runDenseMotionExtractor(DenseMotionExtractor &e,
                                const string &src1,
                                const string &src2,
-                               const string &outFilePrefix)
+                               const string &outFilePrefix,
+                               const string &maskFileName)
   {
-    CImg< unsigned char > I1(src1.c_str());
-    CImg< unsigned char > I2(src2.c_str());
+    CImg< unsigned char > I1, I2;
+    readSourceImage_(src1, I1);
+    readSourceImage_(src2, I2);
     const int W = I1.width();
     const int H = I1.height();
     CImg< unsigned char > I1_smoothed;
     CImg< unsigned char > I2_smoothed;
     CImg< unsigned char > motionImageF(W, H, 1, 3);
     CImg< unsigned char > motionImageB;
+    CImg< unsigned char > mask;
     CImg< double > VF, VB;
+    AsyncImageWriter writer(imageWriterOptions_);
+    
+    if(maskFileName != "")
+      mask = CImg< unsigned char >(maskFileName.c_str()).get_channel(0);
     
     if(!e.isDual())
     {
       preProcess_(I1, I2, I1_smoothed, I2_smoothed, motionImageF);
-      e.compute(I1_smoothed, I2_smoothed, VF);
+      if(mask.is_empty())
+        e.compute(I1_smoothed, I2_smoothed, VF);
+      else
+        e.compute(I1_smoothed, I2_smoothed, mask, VF);
       VectorFieldIllustrator::renderDenseVectorField(VF, motionImageF);
     }
     else
     {
       motionImageB = CImg< unsigned char >(W, H, 1, 3);
       preProcess_(I1, I2, I1_smoothed, I2_smoothed, motionImageF, &motionImageB);
-      e.compute(I1_smoothed, I2_smoothed, VF, VB);
+      if(mask.is_empty())
+        e.compute(I1_smoothed, I2_smoothed, VF, VB);
+      else
+        e.compute(I1_smoothed, I2_smoothed, mask, VF, VB);
       VectorFieldIllustrator::renderDenseVectorField(VF, motionImageF);
       VectorFieldIllustrator::renderDenseVectorField(VB, motionImageB);
     }
@@ -130,19 +220,27 @@ namespace MotionExtractorDriver
       ostr<<(i+1);
       CImg< double > V_equalized = 
         VF.get_shared_channel(2 + i).get_equalize(256).normalize(0.0, 255.0);
-      V_equalized.save_png((outFilePrefix + "-quality" + ostr.str() + ".png").c_str());
+      writer.write(CImg< unsigned char >(V_equalized), outFilePrefix + "-quality" + ostr.str() + ".png");
     }
     
     if(!e.isDual())
     {
-      saveResultImages_(src1, src2, outFilePrefix, I1_smoothed, I2_smoothed, motionImageF);
+      saveResultImages_(src1, src2, outFilePrefix, writer, I1_smoothed, I2_smoothed, motionImageF);
       saveResultMotionField_(VF, outFilePrefix);
+#ifdef WITH_HDF5
+      saveResultMotionFieldODIM_(src1, src2, VF, outFilePrefix);
+#endif
     }
     else
     {
-      saveResultImages_(src1, src2, outFilePrefix, I1_smoothed, I2_smoothed, motionImageF, &motionImageB);
+      saveResultImages_(src1, src2, outFilePrefix, writer, I1_smoothed, I2_smoothed, motionImageF, &motionImageB);
       saveResultMotionField_(VF, outFilePrefix, &VB);
+#ifdef WITH_HDF5
+      saveResultMotionFieldODIM_(src1, src2, VF, outFilePrefix, &VB);
+#endif
     }
+    
+    writer.close();
   }
 
 #ifdef WITH_CGAL
@@ -151,14 +249,16 @@ namespace MotionExtractorDriver
                                 const string &src2,
                                 const string &outFilePrefix)
   {
-    CImg< unsigned char > I1(src1.c_str());
-    CImg< unsigned char > I2(src2.c_str());
+    CImg< unsigned char > I1, I2;
+    readSourceImage_(src1, I1);
+    readSourceImage_(src2, I2);
     const int W = I1.width();
     const int H = I1.height();
     CImg< unsigned char > I1_smoothed;
     CImg< unsigned char > I2_smoothed;
     CImg< unsigned char > motionImage(W, H, 1, 3);
     SparseVectorField V;
+    AsyncImageWriter writer(imageWriterOptions_);
     
     preProcess_(I1, I2, I1_smoothed, I2_smoothed, motionImage);
     
@@ -166,8 +266,10 @@ namespace MotionExtractorDriver
     V.triangulate();
     VectorFieldIllustrator::renderSparseVectorField(V, motionImage);
     
-    saveResultImages_(src1, src2, outFilePrefix, I1_smoothed, I2_smoothed, motionImage);
+    saveResultImages_(src1, src2, outFilePrefix, writer, I1_smoothed, I2_smoothed, motionImage);
     saveResultMotionField_(V, outFilePrefix);
+    
+    writer.close();
   }
 #endif
 }
@@ -1,6 +1,7 @@
 
 #ifndef MOTIONEXTRACTORDRIVER_H
 
+#include "AsyncImageWriter.h"
 #include "DenseMotionExtractor.h"
 #include "SparseMotionExtractor.h"
 
@@ -24,22 +25,54 @@ using namespace std;
  * [prefix]-quality[n].png
  * 
  * where "basename1" and "basename2" are the names of the source images 
- * excluding their extensions and "prefix" is given by user.
+ * excluding their extensions and "prefix" is given by user. The images are 
+ * written asynchronously by an AsyncImageWriter while the motion fields 
+ * are being saved.
+ * 
+ * If compiled with HDF5, the source images can also be ODIM HDF5 files. They 
+ * are converted to 8-bit images as specified by the ODIM options, and the 
+ * motion fields are also saved as ODIM HDF5 AMV products [prefix]-motion.h5.
  */
 namespace MotionExtractorDriver
 {
+#ifdef WITH_HDF5
+  /// Options for reading ODIM HDF5 source images and writing the motion fields.
+  struct ODIMOptions
+  {
+    ODIMOptions();
+    
+    /// The group containing the source dataset (default dataset1/data1).
+    string dataPath;
+    /// The range of values mapped to 8-bit intensities (see ODIMHDF5IO::readImage).
+    double minValue, maxValue;
+    /// The chunk size of the written motion fields.
+    int chunkSize;
+    /// The deflate compression level of the written motion fields.
+    int compressionLevel;
+  };
+  
+  /// Sets the options used for ODIM HDF5 source images.
+  void setODIMOptions(const ODIMOptions &options);
+
+#endif
+  /// Sets the options of the writer used for the result images.
+  void setImageWriterOptions(const AsyncImageWriter::Options &options);
+  
   /// Runs a dense motion extractor.
   /**
    * @param e motion extraction algorithm
    * @param srcFileName1 the file to read the first source image from
    * @param srcFileName2 the file to read the second source image from
    * @param outFileNamePrefix the prefix of the resulting images
+   * @param maskFileName the file to read the mask image from (optional), 
+   * motion is computed only near its nonzero pixels
    */
   void runDenseMotionExtractor(DenseMotionExtractor &e,
                                const string &src1,
                                const string &src2,
-                               const string &outFilePrefix);
-  
+                               const string &outFilePrefix,
+                               const string &maskFileName = "");
+
 #ifdef WITH_CGAL
   /// Runs a sparse motion extractor.
   /**
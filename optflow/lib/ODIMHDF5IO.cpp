@@ -0,0 +1,616 @@
+
+#ifdef WITH_HDF5
+
+#include "ODIMHDF5IO.h"
+
+#include "CImg_config.h"
+#include <CImg.h>
+#include <algorithm>
+#include <hdf5.h>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#ifdef WITH_ZLIB
+#include <zlib.h>
+#endif
+
+// Compressed chunks can be written directly to the file with HDF5 1.10.3 
+// and later.
+#if defined(WITH_ZLIB) && defined(H5_VERSION_GE)
+#if H5_VERSION_GE(1, 10, 3)
+#define HAVE_DIRECT_CHUNK_WRITE
+#endif
+#endif
+
+// Closes an HDF5 object when it goes out of scope.
+class H5Object_
+{
+public:
+  H5Object_(hid_t id, herr_t (*closeFunc)(hid_t), const string &errorMessage) : 
+    id_(id), closeFunc_(closeFunc)
+  {
+    if(id_ < 0)
+      throw runtime_error(errorMessage);
+  }
+  
+  ~H5Object_() { closeFunc_(id_); }
+  
+  operator hid_t() const { return id_; }
+private:
+  hid_t id_;
+  herr_t (*closeFunc_)(hid_t);
+  
+  H5Object_(const H5Object_ &);
+  H5Object_ &operator=(const H5Object_ &);
+};
+
+// Returns true if x is NaN. The bits are inspected directly, since isnan 
+// may be optimized away with -ffast-math.
+static inline bool isNaN_(double x)
+{
+  unsigned long long bits;
+  memcpy(&bits, &x, sizeof(double));
+  
+  return (bits & 0x7ff0000000000000ULL) == 0x7ff0000000000000ULL &&
+         (bits & 0x000fffffffffffffULL) != 0;
+}
+
+#ifdef HAVE_DIRECT_CHUNK_WRITE
+// Returns true if the host byte order is big-endian.
+static bool isBigEndian_()
+{
+  const unsigned int ONE = 1;
+  
+  return *(const unsigned char *)&ONE == 0;
+}
+
+// Reverses the byte order of the given floats.
+static void swapBytes_(float *data, size_t n)
+{
+  for(size_t i = 0; i < n; i++)
+  {
+    unsigned char *b = (unsigned char *)&data[i];
+    
+    swap(b[0], b[3]);
+    swap(b[1], b[2]);
+  }
+}
+#endif
+
+static string intToString_(int i)
+{
+  ostringstream ostr;
+  ostr<<i;
+  return ostr.str();
+}
+
+// Returns true if all components of the given path exist.
+static bool linkExists_(hid_t loc, const string &path)
+{
+  size_t pos = 0;
+  
+  while(pos != string::npos)
+  {
+    pos = path.find('/', pos + 1);
+    if(H5Lexists(loc, path.substr(0, pos).c_str(), H5P_DEFAULT) <= 0)
+      return false;
+  }
+  
+  return true;
+}
+
+static bool readDoubleAttribute_(hid_t loc, const string &objName,
+                                 const char *attrName, double &value)
+{
+  if(!linkExists_(loc, objName) || 
+     H5Aexists_by_name(loc, objName.c_str(), attrName, H5P_DEFAULT) <= 0)
+    return false;
+  
+  H5Object_ attr(H5Aopen_by_name(loc, objName.c_str(), attrName, H5P_DEFAULT, H5P_DEFAULT),
+                 H5Aclose, "Could not open attribute.");
+  
+  return H5Aread(attr, H5T_NATIVE_DOUBLE, &value) >= 0;
+}
+
+static bool readStringAttribute_(hid_t loc, const string &objName,
+                                 const char *attrName, string &value)
+{
+  if(!linkExists_(loc, objName) || 
+     H5Aexists_by_name(loc, objName.c_str(), attrName, H5P_DEFAULT) <= 0)
+    return false;
+  
+  H5Object_ attr(H5Aopen_by_name(loc, objName.c_str(), attrName, H5P_DEFAULT, H5P_DEFAULT),
+                 H5Aclose, "Could not open attribute.");
+  H5Object_ type(H5Aget_type(attr), H5Tclose, "Could not read attribute type.");
+  
+  if(H5Tget_class(type) != H5T_STRING)
+    return false;
+  
+  if(H5Tis_variable_str(type) > 0)
+  {
+    H5Object_ memType(H5Tcopy(H5T_C_S1), H5Tclose, "Could not create string type.");
+    H5Tset_size(memType, H5T_VARIABLE);
+    
+    char *str = NULL;
+    if(H5Aread(attr, memType, &str) < 0)
+      return false;
+    value = str != NULL ? str : "";
+    H5free_memory(str);
+  }
+  else
+  {
+    const size_t SIZE = H5Tget_size(type);
+    vector< char > str(SIZE + 1, '\0');
+    
+    if(H5Aread(attr, type, &str[0]) < 0)
+      return false;
+    value = &str[0];
+  }
+  
+  return true;
+}
+
+static void writeDoubleAttribute_(hid_t loc, const char *name, double value)
+{
+  H5Object_ space(H5Screate(H5S_SCALAR), H5Sclose, "Could not create dataspace.");
+  H5Object_ attr(H5Acreate2(loc, name, H5T_IEEE_F64LE, space, H5P_DEFAULT, H5P_DEFAULT),
+                 H5Aclose, string("Could not create attribute ") + name + ".");
+  
+  if(H5Awrite(attr, H5T_NATIVE_DOUBLE, &value) < 0)
+    throw runtime_error("Error writing file");
+}
+
+static void writeLongAttribute_(hid_t loc, const char *name, long long value)
+{
+  H5Object_ space(H5Screate(H5S_SCALAR), H5Sclose, "Could not create dataspace.");
+  H5Object_ attr(H5Acreate2(loc, name, H5T_STD_I64LE, space, H5P_DEFAULT, H5P_DEFAULT),
+                 H5Aclose, string("Could not create attribute ") + name + ".");
+  
+  if(H5Awrite(attr, H5T_NATIVE_LLONG, &value) < 0)
+    throw runtime_error("Error writing file");
+}
+
+// Writes a null-terminated fixed-length string attribute, as required by 
+// the ODIM specification.
+static void writeStringAttribute_(hid_t loc, const char *name, const string &value)
+{
+  H5Object_ type(H5Tcopy(H5T_C_S1), H5Tclose, "Could not create string type.");
+  H5Tset_size(type, value.size() + 1);
+  H5Tset_strpad(type, H5T_STR_NULLTERM);
+  
+  H5Object_ space(H5Screate(H5S_SCALAR), H5Sclose, "Could not create dataspace.");
+  H5Object_ attr(H5Acreate2(loc, name, type, space, H5P_DEFAULT, H5P_DEFAULT),
+                 H5Aclose, string("Could not create attribute ") + name + ".");
+  
+  if(H5Awrite(attr, type, value.c_str()) < 0)
+    throw runtime_error("Error writing file");
+}
+
+// Writes the attribute only if it is not missing.
+static void writeOptionalAttribute_(hid_t loc, const char *name, double value)
+{
+  if(!isNaN_(value))
+    writeDoubleAttribute_(loc, name, value);
+}
+
+static void writeOptionalAttribute_(hid_t loc, const char *name, const string &value)
+{
+  if(!value.empty())
+    writeStringAttribute_(loc, name, value);
+}
+
+static void readMetadata_(hid_t file, ODIMHDF5IO::Metadata &metadata)
+{
+  readStringAttribute_(file, "where", "projdef", metadata.projdef);
+  readDoubleAttribute_(file, "where", "xscale", metadata.xscale);
+  readDoubleAttribute_(file, "where", "yscale", metadata.yscale);
+  readDoubleAttribute_(file, "where", "LL_lon", metadata.LL_lon);
+  readDoubleAttribute_(file, "where", "LL_lat", metadata.LL_lat);
+  readDoubleAttribute_(file, "where", "UL_lon", metadata.UL_lon);
+  readDoubleAttribute_(file, "where", "UL_lat", metadata.UL_lat);
+  readDoubleAttribute_(file, "where", "UR_lon", metadata.UR_lon);
+  readDoubleAttribute_(file, "where", "UR_lat", metadata.UR_lat);
+  readDoubleAttribute_(file, "where", "LR_lon", metadata.LR_lon);
+  readDoubleAttribute_(file, "where", "LR_lat", metadata.LR_lat);
+  
+  readStringAttribute_(file, "what", "date", metadata.date);
+  readStringAttribute_(file, "what", "time", metadata.time);
+  readStringAttribute_(file, "what", "source", metadata.source);
+  
+  readStringAttribute_(file, "dataset1/what", "startdate", metadata.startdate);
+  readStringAttribute_(file, "dataset1/what", "starttime", metadata.starttime);
+  readStringAttribute_(file, "dataset1/what", "enddate", metadata.enddate);
+  readStringAttribute_(file, "dataset1/what", "endtime", metadata.endtime);
+}
+
+// Returns the dimensions of the two-dimensional dataset in the given group.
+static void getDataSize_(hid_t file, const string &dataPath, int &width, int &height)
+{
+  if(!linkExists_(file, dataPath + "/data"))
+    throw runtime_error("No dataset " + dataPath + " in the file.");
+  
+  H5Object_ dataset(H5Dopen2(file, (dataPath + "/data").c_str(), H5P_DEFAULT),
+                    H5Dclose, "Could not open dataset " + dataPath + ".");
+  H5Object_ space(H5Dget_space(dataset), H5Sclose, "Could not read dataspace.");
+  
+  hsize_t dims[2];
+  if(H5Sget_simple_extent_ndims(space) != 2)
+    throw runtime_error("The dataset " + dataPath + " is not two-dimensional.");
+  H5Sget_simple_extent_dims(space, dims, NULL);
+  
+  height = dims[0];
+  width  = dims[1];
+}
+
+// Reads the dataset in the given group and converts the stored values to 
+// physical values.
+static void readData_(hid_t file, const string &dataPath, double *dest, size_t size)
+{
+  double gain = 1.0, offset = 0.0;
+  double nodata = numeric_limits< double >::quiet_NaN();
+  double undetect = numeric_limits< double >::quiet_NaN();
+  
+  readDoubleAttribute_(file, dataPath + "/what", "gain", gain);
+  readDoubleAttribute_(file, dataPath + "/what", "offset", offset);
+  readDoubleAttribute_(file, dataPath + "/what", "nodata", nodata);
+  readDoubleAttribute_(file, dataPath + "/what", "undetect", undetect);
+  
+  H5Object_ dataset(H5Dopen2(file, (dataPath + "/data").c_str(), H5P_DEFAULT),
+                    H5Dclose, "Could not open dataset " + dataPath + ".");
+  
+  if(H5Dread(dataset, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, dest) < 0)
+    throw runtime_error("Error reading dataset " + dataPath + ".");
+  
+  const double NEG_INF = -numeric_limits< double >::infinity();
+  const double NAN_VALUE = numeric_limits< double >::quiet_NaN();
+
+#pragma omp parallel for schedule(static)
+  for(long i = 0; i < (long)size; i++)
+  {
+    if(dest[i] == nodata)
+      dest[i] = NAN_VALUE;
+    else if(dest[i] == undetect)
+      dest[i] = NEG_INF;
+    else
+      dest[i] = dest[i] * gain + offset;
+  }
+}
+
+ODIMHDF5IO::Metadata::Metadata()
+{
+  const double NAN_VALUE = numeric_limits< double >::quiet_NaN();
+  
+  xscale = yscale = NAN_VALUE;
+  LL_lon = LL_lat = UL_lon = UL_lat = NAN_VALUE;
+  UR_lon = UR_lat = LR_lon = LR_lat = NAN_VALUE;
+}
+
+bool ODIMHDF5IO::isHDF5File(const string &fileName)
+{
+  htri_t result;
+  
+  H5E_BEGIN_TRY
+  {
+    result = H5Fis_hdf5(fileName.c_str());
+  }
+  H5E_END_TRY;
+  
+  return result > 0;
+}
+
+void ODIMHDF5IO::readImage(const string &fileName,
+                           CImg< double > &R,
+                           Metadata *metadata,
+                           const string &dataPath)
+{
+  int w, h;
+  
+  H5Object_ file(H5Fopen(fileName.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT),
+                 H5Fclose, "Could not open file " + fileName + ".");
+  
+  getDataSize_(file, dataPath, w, h);
+  R.assign(w, h);
+  readData_(file, dataPath, R.data(), (size_t)w * h);
+  
+  if(metadata != NULL)
+    readMetadata_(file, *metadata);
+}
+
+void ODIMHDF5IO::readImage(const string &fileName,
+                           CImg< unsigned char > &I,
+                           double minValue,
+                           double maxValue,
+                           Metadata *metadata,
+                           const string &dataPath)
+{
+  if(maxValue <= minValue)
+    throw invalid_argument("maxValue must be greater than minValue.");
+  
+  CImg< double > R;
+  readImage(fileName, R, metadata, dataPath);
+  
+  // the value assigned to the pixels below minValue
+  const double R_RMIN = minValue - (maxValue - minValue);
+  const double SCALE = 255.0 / (maxValue - R_RMIN);
+  const long SIZE = (long)R.width() * R.height();
+  const double *src = R.data();
+  
+  I.assign(R.width(), R.height());
+  unsigned char *dest = I.data();
+
+#pragma omp parallel for schedule(static)
+  for(long i = 0; i < SIZE; i++)
+  {
+    double r = src[i];
+    
+    if(isNaN_(r) || r < minValue)
+      r = R_RMIN;
+    else if(r > maxValue)
+      r = maxValue;
+    
+    dest[i] = (unsigned char)((r - R_RMIN) * SCALE);
+  }
+}
+
+void ODIMHDF5IO::readMetadata(const string &fileName,
+                              Metadata &metadata)
+{
+  H5Object_ file(H5Fopen(fileName.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT),
+                 H5Fclose, "Could not open file " + fileName + ".");
+  
+  readMetadata_(file, metadata);
+}
+
+void ODIMHDF5IO::readVectorField(const string &fileName,
+                                 CImg< double > &V,
+                                 Metadata *metadata)
+{
+  H5Object_ file(H5Fopen(fileName.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT),
+                 H5Fclose, "Could not open file " + fileName + ".");
+  
+  // Find the datasets of the motion components and quality channels.
+  vector< string > channelPaths(2);
+  string quantity;
+  
+  for(int i = 1; linkExists_(file, "dataset1/data" + intToString_(i)); i++)
+  {
+    const string PATH = "dataset1/data" + intToString_(i);
+    
+    if(!readStringAttribute_(file, PATH + "/what", "quantity", quantity))
+      continue;
+    
+    if(quantity == "AMVU")
+      channelPaths[0] = PATH;
+    else if(quantity == "AMVV")
+      channelPaths[1] = PATH;
+    else if(quantity.substr(0, 4) == "QIND")
+    {
+      const int Q = atoi(quantity.substr(4).c_str());
+      if(Q < 1)
+        continue;
+      if(Q + 2 > (int)channelPaths.size())
+        channelPaths.resize(Q + 2);
+      channelPaths[Q + 1] = PATH;
+    }
+  }
+  
+  if(channelPaths[0].empty() || channelPaths[1].empty())
+    throw runtime_error("No AMVU and AMVV datasets in the file.");
+  
+  int w, h, wc, hc;
+  getDataSize_(file, channelPaths[0], w, h);
+  V.assign(w, h, 1, channelPaths.size(), 0.0);
+  
+  for(int c = 0; c < (int)channelPaths.size(); c++)
+  {
+    if(channelPaths[c].empty())
+      continue;
+    
+    getDataSize_(file, channelPaths[c], wc, hc);
+    if(wc != w || hc != h)
+      throw runtime_error("The datasets in the file have different dimensions.");
+    
+    readData_(file, channelPaths[c], V.data(0, 0, 0, c), (size_t)w * h);
+  }
+  
+  if(metadata != NULL)
+    readMetadata_(file, *metadata);
+}
+
+void ODIMHDF5IO::writeVectorField(const CImg< double > &V,
+                                  const string &fileName,
+                                  const Metadata &metadata,
+                                  int chunkSize,
+                                  int compressionLevel)
+{
+  if(V.spectrum() < 2)
+    throw invalid_argument("The vector field must have at least two channels.");
+  if(V.width() == 0 || V.height() == 0)
+    throw invalid_argument("The vector field is empty.");
+  if(chunkSize < 1)
+    throw invalid_argument("The chunk size must be positive.");
+  if(compressionLevel < 0 || compressionLevel > 9)
+    throw invalid_argument("The compression level must be between 0 and 9.");
+  
+  const int W = V.width();
+  const int H = V.height();
+  const int C = V.spectrum();
+  const int CW = min(chunkSize, W);
+  const int CH = min(chunkSize, H);
+  const int NCX = (W + CW - 1) / CW;
+  const int NCY = (H + CH - 1) / CH;
+  const int NUM_CHUNKS = NCX * NCY;
+  
+  // Convert the channels to 32-bit floats (and compress them if possible) 
+  // concurrently. The HDF5 library is only used from this thread.
+#ifdef HAVE_DIRECT_CHUNK_WRITE
+  const bool DIRECT_WRITE = compressionLevel > 0;
+#else
+  const bool DIRECT_WRITE = false;
+#endif
+  vector< float > data;
+  vector< vector< char > > chunks;
+  
+  if(DIRECT_WRITE)
+  {
+#ifdef HAVE_DIRECT_CHUNK_WRITE
+    // Writing chunks directly bypasses the type conversion of HDF5, so the 
+    // chunks are converted to the little-endian file type here.
+    const bool SWAP_BYTES = isBigEndian_();
+    bool failed = false;
+    chunks.resize((size_t)C * NUM_CHUNKS);
+
+#pragma omp parallel
+    {
+      // The chunks at the right and bottom edges are padded to full size.
+      vector< float > buffer((size_t)CW * CH, 0.0f);
+
+#pragma omp for schedule(dynamic)
+      for(int k = 0; k < C * NUM_CHUNKS; k++)
+      {
+        const int c = k / NUM_CHUNKS;
+        const int X = (k % NUM_CHUNKS % NCX) * CW;
+        const int Y = (k % NUM_CHUNKS / NCX) * CH;
+        const int W_ = min(CW, W - X);
+        const int H_ = min(CH, H - Y);
+        
+        if(W_ < CW || H_ < CH)
+          fill(buffer.begin(), buffer.end(), 0.0f);
+        
+        for(int y = 0; y < H_; y++)
+        {
+          const double *src = V.data(X, Y + y, 0, c);
+          float *dest = &buffer[(size_t)y * CW];
+          
+          for(int x = 0; x < W_; x++)
+            dest[x] = src[x];
+        }
+        if(SWAP_BYTES)
+          swapBytes_(&buffer[0], buffer.size());
+        
+        uLongf destSize = compressBound(buffer.size() * sizeof(float));
+        chunks[k].resize(destSize);
+        if(compress2((Bytef *)&chunks[k][0], &destSize, (const Bytef *)&buffer[0],
+                     buffer.size() * sizeof(float), compressionLevel) != Z_OK)
+          failed = true;
+        chunks[k].resize(destSize);
+      }
+    }
+    
+    if(failed)
+      throw runtime_error("Deflate compression failed.");
+#endif
+  }
+  else
+  {
+    data.resize((size_t)C * W * H);
+
+#pragma omp parallel for schedule(static)
+    for(long i = 0; i < (long)data.size(); i++)
+      data[i] = V.data()[i];
+  }
+  
+  H5Object_ file(H5Fcreate(fileName.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT),
+                 H5Fclose, "Error creating file");
+  
+  {
+    H5Object_ where(H5Gcreate2(file, "where", H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT),
+                    H5Gclose, "Could not create group where.");
+    
+    writeOptionalAttribute_(where, "projdef", metadata.projdef);
+    writeLongAttribute_(where, "xsize", W);
+    writeLongAttribute_(where, "ysize", H);
+    writeOptionalAttribute_(where, "xscale", metadata.xscale);
+    writeOptionalAttribute_(where, "yscale", metadata.yscale);
+    writeOptionalAttribute_(where, "LL_lon", metadata.LL_lon);
+    writeOptionalAttribute_(where, "LL_lat", metadata.LL_lat);
+    writeOptionalAttribute_(where, "UL_lon", metadata.UL_lon);
+    writeOptionalAttribute_(where, "UL_lat", metadata.UL_lat);
+    writeOptionalAttribute_(where, "UR_lon", metadata.UR_lon);
+    writeOptionalAttribute_(where, "UR_lat", metadata.UR_lat);
+    writeOptionalAttribute_(where, "LR_lon", metadata.LR_lon);
+    writeOptionalAttribute_(where, "LR_lat", metadata.LR_lat);
+  }
+  
+  {
+    H5Object_ what(H5Gcreate2(file, "what", H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT),
+                   H5Gclose, "Could not create group what.");
+    
+    writeStringAttribute_(what, "object", "AMV");
+    writeStringAttribute_(what, "version", "H5rad 2.2");
+    writeOptionalAttribute_(what, "date", metadata.date);
+    writeOptionalAttribute_(what, "time", metadata.time);
+    writeOptionalAttribute_(what, "source", metadata.source);
+  }
+  
+  H5Object_ dataset1(H5Gcreate2(file, "dataset1", H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT),
+                     H5Gclose, "Could not create group dataset1.");
+  {
+    H5Object_ what(H5Gcreate2(dataset1, "what", H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT),
+                   H5Gclose, "Could not create group dataset1/what.");
+    
+    writeStringAttribute_(what, "product", "AMV");
+    writeOptionalAttribute_(what, "startdate", metadata.startdate);
+    writeOptionalAttribute_(what, "starttime", metadata.starttime);
+    writeOptionalAttribute_(what, "enddate", metadata.enddate);
+    writeOptionalAttribute_(what, "endtime", metadata.endtime);
+  }
+  
+  const hsize_t DIMS[2] = { (hsize_t)H, (hsize_t)W };
+  const hsize_t CHUNK_DIMS[2] = { (hsize_t)CH, (hsize_t)CW };
+  
+  H5Object_ space(H5Screate_simple(2, DIMS, NULL), H5Sclose, "Could not create dataspace.");
+  H5Object_ dcpl(H5Pcreate(H5P_DATASET_CREATE), H5Pclose, "Could not create property list.");
+  H5Pset_chunk(dcpl, 2, CHUNK_DIMS);
+  if(compressionLevel > 0)
+    H5Pset_deflate(dcpl, compressionLevel);
+  
+  for(int c = 0; c < C; c++)
+  {
+    const string NAME = "data" + intToString_(c + 1);
+    
+    H5Object_ group(H5Gcreate2(dataset1, NAME.c_str(), H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT),
+                    H5Gclose, "Could not create group " + NAME + ".");
+    H5Object_ dataset(H5Dcreate2(group, "data", H5T_IEEE_F32LE, space, H5P_DEFAULT, dcpl, H5P_DEFAULT),
+                      H5Dclose, "Could not create dataset " + NAME + ".");
+    
+    if(DIRECT_WRITE)
+    {
+#ifdef HAVE_DIRECT_CHUNK_WRITE
+      for(int i = 0; i < NUM_CHUNKS; i++)
+      {
+        const vector< char > &chunk = chunks[(size_t)c * NUM_CHUNKS + i];
+        const hsize_t OFFSET[2] = { (hsize_t)(i / NCX) * CH, (hsize_t)(i % NCX) * CW };
+        
+        if(H5Dwrite_chunk(dataset, H5P_DEFAULT, 0, OFFSET, chunk.size(), &chunk[0]) < 0)
+          throw runtime_error("Error writing file");
+      }
+#endif
+    }
+    else
+    {
+      if(H5Dwrite(dataset, H5T_NATIVE_FLOAT, H5S_ALL, H5S_ALL, H5P_DEFAULT,
+                  &data[(size_t)c * W * H]) < 0)
+        throw runtime_error("Error writing file");
+    }
+    
+    H5Object_ what(H5Gcreate2(group, "what", H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT),
+                   H5Gclose, "Could not create group " + NAME + "/what.");
+    
+    writeDoubleAttribute_(what, "gain", 1.0);
+    writeDoubleAttribute_(what, "nodata", numeric_limits< double >::quiet_NaN());
+    writeDoubleAttribute_(what, "offset", 0.0);
+    if(c == 0)
+      writeStringAttribute_(what, "quantity", "AMVU");
+    else if(c == 1)
+      writeStringAttribute_(what, "quantity", "AMVV");
+    else
+      writeStringAttribute_(what, "quantity", "QIND" + intToString_(c - 1));
+    writeDoubleAttribute_(what, "undetect", -numeric_limits< double >::infinity());
+  }
+}
+
+#endif
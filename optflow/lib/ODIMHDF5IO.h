@@ -0,0 +1,122 @@
+
+#ifdef WITH_HDF5
+#ifndef ODIMHDF5IO_H
+
+#include <string>
+
+namespace cimg_library { template < class T > class CImg; }
+
+using namespace cimg_library;
+using namespace std;
+
+/// Implements methods for reading and writing ODIM HDF5 files.
+/**
+ * ODIM HDF5 is the file format of the OPERA data information model for 
+ * weather radar products. This class implements methods for reading 
+ * precipitation datasets (e.g. composites) and for reading and writing 
+ * motion fields as AMV products. The motion fields are stored in the same 
+ * layout as in pyoptflow.io_utils.write_ODIM_HDF5:
+ *
+ * /dataset1/data1/data: u-component (quantity AMVU)
+ * /dataset1/data2/data: v-component (quantity AMVV)
+ * /dataset1/data[2+n]/data: nth quality channel (quantity QIND[n])
+ *
+ * The datasets are written as chunked 32-bit floats compressed with 
+ * deflate. When compiled with zlib, the chunks are compressed concurrently 
+ * and written directly to the file, bypassing the (serial) filter pipeline 
+ * of the HDF5 library.
+ */
+class ODIMHDF5IO
+{
+public:
+  /// Metadata of an ODIM HDF5 product.
+  /**
+   * Empty strings and NaN values denote missing attributes. They are not 
+   * written to the file.
+   */
+  struct Metadata
+  {
+    /// Initializes all attributes as missing.
+    Metadata();
+    
+    /// Proj4-compatible projection definition (/where/projdef).
+    string projdef;
+    /// Pixel width and height in meters (/where/xscale, /where/yscale).
+    double xscale, yscale;
+    /// Longitudes and latitudes of the corners (/where/LL_lon etc.).
+    double LL_lon, LL_lat, UL_lon, UL_lat, UR_lon, UR_lat, LR_lon, LR_lat;
+    /// Nominal date (YYYYMMDD) and time (HHMMSS) of the product (/what/date, /what/time).
+    string date, time;
+    /// Start and end date and time of the dataset (/dataset1/what).
+    string startdate, starttime, enddate, endtime;
+    /// Source identifier (/what/source).
+    string source;
+  };
+  
+  /// Returns true if the given file exists and is an HDF5 file.
+  static bool isHDF5File(const string &fileName);
+  
+  /// Reads a precipitation dataset from an ODIM HDF5 file.
+  /**
+   * The gain and offset given in the what group of the dataset are applied 
+   * to the stored values. Pixels with the nodata value are set to NaN, and 
+   * pixels with the undetect value are set to minus infinity.
+   * @param fileName the file to read from
+   * @param[out] R the physical values of the dataset
+   * @param[out] metadata if not NULL, the metadata of the file is stored here
+   * @param dataPath the group containing the dataset
+   */
+  static void readImage(const string &fileName,
+                        CImg< double > &R,
+                        Metadata *metadata = NULL,
+                        const string &dataPath = "dataset1/data1");
+  
+  /// Reads a precipitation dataset from an ODIM HDF5 file and converts it to an 8-bit image.
+  /**
+   * The conversion is the same as in pyoptflow.utils.rainfall_to_ubyte:
+   * the values are clamped to [minValue,maxValue] and scaled linearly so 
+   * that the values below minValue, undetected and missing values map to 
+   * zero and maxValue maps to 255. The value minValue maps to 127.
+   * @param fileName the file to read from
+   * @param[out] I the converted image
+   * @param minValue the smallest value considered nonzero
+   * @param maxValue the value mapped to 255
+   * @param[out] metadata if not NULL, the metadata of the file is stored here
+   * @param dataPath the group containing the dataset
+   */
+  static void readImage(const string &fileName,
+                        CImg< unsigned char > &I,
+                        double minValue,
+                        double maxValue,
+                        Metadata *metadata = NULL,
+                        const string &dataPath = "dataset1/data1");
+  
+  /// Reads the metadata of an ODIM HDF5 file.
+  static void readMetadata(const string &fileName,
+                           Metadata &metadata);
+  
+  /// Reads a motion field from an ODIM HDF5 AMV product.
+  static void readVectorField(const string &fileName,
+                              CImg< double > &V,
+                              Metadata *metadata = NULL);
+  
+  /// Writes a motion field into an ODIM HDF5 AMV product.
+  /**
+   * @param V the motion field, its first two channels are the u- and 
+   * v-components and the remaining ones are quality channels
+   * @param fileName the file to write to
+   * @param metadata the attributes of the product
+   * @param chunkSize the width and height of the chunks of the datasets
+   * @param compressionLevel deflate compression level (0-9), 0=no compression
+   */
+  static void writeVectorField(const CImg< double > &V,
+                               const string &fileName,
+                               const Metadata &metadata,
+                               int chunkSize = 256,
+                               int compressionLevel = 6);
+};
+
+#define ODIMHDF5IO_H
+
+#endif
+#endif
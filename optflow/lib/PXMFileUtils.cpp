@@ -1,52 +1,153 @@
 
 #include "PXMFileUtils.h"
 
+#include <algorithm>
 #include <iostream>
+#include <limits.h>
 #include <stdexcept>
 #include <string.h>
 
-static const int TOKEN_SIZE = 100;
+const size_t PNMFileUtils::MAX_HEADER_SIZE;
+const int PNMFileUtils::MAX_TOKEN_SIZE;
 
-void PNMFileUtils::checkMagicNumber(ifstream &inputStream, const string &id)
+static inline bool isWhitespace_(char ch)
+{
+  return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r';
+}
+
+static inline bool isPrintable_(char ch)
+{
+  return ch > ' ' && ch < 127;
+}
+
+PNMFileUtils::HeaderParser::HeaderParser(const char *data, size_t size) : 
+  data_(data), size_(min(size, MAX_HEADER_SIZE)), pos_(0)
 {
-  char token[TOKEN_SIZE];
+  if(data_ == NULL)
+    size_ = 0;
+}
+
+void PNMFileUtils::HeaderParser::checkMagicNumber(const string &id)
+{
+  const string TOKEN = readToken();
   
-  extractToken(inputStream, token, TOKEN_SIZE);
-  if(strcmp(token, id.c_str()) != 0)
+  if(TOKEN != id)
   {
-    cerr<<"Magic number "<<token<<" != "<<id<<endl;
+    cerr<<"Magic number "<<TOKEN<<" != "<<id<<endl;
     throw runtime_error("Bad magic number");
   }
 }
 
-void PNMFileUtils::extractToken(ifstream &inputStream,
-                                char *token,
-                                int maxSize)
+size_t PNMFileUtils::HeaderParser::endHeader()
 {
-  int count = 0;
-  char ch;
+  if(pos_ >= size_ || !isWhitespace_(data_[pos_]))
+    throw runtime_error("Invalid header.");
   
+  return ++pos_;
+}
+
+string PNMFileUtils::HeaderParser::readToken()
+{
   // skip whitespace and comments
-  do
+  while(pos_ < size_ && (isWhitespace_(data_[pos_]) || data_[pos_] == '#'))
   {
-    inputStream.read((char *)&ch, sizeof(char));
-    // if a comment char is found then read till the next "\n"
-    if(ch == '#')
-      while(ch != '\n')
-        inputStream.read((char *)&ch, sizeof(char *));
+    if(data_[pos_] == '#')
+    {
+      const void *end = memchr(data_ + pos_, '\n', size_ - pos_);
+      pos_ = end != NULL ? (const char *)end - data_ : size_;
+    }
+    else
+      pos_++;
   }
-  while(ch == ' ' || ch == '\t' || ch == '\n');
   
-  // copy data into token
-  do
+  const size_t START = pos_;
+  while(pos_ < size_ && isPrintable_(data_[pos_]))
   {
-    if(count >= maxSize - 1)
+    if(pos_ - START >= (size_t)MAX_TOKEN_SIZE)
       throw runtime_error("Token too large");
-    token[count++] = ch;
-    inputStream.read((char *)&ch, sizeof(char));
+    pos_++;
+  }
+  
+  // A token must be terminated by whitespace within the header.
+  if(pos_ >= size_)
+    throw runtime_error(size_ == MAX_HEADER_SIZE ? "Header too large." : "Unexpected end of file.");
+  if(pos_ == START || !isWhitespace_(data_[pos_]))
+    throw runtime_error("Invalid header.");
+  
+  return string(data_ + START, pos_ - START);
+}
+
+int PNMFileUtils::HeaderParser::readInt(int minValue, int maxValue)
+{
+  const string TOKEN = readToken();
+  long long value = 0;
+  size_t i = 0;
+  bool negative = false;
+  
+  if(TOKEN[0] == '-' || TOKEN[0] == '+')
+  {
+    negative = TOKEN[0] == '-';
+    i++;
+  }
+  if(i == TOKEN.size())
+    throw runtime_error("Invalid integer " + TOKEN + " in header.");
+  
+  for(; i < TOKEN.size(); i++)
+  {
+    if(TOKEN[i] < '0' || TOKEN[i] > '9')
+      throw runtime_error("Invalid integer " + TOKEN + " in header.");
+    value = 10 * value + (TOKEN[i] - '0');
+    if(value > (long long)INT_MAX + 1)
+      throw runtime_error("Integer " + TOKEN + " in header out of range.");
+  }
+  if(negative)
+    value = -value;
+  
+  if(value < minValue || value > maxValue)
+    throw runtime_error("Integer " + TOKEN + " in header out of range.");
+  
+  return (int)value;
+}
+
+void PNMFileUtils::checkMagicNumber(ifstream &inputStream, const string &id)
+{
+  char token[MAX_TOKEN_SIZE + 1];
+  
+  extractToken(inputStream, token, MAX_TOKEN_SIZE + 1);
+  if(strcmp(token, id.c_str()) != 0)
+  {
+    cerr<<"Magic number "<<token<<" != "<<id<<endl;
+    throw runtime_error("Bad magic number");
   }
-  while(ch != ' ' && ch != '\t' && ch != '\n' && ch != '.');
+}
+
+void PNMFileUtils::extractToken(ifstream &inputStream,
+                                char *token,
+                                int maxSize)
+{
+  vector< char > buffer;
+  const streampos START = inputStream.tellg();
+  
+  readHeaderBlock(inputStream, buffer);
+  
+  HeaderParser parser(buffer.empty() ? NULL : &buffer[0], buffer.size());
+  const string TOKEN = parser.readToken();
+  if((int)TOKEN.size() >= maxSize)
+    throw runtime_error("Token too large");
+  strcpy(token, TOKEN.c_str());
+  
+  inputStream.seekg(START + (streamoff)parser.getPosition());
+}
+
+void PNMFileUtils::readHeaderBlock(ifstream &inputStream, vector< char > &buffer)
+{
+  const streampos START = inputStream.tellg();
+  
+  buffer.resize(MAX_HEADER_SIZE);
+  inputStream.read(&buffer[0], MAX_HEADER_SIZE);
+  buffer.resize(inputStream.gcount());
   
-  inputStream.putback(ch);
-  token[count] = '\0';
+  // Reaching the end of the file is not an error here.
+  inputStream.clear();
+  inputStream.seekg(START);
 }
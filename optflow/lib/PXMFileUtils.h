@@ -1,20 +1,86 @@
 
 #ifndef PNMFILEUTILS_H
 
+#include <cstddef>
 #include <fstream>
 #include <string>
+#include <vector>
 
 using namespace std;
 
 /// Implements utility methods for reading PNM/PDVM/PSVM files.
+/**
+ * The headers of these formats consist of whitespace-separated ASCII tokens 
+ * (the first one being the magic number), optionally interleaved with 
+ * comments that begin with '#' and extend to the end of the line. A single 
+ * whitespace character separates the header from the binary payload.
+ *
+ * The headers are parsed from a memory block (a memory-mapped file or 
+ * a block read with a single call) by HeaderParser. The grammar is bounded:
+ * the header may not extend beyond MAX_HEADER_SIZE bytes, the tokens may 
+ * not be longer than MAX_TOKEN_SIZE characters and may only contain 
+ * printable characters, and the numeric fields are validated. Corrupted 
+ * headers are thus rejected without scanning the payload.
+ */
 class PNMFileUtils
 {
 public:
+  /// The maximum size of a header in bytes (including comments).
+  static const size_t MAX_HEADER_SIZE = 4096;
+  
+  /// The maximum length of a token.
+  static const int MAX_TOKEN_SIZE = 99;
+  
+  /// Parses a header stored in a memory block.
+  class HeaderParser
+  {
+  public:
+    /// Constructs a parser for the header at the beginning of the given block.
+    /**
+     * The block is not copied, and it must remain valid during the lifetime 
+     * of the parser.
+     */
+    HeaderParser(const char *data, size_t size);
+    
+    /// Checks that the next token (the magic number) equals the given one.
+    void checkMagicNumber(const string &id);
+    
+    /// Skips the whitespace character terminating the header and returns the offset of the payload.
+    size_t endHeader();
+    
+    /// Returns the current position in the block.
+    size_t getPosition() const { return pos_; }
+    
+    /// Returns the next token.
+    string readToken();
+    
+    /// Reads the next token as an integer in the range [minValue,maxValue].
+    /**
+     * Throws runtime_error if the token is not a decimal integer or if it 
+     * is outside the given range.
+     */
+    int readInt(int minValue, int maxValue);
+  private:
+    const char *data_;
+    size_t size_;
+    size_t pos_;
+  };
+  
   /// Checks the magic number (the identifier at the beginning of the file).
   static void checkMagicNumber(ifstream &inputStream, const string &id);
   
   /// Extracts a token (a character sequence terminated by whitespace or end of row) from the given stream.
+  /**
+   * The stream is read in blocks, and it is left positioned at the 
+   * character terminating the token.
+   */
   static void extractToken(ifstream &inputStream, char *token, int maxSize);
+  
+  /// Reads the beginning of a file (at most MAX_HEADER_SIZE bytes) into the given buffer with a single read call.
+  /**
+   * The stream is left at the beginning of the block.
+   */
+  static void readHeaderBlock(ifstream &inputStream, vector< char > &buffer);
 };
 
 #define PNMFILEUTILS_H
@@ -1,14 +1,15 @@
 
 #include "Proesmans.h"
 
+#include <algorithm>
 #include <iostream>
 #include <math.h>
 
 Proesmans::Proesmans() : BOUNDARY_CONDITIONS_(NEUMANN),
                          COMPUTE_RESIDUALS_(false),
-                         INTENSITY_SCALE_(1.0 / 255.0),
                          LAMBDA_(100.0),
-                         NUM_ITERATIONS_(200)
+                         NUM_ITERATIONS_(200),
+                         verbose_(true)
 { }
 
 Proesmans::Proesmans(int numIterations_,
@@ -16,9 +17,9 @@ Proesmans::Proesmans(int numIterations_,
                      BoundaryConditions boundaryConditions_) : 
   BOUNDARY_CONDITIONS_(boundaryConditions_),
   COMPUTE_RESIDUALS_(false),
-  INTENSITY_SCALE_(1.0 / 255.0),
   LAMBDA_(lambda_),
-  NUM_ITERATIONS_(numIterations_)
+  NUM_ITERATIONS_(numIterations_),
+  verbose_(true)
 { }
 
 void Proesmans::compute(const CImg< unsigned char > &I1,
@@ -26,28 +27,53 @@ void Proesmans::compute(const CImg< unsigned char > &I1,
                         CImg< double > &VF,
                         CImg< double > &VB)
 {
-  int i, j;
+  FloatImagePyramid P1(I1, 1);
+  FloatImagePyramid P2(I2, 1);
+  
+  computeLevel(P1, P2, 0, VF, VB, NULL);
+}
+
+void Proesmans::computeLevel(const FloatImagePyramid &P1,
+                             const FloatImagePyramid &P2,
+                             int level,
+                             CImg< double > &VF,
+                             CImg< double > &VB,
+                             const ActiveRegion *activeRegion)
+{
+  int i, j, s;
   int x, y;
   double vAvg[2];
   double xd, yd;
   double It;
   double vNext[2];
   
-  width_ = I1.width();
-  height_ = I1.height();
+  I_[0].assign(P1.getImageLevel(level), true);
+  I_[1].assign(P2.getImageLevel(level), true);
+  
+  width_ = I_[0].width();
+  height_ = I_[0].height();
   
-  I_[0].assign(I1, true);
-  I_[1].assign(I2, true);
+  if(activeRegion == NULL)
+  {
+    fullRegion_.assign(width_, height_);
+    activeRegion = &fullRegion_;
+  }
+  activeRegion_ = activeRegion;
   
   V_[0].assign(VF, true);
   V_[1].assign(VB, true);
   
-  computeGradients_(I_[0], G_[0]);
-  computeGradients_(I_[1], G_[1]);
+  G_[0].assign(P1.getGradientLevel(level, FloatImagePyramid::SOBEL_3X3), true);
+  G_[1].assign(P2.getGradientLevel(level, FloatImagePyramid::SOBEL_3X3), true);
   
   // TODO: Should gamma be a component of V_ (and thus interpolated between pyramid levels)?
-  gamma_[0] = CImg< double >(width_, height_);
-  gamma_[1] = CImg< double >(width_, height_);
+  workspace_.getImage(GAMMA1_BUFFER, width_, height_, 1, gamma_[0]);
+  workspace_.getImage(GAMMA2_BUFFER, width_, height_, 1, gamma_[1]);
+  
+  // The consistency maps are computed only within the active region, and 
+  // the pixels outside it do not contribute to the weighted averages.
+  gamma_[0].fill(0);
+  gamma_[1].fill(0);
   
   for(i = 0; i < NUM_ITERATIONS_; i++)
   {
@@ -56,42 +82,47 @@ void Proesmans::compute(const CImg< unsigned char > &I1,
     
     for(y = 1; y < height_ - 1; y++)
     {
-      for(x = 1; x < width_ - 1; x++)
+      const vector< pair< int, int > > &spans = activeRegion->getRowSpans(y);
+      
+      for(s = 0; s < (int)spans.size(); s++)
       {
-        for(j = 0; j < 2 ; j++)
+        for(x = max(spans[s].first, 1); x < min(spans[s].second, width_ - 1); x++)
         {
-          computeAvg_(x, y, gamma_[j], V_[j], &vAvg[0]);
-          
-          xd = x + vAvg[0];
-          yd = y + vAvg[1];
-          
-          //iteration step
-          if(xd >= 0 && xd <= width_ - 1 && yd >= 0 && yd <= height_ - 1)
+          for(j = 0; j < 2 ; j++)
           {
-            It = (I_[1 - j].linear_atXY(xd, yd) - I_[j].atXY(x, y)) * INTENSITY_SCALE_;
-            IterationStep_(G_[j](x, y, 0, 0), G_[j](x, y, 0, 1), It, vAvg, &vNext[0]);
-          }
-          else
-          {
-            // use consistency-weighted average as the next value 
-            // if (xd,yd) is outside the image
-            vNext[0] = vAvg[0];
-            vNext[1] = vAvg[1];
+            computeAvg_(x, y, gamma_[j], V_[j], &vAvg[0]);
+            
+            xd = x + vAvg[0];
+            yd = y + vAvg[1];
+            
+            //iteration step
+            if(xd >= 0 && xd <= width_ - 1 && yd >= 0 && yd <= height_ - 1)
+            {
+              It = I_[1 - j].linear_atXY(xd, yd) - I_[j](x, y);
+              IterationStep_(G_[j](x, y, 0, 0), G_[j](x, y, 0, 1), It, vAvg, &vNext[0]);
+            }
+            else
+            {
+              // use consistency-weighted average as the next value 
+              // if (xd,yd) is outside the image
+              vNext[0] = vAvg[0];
+              vNext[1] = vAvg[1];
+            }
+            
+            if(i < NUM_ITERATIONS_)
+            {
+              V_[j](x, y, 0, 0) = vNext[0];
+              V_[j](x, y, 0, 1) = vNext[1];
+            }
           }
-
+          
+          // store quality information (gamma)
           if(i < NUM_ITERATIONS_)
           {
-            V_[j](x, y, 0, 0) = vNext[0];
-            V_[j](x, y, 0, 1) = vNext[1];
+            VF(x, y, 2) = gamma_[0](x, y);
+            VB(x, y, 2) = gamma_[1](x, y);
           }
         }
-        
-        // store quality information (gamma)
-        if(i < NUM_ITERATIONS_)
-        {
-          VF(x, y, 2) = gamma_[0](x, y);
-          VB(x, y, 2) = gamma_[1](x, y);
-        }
       }
     }
     
@@ -101,10 +132,12 @@ void Proesmans::compute(const CImg< unsigned char > &I1,
       repairEdges_(V_[1]);
     }
     
-    printProgressBar_(1.0*i / (NUM_ITERATIONS_ - 1));
+    if(verbose_)
+      printProgressBar_(1.0*i / (NUM_ITERATIONS_ - 1));
   }
   
-  std::cout<<std::endl;
+  if(verbose_)
+    std::cout<<std::endl;
 }
 
 Proesmans::BoundaryConditions Proesmans::getBoundaryConditions() const
@@ -212,6 +245,7 @@ void Proesmans::computeConsistencyMaps_()
   int CCount;
   double K;
   double g;
+  unsigned int s;
   
   for(i = 0; i < 2; i++)
   {
@@ -220,31 +254,36 @@ void Proesmans::computeConsistencyMaps_()
     
     for(y = 0; y < height_; y++)
     {
-      for(x = 0; x < width_; x++)
+      const vector< pair< int, int > > &spans = activeRegion_->getRowSpans(y);
+      
+      for(s = 0; s < spans.size(); s++)
       {
-        /*xd = (int)(x + V_[i](x, y, 0, 0));
-        yd = (int)(y + V_[i](x, y, 0, 1));*/
-        xd = x + V_[i](x, y, 0, 0);
-        yd = y + V_[i](x, y, 0, 1);
-        
-        if(xd >= 0 && yd >= 0 && xd <= width_ - 1 && yd <= height_ - 1)
+        for(x = spans[s].first; x < spans[s].second; x++)
         {
-          /*ub = V_[1 - i](xd, yd, 0, 0);
-          vb = V_[1 - i](xd, yd, 0, 1);*/
-          ub = V_[1 - i].linear_atXY(xd, yd, 0, 0);
-          vb = V_[1 - i].linear_atXY(xd, yd, 0, 1);
-          
-          uDiff = V_[i](x, y, 0, 0) + ub;
-          vDiff = V_[i](x, y, 0, 1) + vb;
-          
-          c = sqrt(uDiff * uDiff + vDiff * vDiff);
+          /*xd = (int)(x + V_[i](x, y, 0, 0));
+          yd = (int)(y + V_[i](x, y, 0, 1));*/
+          xd = x + V_[i](x, y, 0, 0);
+          yd = y + V_[i](x, y, 0, 1);
           
-          gamma_[i](x, y) = c;
-          CSum += c;
-          CCount++;
+          if(xd >= 0 && yd >= 0 && xd <= width_ - 1 && yd <= height_ - 1)
+          {
+            /*ub = V_[1 - i](xd, yd, 0, 0);
+            vb = V_[1 - i](xd, yd, 0, 1);*/
+            ub = V_[1 - i].linear_atXY(xd, yd, 0, 0);
+            vb = V_[1 - i].linear_atXY(xd, yd, 0, 1);
+            
+            uDiff = V_[i](x, y, 0, 0) + ub;
+            vDiff = V_[i](x, y, 0, 1) + vb;
+            
+            c = sqrt(uDiff * uDiff + vDiff * vDiff);
+            
+            gamma_[i](x, y) = c;
+            CSum += c;
+            CCount++;
+          }
+          else
+            gamma_[i](x, y) = -1.0;
         }
-        else
-          gamma_[i](x, y) = -1.0;
       }
     }
     
@@ -256,15 +295,20 @@ void Proesmans::computeConsistencyMaps_()
       {
         for(y = 0; y < height_; y++)
         {
-          for(x = 0; x < width_; x++)
+          const vector< pair< int, int > > &spans = activeRegion_->getRowSpans(y);
+          
+          for(s = 0; s < spans.size(); s++)
           {
-            if(gamma_[i](x, y) >= 0.0)
+            for(x = spans[s].first; x < spans[s].second; x++)
             {
-              g = gamma_[i](x, y);
-              gamma_[i](x, y) = 1.0 / (1.0 + (g / K) * (g / K));
+              if(gamma_[i](x, y) >= 0.0)
+              {
+                g = gamma_[i](x, y);
+                gamma_[i](x, y) = 1.0 / (1.0 + (g / K) * (g / K));
+              }
+              else
+                gamma_[i](x, y) = 0.0;
             }
-            else
-              gamma_[i](x, y) = 0.0;
           }
         }
       }
@@ -272,38 +316,6 @@ void Proesmans::computeConsistencyMaps_()
   }
 }
 
-void Proesmans::computeGradients_(const CImg< unsigned char > &I,
-                                  CImg< double > &G)
-{
-  // This uses 3x3 Sobel kernels for computing partial derivatives.
-  G = CImg< double >(width_, height_, 1, 2);
-  CImg< double > Kx = CImg< double >(3, 3);
-  CImg< double > Ky = CImg< double >(3, 3);
-  
-  Kx(0, 0) = 1.0 / 8.0 * INTENSITY_SCALE_;
-  Kx(1, 0) = 0.0;
-  Kx(2, 0) = -1.0 / 8.0 * INTENSITY_SCALE_;
-  Kx(0, 1) = 2.0 / 8.0 * INTENSITY_SCALE_;
-  Kx(1, 1) = 0.0;
-  Kx(2, 1) = -2.0 / 8.0 * INTENSITY_SCALE_;
-  Kx(0, 2) = 1.0 / 8.0 * INTENSITY_SCALE_;
-  Kx(1, 2) = 0.0;
-  Kx(2, 2) = -1.0 / 8.0 * INTENSITY_SCALE_;
-  
-  Ky(0, 0) = 1.0 / 8.0 * INTENSITY_SCALE_;
-  Ky(1, 0) = 2.0 / 8.0 * INTENSITY_SCALE_;
-  Ky(2, 0) = 1.0 / 8.0 * INTENSITY_SCALE_;
-  Ky(0, 1) = 0.0;
-  Ky(1, 1) = 0.0;
-  Ky(2, 1) = 0.0;
-  Ky(0, 2) = -1.0 / 8.0 * INTENSITY_SCALE_;
-  Ky(1, 2) = -2.0 / 8.0 * INTENSITY_SCALE_;
-  Ky(2, 2) = -1.0 / 8.0 * INTENSITY_SCALE_;
-  
-  G.get_shared_channel(0) = I.get_convolve(Kx, 0);
-  G.get_shared_channel(1) = I.get_convolve(Ky, 0);
-}
-
 void Proesmans::printProgressBar_(double pct)
 {
   cout<< "[";
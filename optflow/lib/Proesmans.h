@@ -1,7 +1,10 @@
 
 #ifndef PROESMANS_H
 
+#include "ActiveRegion.h"
 #include "DualDenseMotionExtractor.h"
+#include "FloatImagePyramid.h"
+#include "Workspace.h"
 
 #include "CImg_config.h"
 #include <CImg.h>
@@ -45,6 +48,13 @@ public:
                CImg< double > &VF,
                CImg< double > &VB);
   
+  void computeLevel(const FloatImagePyramid &P1,
+                    const FloatImagePyramid &P2,
+                    int level,
+                    CImg< double > &VF,
+                    CImg< double > &VB,
+                    const ActiveRegion *activeRegion);
+  
   BoundaryConditions getBoundaryConditions() const;
   
   double getLambda() const;
@@ -58,17 +68,24 @@ public:
   bool isDual() const;
   
   void printInfoText() const;
+  
+  void setVerbose(bool verbose) { verbose_ = verbose; }
 private:
   const BoundaryConditions BOUNDARY_CONDITIONS_;
   const bool COMPUTE_RESIDUALS_;
-  const double INTENSITY_SCALE_;
   const double LAMBDA_;
   const int NUM_ITERATIONS_;
+  bool verbose_;
   
-  CImg< unsigned char > I_[2];
+  enum WorkspaceBuffers { GAMMA1_BUFFER, GAMMA2_BUFFER };
+  
+  const ActiveRegion *activeRegion_;
+  ActiveRegion fullRegion_;
+  CImg< float > I_[2];
   CImg< double > gamma_[2];
-  CImg< double > G_[2];
+  CImg< float > G_[2];
   CImg< double > V_[2];
+  Workspace workspace_;
   
   int width_, height_;
   
@@ -78,9 +95,6 @@ private:
                      const CImg< double > &Vi,
                      double *v);
   
-  void computeGradients_(const CImg< unsigned char > &I, 
-                         CImg< double > &G);
-  
   void computeConsistencyMaps_();
   
   void IterationStep_(double gx,
@@ -1,7 +1,8 @@
 
-#include "DualDenseMotionExtractor.h"
 #include "PyramidalDenseMotionExtractor.h"
 
+#include <algorithm>
+#include <iostream>
 #include <stdexcept>
 
 PyramidalDenseMotionExtractor::~PyramidalDenseMotionExtractor() { }
@@ -18,6 +19,81 @@ void PyramidalDenseMotionExtractor::compute(const CImg< unsigned char > &I1,
                                             const CImg< unsigned char > &I2,
                                             CImg< double > &VF,
                                             CImg< double > &VB)
+{
+  compute_(I1, I2, IntensityTransform(1.0f / 255.0f), NULL, VF, VB);
+}
+
+void PyramidalDenseMotionExtractor::compute(const CImg< unsigned char > &I1,
+                                            const CImg< unsigned char > &I2,
+                                            const CImg< unsigned char > &mask,
+                                            CImg< double > &V)
+{
+  CImg< double > VB; // not used
+  compute_(I1, I2, IntensityTransform(1.0f / 255.0f), &mask, V, VB);
+}
+
+void PyramidalDenseMotionExtractor::compute(const CImg< unsigned char > &I1,
+                                            const CImg< unsigned char > &I2,
+                                            const CImg< unsigned char > &mask,
+                                            CImg< double > &VF,
+                                            CImg< double > &VB)
+{
+  compute_(I1, I2, IntensityTransform(1.0f / 255.0f), &mask, VF, VB);
+}
+
+void PyramidalDenseMotionExtractor::compute(const CImg< float > &I1,
+                                            const CImg< float > &I2,
+                                            const IntensityTransform &transform,
+                                            CImg< double > &VF,
+                                            CImg< double > &VB,
+                                            const CImg< unsigned char > *mask)
+{
+  compute_(I1, I2, transform, mask, VF, VB);
+}
+
+void PyramidalDenseMotionExtractor::compute(const CImg< unsigned short > &I1,
+                                            const CImg< unsigned short > &I2,
+                                            const IntensityTransform &transform,
+                                            CImg< double > &VF,
+                                            CImg< double > &VB,
+                                            const CImg< unsigned char > *mask)
+{
+  compute_(I1, I2, transform, mask, VF, VB);
+}
+
+bool PyramidalDenseMotionExtractor::isDual() const
+{
+  return motionExtractor->isDual();
+}
+
+void PyramidalDenseMotionExtractor::setMaskDilationRadius(int radius)
+{
+  maskDilationRadius_ = radius;
+}
+
+void PyramidalDenseMotionExtractor::setVerbose(bool verbose)
+{
+  verbose_ = verbose;
+  motionExtractor->setVerbose(verbose);
+}
+
+PyramidalDenseMotionExtractor::PyramidalDenseMotionExtractor(int numLevels) : 
+  NUMLEVELS(numLevels), masked_(false), maskDilationRadius_(8), verbose_(true)
+{ }
+
+void PyramidalDenseMotionExtractor::printActiveRegionInfo_() const
+{
+  if(masked_)
+    cout<<"Active region: "<<100.0 * activeRegions_[0].getActiveFraction()<<" %"<<endl;
+}
+
+template < class T >
+void PyramidalDenseMotionExtractor::compute_(const CImg< T > &I1,
+                                             const CImg< T > &I2,
+                                             const IntensityTransform &transform,
+                                             const CImg< unsigned char > *mask,
+                                             CImg< double > &VF,
+                                             CImg< double > &VB)
 {
   const int W = I1.width();
   const int H = I1.height();
@@ -28,133 +104,202 @@ void PyramidalDenseMotionExtractor::compute(const CImg< unsigned char > &I1,
   // Check that the input images have the same dimensions;
   if(I1.width() != I2.width() || I1.height() != I2.height())
     throw invalid_argument("The dimensions of the input images must match.");
+  if(mask != NULL && (mask->width() != W || mask->height() != H))
+    throw invalid_argument("The dimensions of the mask and the input images must match.");
   
-  imagePyramids[0] = ImagePyramid(I1, NUMLEVELS);
-  imagePyramids[1] = ImagePyramid(I2, NUMLEVELS);
+  // The pyramids are independent, so they are constructed concurrently. 
+  // Their memory is reused if the image dimensions do not change.
+#pragma omp parallel sections num_threads(2)
+  {
+#pragma omp section
+    imagePyramids[0].assign(I1, NUMLEVELS, transform);
+#pragma omp section
+    imagePyramids[1].assign(I2, NUMLEVELS, transform);
+  }
   
   if(VF.width() != W || VF.height() != H || VF.spectrum() != getNumResultChannels())
-    VF = CImg< double >(W, H, 1, 2 + getNumResultQualityChannels());
+    VF.assign(W, H, 1, getNumResultChannels());
   if(isDual())
   {
     if(VB.width() != W || VB.height() != H || VB.spectrum() != getNumResultChannels())
-      VB = CImg< double >(W, H, 1, 2 + getNumResultQualityChannels());
+      VB.assign(W, H, 1, getNumResultChannels());
   }
   
   baseWidth = W;
   baseHeight = H;
   
-  printInfoText();
+  // The active region of each level is obtained by downsampling the 
+  // dilated mask.
+  masked_ = mask != NULL;
+  if(mask != NULL)
+  {
+    activeRegions_.resize(NUMLEVELS);
+    activeRegions_[0].assign(*mask, maskDilationRadius_);
+    for(int i = 1; i < NUMLEVELS; i++)
+      activeRegions_[i - 1].downsample(activeRegions_[i]);
+  }
   
-  curLevelW = imagePyramids[0].getImageLevel(NUMLEVELS - 1).width();
-  curLevelH = imagePyramids[0].getImageLevel(NUMLEVELS - 1).height();
+  if(verbose_)
+    printInfoText();
   
-  curLevelVF = CImg< double >(curLevelW, curLevelH, 1, getNumResultChannels());
+  getLevelFields_(NUMLEVELS - 1, VF, VB, curLevelVF, curLevelVB);
   curLevelVF.fill(0);
   if(isDual())
-  {
-    curLevelVB = CImg< double >(curLevelW, curLevelH, 1, getNumResultChannels());
     curLevelVB.fill(0);
-  }
   
   for(int i = NUMLEVELS - 1; i >= 0; i--)
   {
-    computeLevel_(i, curLevelVF, curLevelVB);
-    
-    if(i > 0)
+    if(mask != NULL)
     {
-      curLevelW = imagePyramids[0].getImageLevel(i-1).width();
-      curLevelH = imagePyramids[0].getImageLevel(i-1).height();
+      computeLevel_(i, curLevelVF, curLevelVB, &activeRegions_[i]);
       
-      nextLevelVF = CImg< double >(curLevelW, curLevelH, 1, getNumResultChannels());
-      nextLevelVF.fill(0);
+      activeRegions_[i].fillInactive(curLevelVF);
       if(isDual())
-      {
-        nextLevelVB = CImg< double >(curLevelW, curLevelH, 1, getNumResultChannels());
-	nextLevelVB.fill(0);
-      }
-      
+        activeRegions_[i].fillInactive(curLevelVB);
+    }
+    else
+      computeLevel_(i, curLevelVF, curLevelVB, NULL);
+    
+    if(i > 0)
+    {
+      getLevelFields_(i - 1, VF, VB, nextLevelVF, nextLevelVB);
       initializeNextLevel_(nextLevelVF, nextLevelVB);
       
-      curLevelVF = nextLevelVF;
+      curLevelVF.assign(nextLevelVF, true);
       if(isDual())
-        curLevelVB = nextLevelVB;
+        curLevelVB.assign(nextLevelVB, true);
     }
   }
-  
-  VF = curLevelVF;
-  if(isDual())
-    VB = curLevelVB;
 }
 
-bool PyramidalDenseMotionExtractor::isDual() const
+void PyramidalDenseMotionExtractor::computeLevel_(int level,
+                                                  CImg< double > &VF,
+                                                  CImg< double > &VB,
+                                                  const ActiveRegion *activeRegion)
 {
-  return motionExtractor->isDual();
+  motionExtractor->computeLevel(imagePyramids[0], imagePyramids[1], level, VF, VB, 
+                                activeRegion);
 }
 
-PyramidalDenseMotionExtractor::PyramidalDenseMotionExtractor(int numLevels) : 
-  NUMLEVELS(numLevels)
-{ }
-
-void PyramidalDenseMotionExtractor::computeLevel_(int level,
-                                                  CImg< double > &VF,
-                                                  CImg< double > &VB)
+void PyramidalDenseMotionExtractor::getLevelFields_(int level,
+                                                     CImg< double > &VF,
+                                                     CImg< double > &VB,
+                                                     CImg< double > &levelVF,
+                                                     CImg< double > &levelVB)
 {
-  curLevelI[0].assign(imagePyramids[0].getImageLevel(level), true);
-  curLevelI[1].assign(imagePyramids[1].getImageLevel(level), true);
+  curLevelW = imagePyramids[0].getImageLevel(level).width();
+  curLevelH = imagePyramids[0].getImageLevel(level).height();
   
-  if(isDual())
-    dynamic_cast< DualDenseMotionExtractor * >(motionExtractor)->
-      compute(curLevelI[0], curLevelI[1], VF, VB);
+  if(level == 0)
+  {
+    // The finest level is computed directly into the output fields.
+    levelVF.assign(VF, true);
+    if(isDual())
+      levelVB.assign(VB, true);
+  }
   else
-    motionExtractor->compute(curLevelI[0], curLevelI[1], VF);
+  {
+    // Adjacent levels use different buffers so that the current level can 
+    // be upsampled into the next one.
+    workspace_.getImage(level % 2, curLevelW, curLevelH, getNumResultChannels(), levelVF);
+    if(isDual())
+      workspace_.getImage(2 + level % 2, curLevelW, curLevelH, getNumResultChannels(), levelVB);
+  }
 }
 
 void PyramidalDenseMotionExtractor::initializeNextLevel_(CImg< double > &nextLevelVF,
                                                          CImg< double > &nextLevelVB)
 {
-  const int W_NEW = nextLevelVF.width();
-  const int H_NEW = nextLevelVF.height();
+  // The fields are upsampled one after another. upsampleField_ distributes 
+  // the rows over all threads, so running the two calls in parallel 
+  // sections would only nest a second team (serialized by default) or 
+  // limit each field to half of the threads.
+  upsampleField_(curLevelVF, 2.0, nextLevelVF);
+  if(isDual())
+    upsampleField_(curLevelVB, 2.0, nextLevelVB);
+}
+
+void PyramidalDenseMotionExtractor::upsampleField_(const CImg< double > &V,
+                                                   double factor,
+                                                   CImg< double > &nextLevelV)
+{
+  const int W = V.width();
+  const int H = V.height();
+  const int W_NEW = nextLevelV.width();
+  const int H_NEW = nextLevelV.height();
+  const int C = min(V.spectrum(), nextLevelV.spectrum());
+  // exact 2x upsampling: even columns are copied and odd ones are averaged
+  const bool HALF_STEPS = factor == 2.0 && (W_NEW + 1) / 2 <= W;
   
-  double vxf, vyf;
-  double vxb, vyb;
+  // Precompute the source indices and interpolation weights of the columns 
+  // and rows. Coordinates beyond the last column or row are clamped to it.
+  vector< int > x0(W_NEW), x1(W_NEW), y0(H_NEW), y1(H_NEW);
+  vector< double > wx(W_NEW), wy(H_NEW);
   
-  double xc, yc;
-  int xn, yn;
+  for(int xn = 0; xn < W_NEW; xn++)
+  {
+    const double XC = min(xn / factor, W - 1.0);
+    x0[xn] = (int)XC;
+    x1[xn] = min(x0[xn] + 1, W - 1);
+    wx[xn] = XC - x0[xn];
+  }
+  for(int yn = 0; yn < H_NEW; yn++)
+  {
+    const double YC = min(yn / factor, H - 1.0);
+    y0[yn] = (int)YC;
+    y1[yn] = min(y0[yn] + 1, H - 1);
+    wy[yn] = YC - y0[yn];
+  }
   
-  for(yn = 0; yn < H_NEW; yn++)
+  // The interpolation is separable: each output row is computed by 
+  // interpolating two source rows vertically and the result horizontally. 
+  // The vector components are scaled by the upsampling factor and the 
+  // quality channels are interpolated as such.
+#pragma omp parallel
   {
-    yc = ((double)yn) / 2.0;
-    for(xn = 0; xn < W_NEW; xn++)
+    vector< double > row(W);
+
+#pragma omp for schedule(static)
+    for(int yn = 0; yn < H_NEW; yn++)
     {
-      xc = ((double)xn) / 2.0;
-      if(xn % 2 != 0 || yn % 2 != 0)
+      for(int c = 0; c < C; c++)
       {
-        vxf = curLevelVF.linear_atXY(xc, yc, 0, 0);
-        vyf = curLevelVF.linear_atXY(xc, yc, 0, 1);
-        if(isDual())
+        const double *r0 = V.data(0, y0[yn], 0, c);
+        const double *r1 = V.data(0, y1[yn], 0, c);
+        const double S = c < 2 ? factor : 1.0;
+        const double WY = wy[yn];
+        double *dest = nextLevelV.data(0, yn, 0, c);
+        int xn;
+        
+        for(int x = 0; x < W; x++)
+          row[x] = S * (r0[x] + WY * (r1[x] - r0[x]));
+        
+        if(HALF_STEPS)
         {
-          vxb = curLevelVB.linear_atXY(xc, yc, 0, 0);
-          vyb = curLevelVB.linear_atXY(xc, yc, 0, 1);
+          // The right neighbour of an odd column is the next source column, 
+          // so the loop reads the row contiguously instead of through x1. 
+          // Only the last odd column can be clamped to the last source column.
+          const int NUM_AVERAGED = min(W_NEW / 2, W - 1);
+          
+          for(xn = 0; xn < NUM_AVERAGED; xn++)
+          {
+            dest[2*xn]     = row[xn];
+            dest[2*xn + 1] = 0.5 * (row[xn] + row[xn + 1]);
+          }
+          for(; xn < W_NEW / 2; xn++)
+          {
+            dest[2*xn]     = row[xn];
+            dest[2*xn + 1] = row[xn];
+          }
+          if(W_NEW % 2 != 0)
+            dest[W_NEW - 1] = row[W_NEW / 2];
         }
-      }
-      else
-      {
-        vxf = curLevelVF(xc, yc, 0, 0);
-        vyf = curLevelVF(xc, yc, 0, 1);
-        if(isDual())
+        else
         {
-          vxb = curLevelVB(xc, yc, 0, 0);
-          vyb = curLevelVB(xc, yc, 0, 1);
+          for(xn = 0; xn < W_NEW; xn++)
+            dest[xn] = row[x0[xn]] + wx[xn] * (row[x1[xn]] - row[x0[xn]]);
         }
       }
-      
-      nextLevelVF(xn, yn, 0, 0) = 2.0 * vxf;
-      nextLevelVF(xn, yn, 0, 1) = 2.0 * vyf;
-      if(isDual())
-      {
-        nextLevelVB(xn, yn, 0, 0) = 2.0 * vxb;
-        nextLevelVB(xn, yn, 0, 1) = 2.0 * vyb;
-      }
     }
   }
 }
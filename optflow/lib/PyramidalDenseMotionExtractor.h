@@ -1,10 +1,14 @@
 
 #ifndef PYRAMIDALMOTIONEXTRACTOR_H
 
-#include "ImagePyramid.h"
+#include "ActiveRegion.h"
+#include "FloatImagePyramid.h"
 #include "DenseMotionExtractor.h"
+#include "IntensityTransform.h"
+#include "Workspace.h"
 
 #include <exception>
+#include <vector>
 #include "CImg_config.h"
 #include <CImg.h>
 
@@ -56,8 +60,90 @@ public:
                CImg< double > &VF,
                CImg< double > &VB);
   
+  /// Computes the motion field from image 1 to image 2 within a masked region.
+  /**
+   * The mask is dilated by the mask dilation radius, and the active region 
+   * of each pyramid level is obtained by downsampling it.
+   * @param[in] I1 the first source image
+   * @param[in] I2 the second source image
+   * @param[in] mask the mask image, nonzero pixels are active
+   * @param[out] V the computed motion field
+   */
+  void compute(const CImg< unsigned char > &I1,
+               const CImg< unsigned char > &I2,
+               const CImg< unsigned char > &mask,
+               CImg< double > &V);
+  
+  /// Computes both forward and backward motion fields within a masked region.
+  /**
+   * @param[in] I1 the first source image
+   * @param[in] I2 the second source image
+   * @param[in] mask the mask image, nonzero pixels are active
+   * @param[out] VF the computed forward motion field (I1->I2)
+   * @param[out] VB the computed backward motion field (I2->I1)
+   */
+  void compute(const CImg< unsigned char > &I1,
+               const CImg< unsigned char > &I2,
+               const CImg< unsigned char > &mask,
+               CImg< double > &VF,
+               CImg< double > &VB);
+  
+  /// Computes the motion fields between two floating-point images.
+  /**
+   * The intensity transform is applied when the image pyramids are 
+   * constructed.
+   * @param[in] I1 the first source image
+   * @param[in] I2 the second source image
+   * @param[in] transform the transform mapping the pixel values to intensities
+   * @param[out] VF the computed forward motion field (I1->I2)
+   * @param[out] VB the computed backward motion field (I2->I1), used only 
+   * if the motion extractor is dual
+   * @param[in] mask the mask image (optional), nonzero pixels are active
+   */
+  void compute(const CImg< float > &I1,
+               const CImg< float > &I2,
+               const IntensityTransform &transform,
+               CImg< double > &VF,
+               CImg< double > &VB,
+               const CImg< unsigned char > *mask = NULL);
+  
+  /// Computes the motion fields between two 16-bit images.
+  /**
+   * See the floating-point version of this method.
+   */
+  void compute(const CImg< unsigned short > &I1,
+               const CImg< unsigned short > &I2,
+               const IntensityTransform &transform,
+               CImg< double > &VF,
+               CImg< double > &VB,
+               const CImg< unsigned char > *mask = NULL);
+  
+  /// Returns the radius (in pixels) by which masks are dilated.
+  int getMaskDilationRadius() const { return maskDilationRadius_; }
+  
+  /// Returns the number of pyramid levels.
+  int getNumLevels() const { return NUMLEVELS; }
+  
   /// Returns true if the single-resolution motion extractor uses two-directional flows.
   bool isDual() const;
+  
+  /// Returns true if compute prints the information text.
+  bool isVerbose() const { return verbose_; }
+  
+  /// Sets the radius (in pixels) by which masks are dilated (default = 8).
+  /**
+   * The dilation should cover the expected displacements so that the 
+   * motion at the edges of the masked areas is computed.
+   */
+  void setMaskDilationRadius(int radius);
+  
+  /// Sets whether compute prints the information text (default = true).
+  /**
+   * The setting is passed to the single-resolution motion extractor. 
+   * Extractors that run this one on parts of an image (e.g. 
+   * TiledDenseMotionExtractor) disable the output.
+   */
+  void setVerbose(bool verbose);
 protected:
   const int NUMLEVELS;
   
@@ -68,15 +154,10 @@ protected:
   int curLevelH, curLevelW;
   
   // pyramids for the first and second input image
-  ImagePyramid imagePyramids[2];
-  
-  // gradients of the current level
-  CImg< double > curLevelG[2];
-  
-  // input images in the current pyramid level
-  CImg< unsigned char > curLevelI[2];
+  FloatImagePyramid imagePyramids[2];
   
-  // current forward flow (and backward flow if used)
+  // current forward flow (and backward flow if used), these share memory 
+  // with the workspace or the output fields
   CImg< double > curLevelVF;
   CImg< double > curLevelVB;
   
@@ -85,17 +166,54 @@ protected:
   
   // Constructs a pyramidal motion extractor with a given number of levels.
   PyramidalDenseMotionExtractor(int numLevels);
+  
+  // prints the fraction of active pixels if the last computation used a 
+  // mask, called at the end of printInfoText
+  void printActiveRegionInfo_() const;
 private:
+  // reusable buffers for the motion fields of the coarser levels
+  Workspace workspace_;
+  
+  // active regions of the pyramid levels when a mask is used
+  vector< ActiveRegion > activeRegions_;
+  bool masked_;
+  int maskDilationRadius_;
+  bool verbose_;
+  
+  // computes the motion fields, the mask is optional
+  template < class T >
+  void compute_(const CImg< T > &I1,
+                const CImg< T > &I2,
+                const IntensityTransform &transform,
+                const CImg< unsigned char > *mask,
+                CImg< double > &VF,
+                CImg< double > &VB);
+  
   // computes motion vectors for the current level
   void computeLevel_(int level,
                      CImg< double > &VF,
-                     CImg< double > &VB);
+                     CImg< double > &VB,
+                     const ActiveRegion *activeRegion);
+  
+  // assigns the motion fields of the given level to share memory with the 
+  // workspace (or with VF and VB for the finest level)
+  void getLevelFields_(int level,
+                       CImg< double > &VF,
+                       CImg< double > &VB,
+                       CImg< double > &levelVF,
+                       CImg< double > &levelVB);
   
-  // initializes the next motion vector level, i.e. copies the current vectors 
-  // to the next level with each vector multiplied by 2 and interpolated 
-  // if necessary
+  // initializes the next motion vector level, i.e. upsamples the current 
+  // fields to the next level with each vector multiplied by 2
   void initializeNextLevel_(CImg< double > &nextLevelVF,
                             CImg< double > &nextLevelVB);
+  
+  // upsamples all channels of a motion vector field by the given factor with 
+  // bilinear interpolation, the vectors (channels 0 and 1) are multiplied by 
+  // the factor
+  static void upsampleField_(const CImg< double > &V,
+                             double factor,
+                             CImg< double > &nextLevelV);
 };
 
 #define PYRAMIDALMOTIONEXTRACTOR_H
@@ -43,4 +43,6 @@ void PyramidalHornSchunck::printInfoText() const
     cout<<"Neumann"<<endl;
   else
     cout<<"Dirichlet"<<endl;
+  
+  printActiveRegionInfo_();
 }
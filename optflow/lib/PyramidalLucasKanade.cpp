@@ -40,4 +40,6 @@ void PyramidalLucasKanade::printInfoText() const
   cout<<"Tau (eigenvalue threshold): "<<me->getTau()<<endl;
   cout<<"Sigmap (regularization parameter): "<<me->getSigmap()<<endl;
   cout<<"Number of pyramid levels: "<<NUMLEVELS<<endl;
+  
+  printActiveRegionInfo_();
 }
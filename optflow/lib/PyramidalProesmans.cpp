@@ -40,4 +40,6 @@ void PyramidalProesmans::printInfoText() const
     cout<<"Neumann"<<endl;
   else
     cout<<"Dirichlet"<<endl;
+  
+  printActiveRegionInfo_();
 }
@@ -0,0 +1,201 @@
+
+#include "SemiLagrangianDenseImageExtrapolator.h"
+#include "WarpSampling.h"
+
+#include "CImg_config.h"
+#include <CImg.h>
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+using namespace cimg_library;
+using namespace std;
+
+// Computes the bilinear interpolation weights at (x, y). The coordinates 
+// are clamped to the image, so the returned indices are always valid. 
+// Returns false if (x, y) is outside the image. NaN coordinates are 
+// outside and mapped to zero. The computation is branch-free so that the 
+// loops calling this can be vectorized.
+static inline bool bilinearWeights_(double x, double y, int W, int H,
+                                    size_t &i00, size_t &i10,
+                                    size_t &i01, size_t &i11,
+                                    double &wx, double &wy)
+{
+  const bool INSIDE = WarpSampling::isInside(x, y, W, H);
+  const double XC = WarpSampling::clampCoordinate(x, W);
+  const double YC = WarpSampling::clampCoordinate(y, H);
+  const int X0 = (int)XC;
+  const int Y0 = (int)YC;
+  const int X1 = X0 + (X0 < W - 1);
+  const int Y1 = Y0 + (Y0 < H - 1);
+  
+  i00 = (size_t)Y0 * W + X0;
+  i10 = (size_t)Y0 * W + X1;
+  i01 = (size_t)Y1 * W + X0;
+  i11 = (size_t)Y1 * W + X1;
+  wx = XC - X0;
+  wy = YC - Y0;
+  
+  return INSIDE;
+}
+
+template < class T >
+static inline double bilinear_(const T *f, size_t i00, size_t i10,
+                               size_t i01, size_t i11, double wx, double wy)
+{
+  const double F0 = f[i00] + wx * ((double)f[i10] - f[i00]);
+  const double F1 = f[i01] + wx * ((double)f[i11] - f[i01]);
+  
+  return F0 + wy * (F1 - F0);
+}
+
+SemiLagrangianDenseImageExtrapolator::SemiLagrangianDenseImageExtrapolator(
+  int numSteps, int numIter, bool inverse) : 
+  numSteps_(numSteps), numIter_(numIter), inverse_(inverse)
+{
+  if(numSteps < 1)
+    throw invalid_argument("The number of integration steps must be positive.");
+  if(numIter < 1)
+    throw invalid_argument("The number of iterations must be positive.");
+}
+
+void SemiLagrangianDenseImageExtrapolator::extrapolate(const CImg< unsigned char > &I0,
+                                                       const CImg< double > &V,
+                                                       double multiplier,
+                                                       CImg< unsigned char > &Ie) const
+{
+  extrapolate_(I0, V, multiplier, 1, Ie);
+}
+
+void SemiLagrangianDenseImageExtrapolator::extrapolate(const CImg< unsigned short > &I0,
+                                                       const CImg< double > &V,
+                                                       double multiplier,
+                                                       CImg< unsigned short > &Ie) const
+{
+  extrapolate_(I0, V, multiplier, 1, Ie);
+}
+
+void SemiLagrangianDenseImageExtrapolator::extrapolate(const CImg< float > &I0,
+                                                       const CImg< double > &V,
+                                                       double multiplier,
+                                                       CImg< float > &Ie) const
+{
+  extrapolate_(I0, V, multiplier, 1, Ie);
+}
+
+void SemiLagrangianDenseImageExtrapolator::extrapolate(const CImg< unsigned char > &I0,
+                                                       const CImg< double > &V,
+                                                       double timeStep,
+                                                       int numLeadTimes,
+                                                       CImg< unsigned char > &Ie) const
+{
+  extrapolate_(I0, V, timeStep, numLeadTimes, Ie);
+}
+
+void SemiLagrangianDenseImageExtrapolator::extrapolate(const CImg< unsigned short > &I0,
+                                                       const CImg< double > &V,
+                                                       double timeStep,
+                                                       int numLeadTimes,
+                                                       CImg< unsigned short > &Ie) const
+{
+  extrapolate_(I0, V, timeStep, numLeadTimes, Ie);
+}
+
+void SemiLagrangianDenseImageExtrapolator::extrapolate(const CImg< float > &I0,
+                                                       const CImg< double > &V,
+                                                       double timeStep,
+                                                       int numLeadTimes,
+                                                       CImg< float > &Ie) const
+{
+  extrapolate_(I0, V, timeStep, numLeadTimes, Ie);
+}
+
+template < class T >
+void SemiLagrangianDenseImageExtrapolator::extrapolate_(const CImg< T > &I0,
+                                                        const CImg< double > &V,
+                                                        double timeStep,
+                                                        int numLeadTimes,
+                                                        CImg< T > &Ie) const
+{
+  const int W = I0.width();
+  const int H = I0.height();
+  
+  if(V.width() != W || V.height() != H || V.spectrum() < 2)
+    throw invalid_argument("The image and the motion field must have the same dimensions.");
+  if(numLeadTimes < 1)
+    throw invalid_argument("The number of lead times must be positive.");
+  
+  if(Ie.width() != W || Ie.height() != H || Ie.depth() != numLeadTimes ||
+     Ie.spectrum() != 1)
+    Ie.assign(W, H, numLeadTimes, 1);
+  
+  const double DT = timeStep / numSteps_;
+  const double COEFF = inverse_ ? -1.0 : 1.0;
+  const T MISSING = WarpSampling::getFillValue< T >(ImageWarp::FILL_NAN, 0.0f);
+  const T *src = I0.data();
+  const double *U = V.data(0, 0, 0, 0);
+  const double *Vy = V.data(0, 0, 0, 1);
+  
+  // Each row of trajectories is integrated independently. The total 
+  // displacements and the validity flags of the row are kept in small 
+  // buffers, and the image is sampled after each time step.
+#pragma omp parallel
+  {
+    vector< double > dx(W), dy(W), incx(W), incy(W);
+    vector< unsigned char > valid(W);
+
+#pragma omp for schedule(static)
+    for(int y = 0; y < H; y++)
+    {
+      int x;
+      
+      fill(dx.begin(), dx.end(), 0.0);
+      fill(dy.begin(), dy.end(), 0.0);
+      fill(valid.begin(), valid.end(), 1);
+      
+      for(int k = 0; k < numLeadTimes; k++)
+      {
+        for(int s = 0; s < numSteps_; s++)
+        {
+          fill(incx.begin(), incx.end(), 0.0);
+          fill(incy.begin(), incy.end(), 0.0);
+          
+          // Fixed-point iteration for the displacement at the midpoint.
+          for(int j = 0; j < numIter_; j++)
+          {
+            for(x = 0; x < W; x++)
+            {
+              size_t i00, i10, i01, i11;
+              double wx, wy;
+              
+              const bool INSIDE = bilinearWeights_(x + dx[x] + COEFF * 0.5 * incx[x],
+                                                   y + dy[x] + COEFF * 0.5 * incy[x],
+                                                   W, H, i00, i10, i01, i11, wx, wy);
+              valid[x] &= INSIDE;
+              incx[x] = DT * bilinear_(U, i00, i10, i01, i11, wx, wy);
+              incy[x] = DT * bilinear_(Vy, i00, i10, i01, i11, wx, wy);
+            }
+          }
+          
+          for(x = 0; x < W; x++)
+          {
+            dx[x] += COEFF * incx[x];
+            dy[x] += COEFF * incy[x];
+          }
+        }
+        
+        T *dest = Ie.data(0, y, k);
+        for(x = 0; x < W; x++)
+        {
+          size_t i00, i10, i01, i11;
+          double wx, wy;
+          
+          const bool INSIDE = bilinearWeights_(x + dx[x], y + dy[x], W, H,
+                                               i00, i10, i01, i11, wx, wy);
+          const T VALUE = WarpSampling::toPixel< T >(bilinear_(src, i00, i10, i01, i11, wx, wy));
+          dest[x] = valid[x] && INSIDE ? VALUE : MISSING;
+        }
+      }
+    }
+  }
+}
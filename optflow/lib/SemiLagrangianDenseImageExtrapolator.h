@@ -0,0 +1,102 @@
+
+#ifndef SEMILAGRANGIANDENSEIMAGEEXTRAPOLATOR_H
+
+#include "DenseImageExtrapolator.h"
+
+/// Implements semi-Lagrangian image extrapolation with dense motion fields.
+/**
+ * Differently to InverseDenseImageExtrapolator, this method integrates 
+ * the trajectories of the pixels along the motion field. This allows 
+ * modeling nonlinear motion such as rotation. Each time step is divided 
+ * into numSteps integration steps, and the displacement of each step is 
+ * computed from the motion field at the midpoint of the step by using 
+ * numIter fixed-point iterations. This is the same scheme as in 
+ * pyoptflow.extrapolation.semilagrangian.
+ *
+ * The pixels whose trajectory crosses the image boundary are set to NaN 
+ * in floating-point images and to zero in integer images.
+ *
+ * The trajectories are integrated only once when extrapolating the image 
+ * to multiple lead times: the image at lead time k is sampled from the 
+ * trajectory after k time steps. The rows are processed in parallel, and 
+ * all lead times of a row are computed in a single pass.
+ */
+class SemiLagrangianDenseImageExtrapolator : public DenseImageExtrapolator
+{
+public:
+  /// Constructs an extrapolator.
+  /**
+   * Throws invalid_argument if numSteps or numIter is not positive.
+   * @param numSteps the number of integration steps per time step
+   * @param numIter the number of inner iterations per integration step
+   * @param inverse if true, V is interpreted as a forward motion field 
+   * (image1->image2), and the trajectories are integrated backward. 
+   * Otherwise V is interpreted as an inverse motion field (image2->image1), 
+   * and the trajectories are integrated forward along it.
+   */
+  SemiLagrangianDenseImageExtrapolator(int numSteps = 1,
+                                       int numIter = 3,
+                                       bool inverse = true);
+  
+  void extrapolate(const CImg< unsigned char > &I0,
+                   const CImg< double > &V,
+                   double multiplier,
+                   CImg< unsigned char > &Ie) const;
+  
+  void extrapolate(const CImg< unsigned short > &I0,
+                   const CImg< double > &V,
+                   double multiplier,
+                   CImg< unsigned short > &Ie) const;
+  
+  void extrapolate(const CImg< float > &I0,
+                   const CImg< double > &V,
+                   double multiplier,
+                   CImg< float > &Ie) const;
+  
+  /// Extrapolates the given image to multiple lead times.
+  /**
+   * Throws invalid_argument if the dimensions of I0 and V do not match 
+   * or numLeadTimes is not positive.
+   * @param[in] I0 the image to extrapolate
+   * @param[in] V the motion field to use
+   * @param[in] timeStep the time step between successive lead times
+   * @param[in] numLeadTimes the number of lead times
+   * @param[out] Ie the extrapolated images. Slice k (the z-coordinate) 
+   * contains the image at lead time (k+1)*timeStep. If Ie already has the 
+   * dimensions W x H x numLeadTimes, its memory is reused.
+   */
+  void extrapolate(const CImg< unsigned char > &I0,
+                   const CImg< double > &V,
+                   double timeStep,
+                   int numLeadTimes,
+                   CImg< unsigned char > &Ie) const;
+  
+  /// Extrapolates the given 16-bit image to multiple lead times.
+  void extrapolate(const CImg< unsigned short > &I0,
+                   const CImg< double > &V,
+                   double timeStep,
+                   int numLeadTimes,
+                   CImg< unsigned short > &Ie) const;
+  
+  /// Extrapolates the given floating-point image to multiple lead times.
+  void extrapolate(const CImg< float > &I0,
+                   const CImg< double > &V,
+                   double timeStep,
+                   int numLeadTimes,
+                   CImg< float > &Ie) const;
+private:
+  int numSteps_;
+  int numIter_;
+  bool inverse_;
+  
+  template < class T >
+  void extrapolate_(const CImg< T > &I0,
+                    const CImg< double > &V,
+                    double timeStep,
+                    int numLeadTimes,
+                    CImg< T > &Ie) const;
+};
+
+#define SEMILAGRANGIANDENSEIMAGEEXTRAPOLATOR_H
+
+#endif
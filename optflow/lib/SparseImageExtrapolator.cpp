@@ -9,11 +9,12 @@
 
 void SparseImageExtrapolator::constructUniformMesh(int w, int h, int n,
                                                    vector< Point > &points,
-                                                   list< int > &indices) const
+                                                   vector< int > &indices) const
 {
   const int POLYWIDTH = w / n;
   const int POLYHEIGHT = h / n;
   
+  indices.reserve(indices.size() + 6 * (size_t)n * n);
   for(int y = 0; y <= h; y += POLYHEIGHT)
     for(int x = 0; x <= w; x += POLYWIDTH)
       points.push_back(Point(x, y));
@@ -41,7 +42,7 @@ void SparseImageExtrapolator::extrapolate(const CImg< unsigned char > &I0,
 {
   vector< Point > points1;
   vector< Point > points2;
-  list< int > indices;
+  vector< int > indices;
   double u, v;
   int x, y;
   
@@ -72,7 +73,7 @@ void SparseImageExtrapolator::extrapolate(const CImg< unsigned char > &I0,
 void SparseImageExtrapolator::extrapolate_(const CImg< unsigned char > &I0,
                                            const vector< Point > &featurePoints1,
                                            const vector< Point > &featurePoints2,
-                                           const list< int > &triIndices,
+                                           TriIndexView triIndices,
                                            double multiplier,
                                            CImg< unsigned char > &Ie) const
 {
@@ -85,16 +86,15 @@ void SparseImageExtrapolator::extrapolate_(const CImg< unsigned char > &I0,
   Ie = CImg< unsigned char >(I0.width(), I0.height(), 1, 1);
   Ie.fill(0);
   
-  for(list< int > ::const_iterator i = triIndices.begin(); i != triIndices.end(); )
+  for(const int *i = triIndices.begin(); i != triIndices.end(); i += 3)
   {
     for(int ii = 0; ii < 3; ii++)
     {
-      index[ii] = *i;
-      x1[ii] = featurePoints1[*i].x();
-      y1[ii] = featurePoints1[*i].y();
-      x2[ii] = x1[ii] + multiplier * (featurePoints2[*i].x() - x1[ii]);
-      y2[ii] = y1[ii] + multiplier * (featurePoints2[*i].y() - y1[ii]);
-      i++;
+      index[ii] = i[ii];
+      x1[ii] = featurePoints1[i[ii]].x();
+      y1[ii] = featurePoints1[i[ii]].y();
+      x2[ii] = x1[ii] + multiplier * (featurePoints2[i[ii]].x() - x1[ii]);
+      y2[ii] = y1[ii] + multiplier * (featurePoints2[i[ii]].y() - y1[ii]);
     }
     
     // Draw a warped triangle to the destination image with 
@@ -4,7 +4,6 @@
 
 #include "SparseVectorField.h"
 
-#include <list>
 #include <vector>
 
 namespace cimg_library { template < class T > class CImg; }
@@ -57,13 +56,13 @@ private:
   void extrapolate_(const CImg< unsigned char > &I0,
                     const vector< Point > &featurePoints1,
                     const vector< Point > &featurePoints2,
-                    const list< int > &triIndices,
+                    TriIndexView triIndices,
                     double multiplier,
                     CImg< unsigned char > &Ie) const;
   
   void constructUniformMesh(int w, int h, int n,
                             vector< Point > &points,
-                            list< int > &indices) const;
+                            vector< int > &indices) const;
 };
 
 #define SPARSEIMAGEEXTRAPOLATOR_H
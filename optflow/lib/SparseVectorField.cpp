@@ -5,11 +5,16 @@
 
 #include <CGAL/Delaunay_triangulation_2.h>
 #include <CGAL/Simple_cartesian.h>
+#include <CGAL/Triangulation_vertex_base_with_info_2.h>
 #include <iomanip>
 #include <stdexcept>
+#include <utility>
 
 typedef CGAL::Simple_cartesian< double > K;
-typedef CGAL::Delaunay_triangulation_2< K > Delaunay;
+// The vertices store the indices of the points.
+typedef CGAL::Triangulation_vertex_base_with_info_2< int, K > Vb;
+typedef CGAL::Triangulation_data_structure_2< Vb > Tds;
+typedef CGAL::Delaunay_triangulation_2< K, Tds > Delaunay;
 
 SparseVectorField::SparseVectorField() : triangulationValid_(false) { }
 
@@ -60,14 +65,31 @@ int SparseVectorField::getNumVectors() const
   return startPoints_.size();
 }
 
-const list< int > &SparseVectorField::getTriIndices() const
+TriIndexView SparseVectorField::getTriIndices() const
 {
   if(triangulationValid_)
-    return triIndices_;
+    return TriIndexView(triIndices_);
   else
     throw logic_error("No valid triangulation");
 }
 
+bool SparseVectorField::isTriangulated() const
+{
+  return triangulationValid_;
+}
+
+void SparseVectorField::setVectors(const vector< Point > &startPoints,
+                                   const vector< Point > &endPoints)
+{
+  if(startPoints.size() != endPoints.size())
+    throw invalid_argument("The numbers of start and end points differ.");
+  
+  startPoints_ = startPoints;
+  endPoints_ = endPoints;
+  triIndices_.clear();
+  triangulationValid_ = false;
+}
+
 void SparseVectorField::setStartPoint(int i, int x, int y)
 {
   startPoints_[i] = Point(x, y);
@@ -81,34 +103,41 @@ void SparseVectorField::setEndPoint(int i, double x, double y)
 void SparseVectorField::triangulate()
 {
   Delaunay dt;
-  Delaunay::Finite_edges_iterator eIter;
   Delaunay::Finite_faces_iterator fIter;
-  vector< Point >::const_iterator fpIter;
-  int i;
-  map< Delaunay::Vertex_handle, int > V;
-  map< Point, int > Vi;
-  Delaunay::Finite_vertices_iterator vIter;
-  
-  dt.insert(startPoints_.begin(), startPoints_.end());
+  vector< pair< Point, int > > points(startPoints_.size());
   
-  // Map each vertex to its index.
-  for(int i = 0; i < startPoints_.size(); i++)
-    Vi[startPoints_[i]] = i;
+  for(size_t i = 0; i < startPoints_.size(); i++)
+    points[i] = make_pair(startPoints_[i], (int)i);
   
-  // Map vertices in the Delaunay triangulation to the original vertices.
-  for(vIter = dt.finite_vertices_begin(); vIter != dt.finite_vertices_end(); vIter++)
-    V[vIter] = Vi[Point(vIter->point().x(), vIter->point().y())];
+  // Inserting a range of points with info sorts the points spatially 
+  // before insertion.
+  dt.insert(points.begin(), points.end());
   
-  // Retrieve vertex indices from the vertex map.
+  triIndices_.clear();
+  triIndices_.reserve(3 * dt.number_of_faces());
   for(fIter = dt.finite_faces_begin(); fIter != dt.finite_faces_end(); fIter++)
   {
-    Delaunay::Face f = *fIter;
-    
-    triIndices_.push_back(V[f.vertex(0)]);
-    triIndices_.push_back(V[f.vertex(1)]);
-    triIndices_.push_back(V[f.vertex(2)]);
+    triIndices_.push_back(fIter->vertex(0)->info());
+    triIndices_.push_back(fIter->vertex(1)->info());
+    triIndices_.push_back(fIter->vertex(2)->info());
+  }
+  
+  triangulationValid_ = true;
+}
+
+void SparseVectorField::setTriangulation(const vector< int > &triIndices)
+{
+  const int N = startPoints_.size();
+  
+  if(triIndices.size() % 3 != 0)
+    throw invalid_argument("The number of triangle indices must be divisible by three.");
+  for(size_t i = 0; i < triIndices.size(); i++)
+  {
+    if(triIndices[i] < 0 || triIndices[i] >= N)
+      throw invalid_argument("Triangle index out of range.");
   }
   
+  triIndices_ = triIndices;
   triangulationValid_ = true;
 }
 
@@ -3,7 +3,7 @@
 #ifndef SPARSEVECTORFIELD_H
 
 #include <CGAL/Simple_cartesian.h>
-#include <list>
+#include <cstddef>
 #include <ostream>
 #include <vector>
 
@@ -11,6 +11,49 @@ typedef CGAL::Simple_cartesian< double >::Point_2 Point;
 
 using namespace std;
 
+/// A read-only view of a contiguous array of triangle vertex indices.
+/**
+ * The array contains three indices per triangle. The view does not own 
+ * the array, and it is invalidated when the array is modified.
+ */
+class TriIndexView
+{
+public:
+  /// Constructs an empty view.
+  TriIndexView() : data_(NULL), size_(0) { }
+  
+  /// Constructs a view of the given array.
+  TriIndexView(const int *data, size_t size) : data_(data), size_(size) { }
+  
+  /// Constructs a view of the given vector.
+  TriIndexView(const vector< int > &indices) : 
+    data_(indices.empty() ? NULL : &indices[0]), size_(indices.size()) { }
+  
+  /// Returns a pointer to the first index.
+  const int *begin() const { return data_; }
+  
+  /// Returns a pointer to the first index.
+  const int *data() const { return data_; }
+  
+  /// Returns true if the view contains no indices.
+  bool empty() const { return size_ == 0; }
+  
+  /// Returns a pointer past the last index.
+  const int *end() const { return data_ + size_; }
+  
+  /// Returns the number of triangles.
+  int getNumTriangles() const { return (int)(size_ / 3); }
+  
+  /// Returns the number of indices (three per triangle).
+  size_t size() const { return size_; }
+  
+  /// Returns the ith index.
+  int operator[](size_t i) const { return data_[i]; }
+private:
+  const int *data_;
+  size_t size_;
+};
+
 /// Defines a sparse vector field, i.e. a list of vectors.
 class SparseVectorField
 {
@@ -53,9 +96,23 @@ public:
   /// Returns the indices of the triangulation (if valid)
   /**
    * If this vector field has a valid triangulation, this method 
-   * returns its indices. Otherwise, an exception is thrown.
+   * returns a view of its indices (three per triangle). Otherwise, an 
+   * exception is thrown. The view is invalidated when the vector field 
+   * is modified.
+   */
+  TriIndexView getTriIndices() const;
+  
+  /// Returns true if this vector field has a valid triangulation.
+  bool isTriangulated() const;
+  
+  /// Sets the start and end points of all vectors.
+  /**
+   * This method replaces the vectors of this vector field with the given 
+   * ones. The arrays must have the same size. Setting the vectors breaks 
+   * an existing triangulation.
    */
-  const list< int > &getTriIndices() const;
+  void setVectors(const vector< Point > &startPoints,
+                  const vector< Point > &endPoints);
   
   /// Sets the start point of the ith vector.
   void setStartPoint(int i, int x, int y);
@@ -66,16 +123,28 @@ public:
   /// Triangulates the set of vector starting points.
   /**
    * This method triangulates the set of vector starting points 
-   * and stores the indices of each triangle vertex.
+   * and stores the indices of each triangle vertex. The vertices of the 
+   * triangulation carry the indices of the points, and the points are 
+   * inserted in spatially sorted order. Of duplicate points, only one is 
+   * used.
    */
   void triangulate();
   
+  /// Sets a precomputed triangulation of the vector starting points.
+  /**
+   * This method sets the triangulation without recomputing it, e.g. 
+   * when it has been read from a file. The array contains three vertex 
+   * indices per triangle. Throws invalid_argument if the size of the array 
+   * is not divisible by three or if some index is out of range.
+   */
+  void setTriangulation(const vector< int > &triIndices);
+  
   friend ostream &operator<<(ostream &os, const SparseVectorField &V);
 private:
   vector< Point > startPoints_;
   bool triangulationValid_;
   vector< Point > endPoints_;
-  list< int > triIndices_;
+  vector< int > triIndices_;
 };
 
 #define SPARSEVECTORFIELD_H
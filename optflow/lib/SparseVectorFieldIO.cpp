@@ -7,75 +7,134 @@
 
 #include <fstream>
 #include <iostream>
+#include <limits.h>
 #include <stdexcept>
-#include <stdlib.h>
+#include <stdio.h>
 #include <string.h>
-
-static const int TOKEN_SIZE = 100;
+#include <vector>
 
 void SparseVectorFieldIO::readVectorField(const string &inFileName,
                                           SparseVectorField &V)
 {
   int numVectors;
-  char token[TOKEN_SIZE];
-  float x, y;
-  float u, v;
+  int numTriangles = 0;
+  int version;
+  vector< char > header;
+  string token;
+  size_t pos;
   
   ifstream inputStream(inFileName.c_str(), ios::binary | ios::in);
   if(!inputStream)
     throw runtime_error("File not found.");
   
-  PNMFileUtils::checkMagicNumber(inputStream, "PSV");
+  PNMFileUtils::readHeaderBlock(inputStream, header);
+  PNMFileUtils::HeaderParser parser(header.empty() ? NULL : &header[0], header.size());
+  
+  token = parser.readToken();
+  if(token == "PSV")
+    version = 1;
+  else if(token == "PSV2")
+    version = 2;
+  else
+  {
+    cerr<<"Magic number "<<token<<" != PSV or PSV2"<<endl;
+    throw runtime_error("Bad magic number");
+  }
+  
+  // get the number of vectors and triangles
+  numVectors = parser.readInt(0, INT_MAX);
+  if(version == 2)
+    numTriangles = parser.readInt(0, INT_MAX);
+  pos = parser.endHeader();
+  
+  // Check the file size before allocating the arrays so that a corrupted 
+  // header cannot trigger a huge allocation.
+  const size_t VECTOR_DATA_SIZE = (size_t)numVectors * 4 * sizeof(float);
+  const size_t TRI_DATA_SIZE = (size_t)numTriangles * 3 * sizeof(int);
   
-  // get the number of vectors
-  PNMFileUtils::extractToken(inputStream, token, TOKEN_SIZE);
-  numVectors = atoi(token);
-  char ch;
-  inputStream.read(&ch, sizeof(char));
+  inputStream.seekg(0, ios::end);
+  const size_t FILE_SIZE = inputStream.tellg();
+  if(FILE_SIZE < pos || VECTOR_DATA_SIZE + TRI_DATA_SIZE > FILE_SIZE - pos)
+    throw runtime_error("Truncated PSVM file.");
+  inputStream.seekg(pos);
   
+  // Read all vectors (x, y, u, v) with a single call.
+  vector< float > vectorData(4 * (size_t)numVectors);
+  if(numVectors > 0)
+    inputStream.read((char *)&vectorData[0], VECTOR_DATA_SIZE);
+  
+  vector< Point > startPoints(numVectors);
+  vector< Point > endPoints(numVectors);
   for(int i = 0; i < numVectors; i++)
   {
-    inputStream.read((char *)&x, sizeof(float));
-    inputStream.read((char *)&y, sizeof(float));
-    inputStream.read((char *)&u, sizeof(float));
-    inputStream.read((char *)&v, sizeof(float));
+    const float *q = &vectorData[4 * (size_t)i];
     
-    V.addVector(Point(x, y), Point(x + u, y + v));
+    startPoints[i] = Point(q[0], q[1]);
+    endPoints[i] = Point(q[0] + q[2], q[1] + q[3]);
   }
   
+  V.setVectors(startPoints, endPoints);
+  
+  if(version == 2)
+  {
+    vector< int > triData(3 * (size_t)numTriangles);
+    if(numTriangles > 0)
+      inputStream.read((char *)&triData[0], TRI_DATA_SIZE);
+    
+    V.setTriangulation(triData);
+  }
+  
+  if(!inputStream)
+    throw runtime_error("Error reading PSVM file.");
+  
   inputStream.close();
 }
 
 void SparseVectorFieldIO::writeVectorField(const SparseVectorField &V,
-                                           const string &outFileName)
+                                           const string &outFileName,
+                                           bool writeTriangulation)
 {
-  float x, y;
-  float u, v;
-  Point p1;
-  Point p2;
+  const int N = V.getNumVectors();
+  const bool WITH_TRIANGULATION = writeTriangulation && V.isTriangulated();
   
   ofstream outputStream(outFileName.c_str(), ios::binary | ios::out);
   if(!outputStream)
     throw runtime_error("Error creating file");
   
   char header[100];
-  sprintf(header, "PSV\n%d\n", V.getNumVectors());
+  if(WITH_TRIANGULATION)
+    sprintf(header, "PSV2\n%d %d\n", N, V.getTriIndices().getNumTriangles());
+  else
+    sprintf(header, "PSV\n%d\n", N);
   outputStream.write(header, strlen(header));
   
-  for(int i = 0; i < V.getNumVectors(); i++)
+  // Write all vectors (x, y, u, v) with a single call.
+  vector< float > vectorData(4 * (size_t)N);
+  const vector< Point > &startPoints = V.getStartPoints();
+  const vector< Point > &endPoints = V.getEndPoints();
+  for(int i = 0; i < N; i++)
+  {
+    float *q = &vectorData[4 * (size_t)i];
+    
+    q[0] = startPoints[i].x();
+    q[1] = startPoints[i].y();
+    q[2] = endPoints[i].x() - startPoints[i].x();
+    q[3] = endPoints[i].y() - startPoints[i].y();
+  }
+  if(N > 0)
+    outputStream.write((const char *)&vectorData[0], vectorData.size() * sizeof(float));
+  
+  if(WITH_TRIANGULATION)
   {
-    p1 = V.getStartPoint(i);
-    x = p1.x();
-    y = p1.y();
-    outputStream.write((const char *)&x, sizeof(float));
-    outputStream.write((const char *)&y, sizeof(float));
-    p2 = V.getEndPoint(i);
-    u = p2.x() - p1.x();
-    v = p2.y() - p1.y();
-    outputStream.write((const char *)&u, sizeof(float));
-    outputStream.write((const char *)&v, sizeof(float));
+    const TriIndexView triIndices = V.getTriIndices();
+    
+    if(!triIndices.empty())
+      outputStream.write((const char *)triIndices.data(), triIndices.size() * sizeof(int));
   }
   
+  if(!outputStream)
+    throw runtime_error("Error writing PSVM file.");
+  
   outputStream.close();
 }
 
@@ -12,27 +12,48 @@ class SparseVectorField;
 /**
  * This class implements methods for reading and writing sparse 
  * motion vector fields in PSVM format (an extension of the PGM format).
+ * Two versions of the format are supported.
  *
- * A PSVM header is of the form:
+ * A version 1 PSVM header is of the form:
  * PSV
  * [numvectors]
  *
  * The data consists of sequentially 
  * ordered quartets. The first two elements of nth 
  * quartet specify the starting point of the nth 
- * vector and the last two elements specify the end 
- * point of the nth vector.
+ * vector and the last two elements specify the 
+ * components of the nth vector.
+ *
+ * A version 2 PSVM header is of the form:
+ * PSV2 
+ * [numvectors] [numtriangles]
+ *
+ * The quartets (32-bit floats) are followed by a triangulation of the 
+ * vector starting points: three vertex indices (32-bit integers) per 
+ * triangle. Storing the triangulation allows reading the vector field 
+ * without triangulating it again. All binary values are in native byte 
+ * order, and the arrays are read and written with single calls.
  */
 class SparseVectorFieldIO
 {
 public:
   /// Reads a vector field from a file in PSVM format.
+  /**
+   * The vectors of V are replaced with the ones read from the file. If the 
+   * file contains a triangulation, it is set to V.
+   */
   static void readVectorField(const string &inFileName,
                               SparseVectorField &V);
   
   /// Writes a vector field to a file in PSVM format.
+  /**
+   * If writeTriangulation is true and V has a valid triangulation, the 
+   * field is written in version 2 format including the triangulation. 
+   * Otherwise it is written in version 1 format.
+   */
   static void writeVectorField(const SparseVectorField &V,
-                               const string &outFileName);
+                               const string &outFileName,
+                               bool writeTriangulation = false);
 };
 
 #define SPARSEVECTORFIELDIO_H
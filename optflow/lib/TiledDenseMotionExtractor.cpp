@@ -0,0 +1,228 @@
+
+#include "TiledDenseMotionExtractor.h"
+
+#include "CImg_config.h"
+#include <CImg.h>
+#include "PyramidalDenseMotionExtractor.h"
+
+#include <algorithm>
+#include <iostream>
+#ifdef WITH_OPENMP
+#include <omp.h>
+#endif
+#include <stdexcept>
+
+// Rounds the given size up to a multiple of the coarsest pyramid level 
+// spacing if the motion extractor is pyramidal.
+static int alignToPyramid_(const vector< DenseMotionExtractor * > &extractors, int size)
+{
+  if(extractors.empty())
+    throw invalid_argument("At least one motion extractor must be given.");
+  
+  PyramidalDenseMotionExtractor *pe = 
+    dynamic_cast< PyramidalDenseMotionExtractor * >(extractors[0]);
+  if(pe == NULL)
+    return size;
+  
+  const int A = 1 << (pe->getNumLevels() - 1);
+  return (size + A - 1) / A * A;
+}
+
+TiledDenseMotionExtractor::TiledDenseMotionExtractor(
+  const vector< DenseMotionExtractor * > &extractors,
+  int tileSize,
+  int haloSize) : extractors_(extractors),
+                  TILE_SIZE_(alignToPyramid_(extractors, tileSize)),
+                  HALO_SIZE_(alignToPyramid_(extractors, haloSize))
+{
+  if(tileSize < 1 || haloSize < 0)
+    throw invalid_argument("Invalid tile or halo size.");
+  
+  // The tiles are computed concurrently, so the extractors must not print 
+  // their information text and progress for each tile.
+  for(unsigned int i = 0; i < extractors_.size(); i++)
+    extractors_[i]->setVerbose(false);
+}
+
+TiledDenseMotionExtractor::~TiledDenseMotionExtractor()
+{
+  for(unsigned int i = 0; i < extractors_.size(); i++)
+    delete extractors_[i];
+}
+
+void TiledDenseMotionExtractor::compute(const CImg< unsigned char > &I1,
+                                        const CImg< unsigned char > &I2,
+                                        CImg< double > &V)
+{
+  computeTiles_(I1, I2, NULL, V, NULL);
+}
+
+void TiledDenseMotionExtractor::compute(const CImg< unsigned char > &I1,
+                                        const CImg< unsigned char > &I2,
+                                        CImg< double > &VF,
+                                        CImg< double > &VB)
+{
+  computeTiles_(I1, I2, NULL, VF, isDual() ? &VB : NULL);
+}
+
+void TiledDenseMotionExtractor::compute(const CImg< unsigned char > &I1,
+                                        const CImg< unsigned char > &I2,
+                                        const CImg< unsigned char > &mask,
+                                        CImg< double > &V)
+{
+  computeTiles_(I1, I2, &mask, V, NULL);
+}
+
+void TiledDenseMotionExtractor::compute(const CImg< unsigned char > &I1,
+                                        const CImg< unsigned char > &I2,
+                                        const CImg< unsigned char > &mask,
+                                        CImg< double > &VF,
+                                        CImg< double > &VB)
+{
+  computeTiles_(I1, I2, &mask, VF, isDual() ? &VB : NULL);
+}
+
+int TiledDenseMotionExtractor::getNumResultQualityChannels() const
+{
+  return extractors_[0]->getNumResultQualityChannels();
+}
+
+bool TiledDenseMotionExtractor::isDual() const
+{
+  return extractors_[0]->isDual();
+}
+
+void TiledDenseMotionExtractor::printInfoText() const
+{
+  cout<<"Tiled motion extraction: tile size "<<TILE_SIZE_<<", halo size "<<HALO_SIZE_
+      <<", "<<extractors_.size()<<" concurrent tiles"<<endl;
+}
+
+double TiledDenseMotionExtractor::computeBlendWeight_(int i, int e0, int e1, int n) const
+{
+  double w = 1.0;
+  
+  // The weight decreases linearly to zero across the overlap (2*halo) of 
+  // the neighbouring tiles, so that the weights of overlapping tiles sum to 
+  // one. Image boundaries do not reduce the weight.
+  if(HALO_SIZE_ > 0)
+  {
+    if(e0 > 0)
+      w = min(w, (i - e0 + 0.5) / (2.0 * HALO_SIZE_));
+    if(e1 < n)
+      w = min(w, (e1 - i - 0.5) / (2.0 * HALO_SIZE_));
+  }
+  
+  return w;
+}
+
+void TiledDenseMotionExtractor::computeTiles_(const CImg< unsigned char > &I1,
+                                              const CImg< unsigned char > &I2,
+                                              const CImg< unsigned char > *mask,
+                                              CImg< double > &VF,
+                                              CImg< double > *VB)
+{
+  const int W = I1.width();
+  const int H = I1.height();
+  const int C = getNumResultChannels();
+  const int NTX = (W + TILE_SIZE_ - 1) / TILE_SIZE_;
+  const int NTY = (H + TILE_SIZE_ - 1) / TILE_SIZE_;
+  
+  if(I1.width() != I2.width() || I1.height() != I2.height())
+    throw invalid_argument("The dimensions of the input images must match.");
+  if(mask != NULL && (mask->width() != W || mask->height() != H))
+    throw invalid_argument("The dimensions of the mask and the input images must match.");
+  
+  printInfoText();
+  
+  CImg< double > sumWeights(W, H, 1, 1, 0.0);
+  VF.assign(W, H, 1, C, 0.0);
+  if(VB != NULL)
+    VB->assign(W, H, 1, C, 0.0);
+
+#ifdef WITH_OPENMP
+  const int NUMTHREADS = extractors_.size();
+
+#pragma omp parallel for schedule(dynamic) num_threads(NUMTHREADS)
+#endif
+  for(int t = 0; t < NTX * NTY; t++)
+  {
+#ifdef WITH_OPENMP
+    DenseMotionExtractor *e = extractors_[omp_get_thread_num()];
+#else
+    DenseMotionExtractor *e = extractors_[0];
+#endif
+    
+    // the tile extended by the halo, clipped to the image
+    const int x0 = max((t % NTX) * TILE_SIZE_ - HALO_SIZE_, 0);
+    const int y0 = max((t / NTX) * TILE_SIZE_ - HALO_SIZE_, 0);
+    const int x1 = min((t % NTX + 1) * TILE_SIZE_ + HALO_SIZE_, W);
+    const int y1 = min((t / NTX + 1) * TILE_SIZE_ + HALO_SIZE_, H);
+    
+    CImg< unsigned char > I1t = I1.get_crop(x0, y0, x1 - 1, y1 - 1);
+    CImg< unsigned char > I2t = I2.get_crop(x0, y0, x1 - 1, y1 - 1);
+    // Single-level extractors use the given fields as the initial guess, 
+    // so the fields are initialized to zero. Inactive tiles are left zero.
+    CImg< double > VFt(x1 - x0, y1 - y0, 1, C, 0.0), VBt;
+    if(VB != NULL)
+      VBt.assign(x1 - x0, y1 - y0, 1, C, 0.0);
+    
+    if(mask != NULL)
+    {
+      CImg< unsigned char > maskt = mask->get_crop(x0, y0, x1 - 1, y1 - 1);
+      
+      bool active = false;
+      for(unsigned int i = 0; i < maskt.size() && !active; i++)
+        active = maskt[i] != 0;
+      
+      // The backward field is requested only from dual extractors, since 
+      // the dual overloads of the other extractors may throw.
+      if(active && VB != NULL)
+        e->compute(I1t, I2t, maskt, VFt, VBt);
+      else if(active)
+        e->compute(I1t, I2t, maskt, VFt);
+    }
+    else if(VB != NULL)
+      e->compute(I1t, I2t, VFt, VBt);
+    else
+      e->compute(I1t, I2t, VFt);
+    
+    CImg< double > weights(x1 - x0, y1 - y0);
+    for(int y = y0; y < y1; y++)
+      for(int x = x0; x < x1; x++)
+        weights(x - x0, y - y0) = computeBlendWeight_(x, x0, x1, W) * 
+                                  computeBlendWeight_(y, y0, y1, H);
+
+#pragma omp critical
+    {
+      for(int y = y0; y < y1; y++)
+      {
+        for(int x = x0; x < x1; x++)
+        {
+          const double w = weights(x - x0, y - y0);
+          
+          sumWeights(x, y) += w;
+          for(int c = 0; c < C; c++)
+          {
+            VF(x, y, 0, c) += w * VFt(x - x0, y - y0, 0, c);
+            if(VB != NULL)
+              (*VB)(x, y, 0, c) += w * VBt(x - x0, y - y0, 0, c);
+          }
+        }
+      }
+    }
+  }
+  
+  for(int y = 0; y < H; y++)
+  {
+    for(int x = 0; x < W; x++)
+    {
+      for(int c = 0; c < C; c++)
+      {
+        VF(x, y, 0, c) /= sumWeights(x, y);
+        if(VB != NULL)
+          (*VB)(x, y, 0, c) /= sumWeights(x, y);
+      }
+    }
+  }
+}
@@ -0,0 +1,98 @@
+
+#ifndef TILEDDENSEMOTIONEXTRACTOR_H
+
+#include "DenseMotionExtractor.h"
+
+#include <vector>
+
+namespace cimg_library { template < class T > class CImg; }
+
+using namespace cimg_library;
+using namespace std;
+
+/// Implements tiled motion extraction for large images.
+/**
+ * This class splits the input images into tiles that are extended by a halo 
+ * (overlap region) and runs a dense motion extractor on each tile. The tiles 
+ * are processed concurrently, one tile per motion extractor. The resulting 
+ * motion fields are stitched by using weights that decrease linearly to zero 
+ * across the overlap of the neighbouring tiles.
+ *
+ * The number of motion extractors bounds the number of concurrent tasks, and 
+ * the memory used by each task depends only on the tile and halo sizes.
+ *
+ * If a mask is given, the tiles that contain no active pixels are skipped 
+ * and their motion vectors are set to zero.
+ *
+ * For pyramidal motion extractors, the tile and halo sizes are rounded up to 
+ * multiples of 2^(n-1), where n is the number of pyramid levels. This 
+ * aligns the pyramid levels of each tile with those of the whole image. The 
+ * halo should be larger than the maximum displacement in the images.
+ *
+ * The information text is printed once per computation by this class. The 
+ * output of the given motion extractors is disabled (see 
+ * DenseMotionExtractor::setVerbose).
+ */
+class TiledDenseMotionExtractor : public DenseMotionExtractor
+{
+public:
+  /// Constructs a tiled motion extractor.
+  /**
+   * @param extractors motion extractors with the same type and parameters, 
+   * one for each concurrently processed tile, they are deleted when this 
+   * object is destroyed
+   * @param tileSize width and height of the tiles excluding the halo
+   * @param haloSize width of the halo added to each side of a tile
+   */
+  TiledDenseMotionExtractor(const vector< DenseMotionExtractor * > &extractors,
+                            int tileSize,
+                            int haloSize);
+  
+  ~TiledDenseMotionExtractor();
+  
+  void compute(const CImg< unsigned char > &I1,
+               const CImg< unsigned char > &I2,
+               CImg< double > &V);
+  
+  void compute(const CImg< unsigned char > &I1,
+               const CImg< unsigned char > &I2,
+               CImg< double > &VF,
+               CImg< double > &VB);
+  
+  void compute(const CImg< unsigned char > &I1,
+               const CImg< unsigned char > &I2,
+               const CImg< unsigned char > &mask,
+               CImg< double > &V);
+  
+  void compute(const CImg< unsigned char > &I1,
+               const CImg< unsigned char > &I2,
+               const CImg< unsigned char > &mask,
+               CImg< double > &VF,
+               CImg< double > &VB);
+  
+  int getHaloSize() const { return HALO_SIZE_; }
+  
+  int getNumResultQualityChannels() const;
+  
+  int getTileSize() const { return TILE_SIZE_; }
+  
+  bool isDual() const;
+  
+  void printInfoText() const;
+private:
+  vector< DenseMotionExtractor * > extractors_;
+  const int TILE_SIZE_;
+  const int HALO_SIZE_;
+  
+  double computeBlendWeight_(int i, int e0, int e1, int n) const;
+  
+  void computeTiles_(const CImg< unsigned char > &I1,
+                     const CImg< unsigned char > &I2,
+                     const CImg< unsigned char > *mask,
+                     CImg< double > &VF,
+                     CImg< double > *VB);
+};
+
+#define TILEDDENSEMOTIONEXTRACTOR_H
+
+#endif
@@ -54,16 +54,15 @@ void VectorFieldIllustrator::renderSparseVectorField(const SparseVectorField &V,
   color[1] = 60;
   color[2] = 60;
   
-  for(list< int >::const_iterator iIter = V.getTriIndices().begin(); iIter != V.getTriIndices().end(); iIter++)
+  const TriIndexView triIndices = V.getTriIndices();
+  for(const int *iIter = triIndices.begin(); iIter != triIndices.end(); iIter += 3)
   {
-    int x1 = V.getStartPoint(*iIter).x();
-    int y1 = V.getStartPoint(*iIter).y();
-    iIter++;
-    int x2 = V.getStartPoint(*iIter).x();
-    int y2 = V.getStartPoint(*iIter).y();
-    iIter++;
-    int x3 = V.getStartPoint(*iIter).x();
-    int y3 = V.getStartPoint(*iIter).y();
+    int x1 = V.getStartPoint(iIter[0]).x();
+    int y1 = V.getStartPoint(iIter[0]).y();
+    int x2 = V.getStartPoint(iIter[1]).x();
+    int y2 = V.getStartPoint(iIter[1]).y();
+    int x3 = V.getStartPoint(iIter[2]).x();
+    int y3 = V.getStartPoint(iIter[2]).y();
     
     I.draw_line(x1, y1, x2, y2, color);
     I.draw_line(x2, y2, x3, y3, color);
@@ -0,0 +1,240 @@
+
+#include "PXMFileUtils.h"
+#include "WarpPlan.h"
+#include "WarpSampling.h"
+
+#include "CImg_config.h"
+#include <CImg.h>
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The largest supported width and height (the offsets must fit in 16 bits).
+static const int MAX_SIZE = 32768;
+
+// Interpolates between the four neighbours of p with weights in [0,255]. 
+// The integer images are interpolated in fixed point. The intermediate 
+// values fit in 32 bits also for 16-bit images.
+template < class T >
+static inline T interpolate_(const T *p, int stepX, int stepY,
+                             unsigned int wx, unsigned int wy)
+{
+  const unsigned int F0 = p[0] * (255 - wx) + p[stepX] * wx;
+  const unsigned int F1 = p[stepY] * (255 - wx) + p[stepY + stepX] * wx;
+  
+  return (T)((F0 * (255 - wy) + F1 * wy + 32512) / 65025);
+}
+
+template <>
+inline float interpolate_< float >(const float *p, int stepX, int stepY,
+                                   unsigned int wx, unsigned int wy)
+{
+  return WarpSampling::interpolateBilinear(p, stepX, stepY, wx * (1.0f / 255.0f),
+                                           wy * (1.0f / 255.0f));
+}
+
+WarpPlan::WarpPlan() : width_(0), height_(0), multiplier_(0.0) { }
+
+WarpPlan::WarpPlan(const CImg< double > &V, double multiplier) : 
+  width_(0), height_(0), multiplier_(0.0)
+{
+  assign(V, multiplier);
+}
+
+void WarpPlan::assign(const CImg< double > &V, double multiplier)
+{
+  const int W = V.width();
+  const int H = V.height();
+  if(V.spectrum() < 2)
+    throw invalid_argument("The motion field must have two channels.");
+  if(W > MAX_SIZE || H > MAX_SIZE)
+    throw invalid_argument("The motion field is too large for a warp plan.");
+  
+  width_  = W;
+  height_ = H;
+  multiplier_ = multiplier;
+  dx_.resize((size_t)W * H);
+  dy_.resize((size_t)W * H);
+  wx_.resize((size_t)W * H);
+  wy_.resize((size_t)W * H);
+
+#pragma omp parallel for schedule(static)
+  for(int y = 0; y < H; y++)
+  {
+    const double *u = V.data(0, y, 0, 0);
+    const double *v = V.data(0, y, 0, 1);
+    const size_t ROW = (size_t)y * W;
+    
+    for(int x = 0; x < W; x++)
+    {
+      const double XS = x + multiplier * u[x];
+      const double YS = y + multiplier * v[x];
+      const double XC = WarpSampling::clampCoordinate(XS, W);
+      const double YC = WarpSampling::clampCoordinate(YS, H);
+      const int X0 = WarpSampling::bilinearIndex(XC, W);
+      const int Y0 = WarpSampling::bilinearIndex(YC, H);
+      
+      dx_[ROW + x] = (short)(X0 - x);
+      dy_[ROW + x] = (short)(Y0 - y);
+      wx_[ROW + x] = (unsigned char)((XC - X0) * 255.0 + 0.5);
+      wy_[ROW + x] = (unsigned char)((YC - Y0) * 255.0 + 0.5);
+    }
+  }
+}
+
+void WarpPlan::apply(const CImg< unsigned char > &I, CImg< unsigned char > &Ie) const
+{
+  apply_(I, Ie);
+}
+
+void WarpPlan::apply(const CImg< unsigned short > &I, CImg< unsigned short > &Ie) const
+{
+  apply_(I, Ie);
+}
+
+void WarpPlan::apply(const CImg< float > &I, CImg< float > &Ie) const
+{
+  apply_(I, Ie);
+}
+
+void WarpPlan::read(const string &fileName)
+{
+  vector< char > header;
+  string token;
+  char *end;
+  
+  ifstream inputStream(fileName.c_str(), ios::binary | ios::in);
+  if(!inputStream)
+    throw runtime_error("File not found.");
+  
+  PNMFileUtils::readHeaderBlock(inputStream, header);
+  PNMFileUtils::HeaderParser parser(header.empty() ? NULL : &header[0], header.size());
+  
+  parser.checkMagicNumber("PWP");
+  const int W = parser.readInt(0, MAX_SIZE);
+  const int H = parser.readInt(0, MAX_SIZE);
+  token = parser.readToken();
+  const double MULTIPLIER = strtod(token.c_str(), &end);
+  if(token.empty() || *end != '\0')
+    throw runtime_error("Invalid multiplier in PWP file.");
+  const size_t POS = parser.endHeader();
+  
+  // Check the file size before allocating the arrays so that a corrupted 
+  // header cannot trigger a huge allocation.
+  const size_t N = (size_t)W * H;
+  const size_t DATA_SIZE = N * (2 * sizeof(short) + 2 * sizeof(unsigned char));
+  
+  inputStream.seekg(0, ios::end);
+  const size_t FILE_SIZE = inputStream.tellg();
+  if(FILE_SIZE < POS || DATA_SIZE > FILE_SIZE - POS)
+    throw runtime_error("Truncated PWP file.");
+  inputStream.seekg(POS);
+  
+  width_  = W;
+  height_ = H;
+  multiplier_ = MULTIPLIER;
+  dx_.resize(N);
+  dy_.resize(N);
+  wx_.resize(N);
+  wy_.resize(N);
+  
+  if(N > 0)
+  {
+    inputStream.read((char *)&dx_[0], N * sizeof(short));
+    inputStream.read((char *)&dy_[0], N * sizeof(short));
+    inputStream.read((char *)&wx_[0], N);
+    inputStream.read((char *)&wy_[0], N);
+  }
+  
+  if(!inputStream)
+    throw runtime_error("Error reading PWP file.");
+  
+  // Reject offsets pointing outside the image so that a corrupted file 
+  // cannot cause out-of-bounds reads in apply().
+  for(int y = 0; y < H; y++)
+  {
+    for(int x = 0; x < W; x++)
+    {
+      const size_t OFFSET = (size_t)y * W + x;
+      const int X0 = x + dx_[OFFSET];
+      const int Y0 = y + dy_[OFFSET];
+      
+      if(X0 < 0 || X0 > max(W - 2, 0) || Y0 < 0 || Y0 > max(H - 2, 0))
+      {
+        width_ = height_ = 0;
+        dx_.clear();
+        dy_.clear();
+        wx_.clear();
+        wy_.clear();
+        throw runtime_error("Corrupted PWP file.");
+      }
+    }
+  }
+}
+
+void WarpPlan::write(const string &fileName) const
+{
+  const size_t N = (size_t)width_ * height_;
+  
+  ofstream outputStream(fileName.c_str(), ios::binary | ios::out);
+  if(!outputStream)
+    throw runtime_error("Error creating file");
+  
+  char header[100];
+  sprintf(header, "PWP\n%d %d\n%.17g\n", width_, height_, multiplier_);
+  outputStream.write(header, strlen(header));
+  
+  if(N > 0)
+  {
+    outputStream.write((const char *)&dx_[0], N * sizeof(short));
+    outputStream.write((const char *)&dy_[0], N * sizeof(short));
+    outputStream.write((const char *)&wx_[0], N);
+    outputStream.write((const char *)&wy_[0], N);
+  }
+  
+  outputStream.close();
+  if(!outputStream)
+    throw runtime_error("Error writing file");
+}
+
+template < class T >
+void WarpPlan::apply_(const CImg< T > &I, CImg< T > &Ie) const
+{
+  const int W = width_;
+  const int H = height_;
+  const int C = I.spectrum();
+  // The neighbours coincide in images having only one column or row.
+  const int STEP_X = W > 1 ? 1 : 0;
+  const int STEP_Y = H > 1 ? W : 0;
+  
+  if(I.width() != W || I.height() != H || I.depth() != 1)
+    throw invalid_argument("The image and the warp plan must have the same dimensions.");
+  
+  Ie.assign(W, H, 1, C);
+
+#pragma omp parallel for schedule(static)
+  for(int y = 0; y < H; y++)
+  {
+    const size_t ROW = (size_t)y * W;
+    const short *dx = &dx_[ROW];
+    const short *dy = &dy_[ROW];
+    const unsigned char *wx = &wx_[ROW];
+    const unsigned char *wy = &wy_[ROW];
+    
+    for(int c = 0; c < C; c++)
+    {
+      // the offsets are relative to the destination pixel
+      const T *src = I.data(0, y, 0, c);
+      T *dest = Ie.data(0, y, 0, c);
+      
+      for(int x = 0; x < W; x++)
+      {
+        const T *p = src + x + dx[x] + (ptrdiff_t)dy[x] * W;
+        dest[x] = interpolate_(p, STEP_X, STEP_Y, wx[x], wy[x]);
+      }
+    }
+  }
+}
@@ -0,0 +1,102 @@
+
+#ifndef WARPPLAN_H
+
+#include <string>
+#include <vector>
+
+namespace cimg_library { template < class T > class CImg; }
+
+using namespace cimg_library;
+using namespace std;
+
+/// A compact precomputed inverse warp that can be stored on disk.
+/**
+ * Like ImageWarp, the plan maps each destination pixel x to the source 
+ * location x+multiplier*V(x) clamped to the image, and it can be applied 
+ * to any number of images of the same size. The plan is more compact: each 
+ * pixel is stored as the integer offset of the upper-left source pixel 
+ * from the destination pixel (2 x 16 bits) and the fractional bilinear 
+ * weights (2 x 8 bits, 255 corresponding to one), i.e. six bytes per pixel. 
+ * The integer images are warped by a fixed-point kernel. Thus, once the 
+ * plan has been computed, warping an image is mainly a gather from the 
+ * source image.
+ *
+ * The plan is stored in a PWP file. Its header is of the form:
+ * PWP
+ * [width] [height]
+ * [multiplier]
+ *
+ * The header is followed by a single whitespace character and the 
+ * horizontal and vertical offsets (16-bit signed integers) and the 
+ * horizontal and vertical weights (8-bit unsigned integers), each array in 
+ * row-major order. The binary values are in native byte order.
+ */
+class WarpPlan
+{
+public:
+  /// Constructs an empty plan.
+  WarpPlan();
+  
+  /// Constructs a plan from the given motion field.
+  /**
+   * @param V inverse motion field
+   * @param multiplier multiplier for the motion vectors
+   */
+  WarpPlan(const CImg< double > &V, double multiplier);
+  
+  /// Computes the plan from the given motion field.
+  /**
+   * Throws invalid_argument if the width or height of V exceeds 32768.
+   * @param V inverse motion field
+   * @param multiplier multiplier for the motion vectors
+   */
+  void assign(const CImg< double > &V, double multiplier);
+  
+  /// Applies the plan to all channels of the given image.
+  /**
+   * Throws invalid_argument if the dimensions of I and the plan do not 
+   * match. Integer images are rounded to the nearest value.
+   * @param[in] I the image to warp
+   * @param[out] Ie the warped image
+   */
+  void apply(const CImg< unsigned char > &I, CImg< unsigned char > &Ie) const;
+  
+  /// Applies the plan to all channels of the given 16-bit image.
+  void apply(const CImg< unsigned short > &I, CImg< unsigned short > &Ie) const;
+  
+  /// Applies the plan to all channels of the given floating-point image.
+  void apply(const CImg< float > &I, CImg< float > &Ie) const;
+  
+  /// Returns the height of the plan.
+  int getHeight() const { return height_; }
+  
+  /// Returns the multiplier the plan was computed with.
+  double getMultiplier() const { return multiplier_; }
+  
+  /// Returns the width of the plan.
+  int getWidth() const { return width_; }
+  
+  /// Reads a plan from a PWP file.
+  /**
+   * Throws runtime_error if the file cannot be read or is corrupted.
+   */
+  void read(const string &fileName);
+  
+  /// Writes the plan into a PWP file.
+  /**
+   * Throws runtime_error if the file cannot be written.
+   */
+  void write(const string &fileName) const;
+private:
+  int width_, height_;
+  double multiplier_;
+  vector< short > dx_, dy_;
+  vector< unsigned char > wx_, wy_;
+  
+  template < class T >
+  void apply_(const CImg< T > &I, CImg< T > &Ie) const;
+};
+
+#define WARPPLAN_H
+
+#endif
@@ -0,0 +1,125 @@
+
+#ifndef WARPSAMPLING_H
+
+#include "ImageWarp.h"
+
+#include <algorithm>
+#include <limits>
+
+using namespace std;
+
+/// Implements the sampling operations shared by the image warping classes.
+/**
+ * ImageWarp, WarpPlan, DenseImageMorpher and the dense image extrapolators 
+ * use these for clamping the source coordinates, bilinear interpolation and 
+ * converting the interpolated values to pixels, so that the image boundaries 
+ * and NaN coordinates are treated identically. This header is internal to 
+ * the library and it is not installed.
+ */
+class WarpSampling
+{
+public:
+  /// Clamps a source coordinate to [0,size-1].
+  /**
+   * NaN coordinates fail the comparisons and are mapped to zero.
+   */
+  static double clampCoordinate(double c, int size)
+  {
+    return c >= 0.0 ? min(c, size - 1.0) : 0.0;
+  }
+  
+  /// Returns the first pixel of the bilinear neighbourhood of a clamped coordinate.
+  /**
+   * The pixel is chosen so that its right and lower neighbours are always 
+   * within the image, and the weight is one at the right and lower edges.
+   */
+  static int bilinearIndex(double c, int size)
+  {
+    return min((int)c, max(size - 2, 0));
+  }
+  
+  /// Returns true if (x, y) is within the image. NaN coordinates are not.
+  static bool isInside(double x, double y, int W, int H)
+  {
+    return x >= 0.0 && x <= W - 1.0 && y >= 0.0 && y <= H - 1.0;
+  }
+  
+  /// Interpolates between p and its right and lower neighbours.
+  /**
+   * @param stepX the offset of the right neighbour (zero in images having 
+   * only one column)
+   * @param stepY the offset of the lower neighbour (zero in images having 
+   * only one row)
+   * @param wx the weight of the right neighbours
+   * @param wy the weight of the lower neighbours
+   */
+  template < class T >
+  static float interpolateBilinear(const T *p, int stepX, int stepY, float wx, float wy)
+  {
+    const float F0 = p[0] + wx * ((float)p[stepX] - p[0]);
+    const float F1 = p[stepY] + wx * ((float)p[stepY + stepX] - p[stepY]);
+    
+    return F0 + wy * (F1 - F0);
+  }
+  
+  /// Bilinear interpolation of the image src at (x, y) clamped to the image.
+  template < class T >
+  static float sampleBilinear(const T *src, int W, int H, int stepX, int stepY,
+                              double x, double y)
+  {
+    const double XC = clampCoordinate(x, W);
+    const double YC = clampCoordinate(y, H);
+    const int X0 = bilinearIndex(XC, W);
+    const int Y0 = bilinearIndex(YC, H);
+    
+    return interpolateBilinear(src + (size_t)Y0 * W + X0, stepX, stepY,
+                               (float)(XC - X0), (float)(YC - Y0));
+  }
+  
+  /// Converts an interpolated value to the pixel type.
+  /**
+   * Integer images are rounded and clamped to the range of the pixel type. 
+   * Clamping is needed because the four-tap kernels can overshoot.
+   */
+  template < class T >
+  static T toPixel(float v)
+  {
+    return (T)min(max(v + 0.5f, 0.0f), (float)numeric_limits< T >::max());
+  }
+  
+  /// Converts an interpolated value computed in double precision to the pixel type.
+  template < class T >
+  static T toPixel(double v)
+  {
+    return (T)min(max(v + 0.5, 0.0), (double)numeric_limits< T >::max());
+  }
+  
+  /// Returns the value of the out-of-domain pixels.
+  /**
+   * quiet_NaN is zero for integer types.
+   */
+  template < class T >
+  static T getFillValue(ImageWarp::OutOfDomain outOfDomain, float fillValue)
+  {
+    if(outOfDomain == ImageWarp::FILL_NAN)
+      return numeric_limits< T >::quiet_NaN();
+    else
+      return toPixel< T >(fillValue);
+  }
+};
+
+template <>
+inline float WarpSampling::toPixel< float >(float v)
+{
+  return v;
+}
+
+template <>
+inline float WarpSampling::toPixel< float >(double v)
+{
+  return (float)v;
+}
+
+#define WARPSAMPLING_H
+
+#endif
@@ -0,0 +1,52 @@
+
+#include "Workspace.h"
+
+#include "CImg_config.h"
+#include <CImg.h>
+
+template < class T >
+static void getImage_(vector< CImg< T > * > &buffers,
+                      int key, int w, int h, int c,
+                      CImg< T > &I)
+{
+  const unsigned long size = (unsigned long)w * h * c;
+  
+  if(key >= (int)buffers.size())
+    buffers.resize(key + 1, NULL);
+  if(buffers[key] == NULL)
+    buffers[key] = new CImg< T >();
+  
+  CImg< T > &buffer = *buffers[key];
+  if(buffer.size() < size)
+    buffer.assign(size);
+  
+  I.assign(buffer.data(), w, h, 1, c, true);
+}
+
+Workspace::Workspace() { }
+
+Workspace::~Workspace()
+{
+  clear();
+}
+
+void Workspace::getImage(int key, int w, int h, int c, CImg< double > &I)
+{
+  getImage_(doubleBuffers_, key, w, h, c, I);
+}
+
+void Workspace::getImage(int key, int w, int h, int c, CImg< float > &I)
+{
+  getImage_(floatBuffers_, key, w, h, c, I);
+}
+
+void Workspace::clear()
+{
+  for(unsigned int i = 0; i < doubleBuffers_.size(); i++)
+    delete doubleBuffers_[i];
+  for(unsigned int i = 0; i < floatBuffers_.size(); i++)
+    delete floatBuffers_[i];
+  
+  doubleBuffers_.clear();
+  floatBuffers_.clear();
+}
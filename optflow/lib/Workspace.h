@@ -0,0 +1,57 @@
+
+#ifndef WORKSPACE_H
+
+#include <vector>
+
+namespace cimg_library { template < class T > class CImg; }
+
+using namespace cimg_library;
+using namespace std;
+
+/// Implements a set of reusable image buffers.
+/**
+ * A workspace owns a set of buffers identified by integer keys. The images 
+ * obtained from a workspace share their memory with these buffers. A buffer 
+ * is reallocated only when the requested image does not fit in it, so 
+ * repeated requests for images of equal or smaller size (e.g. for each 
+ * pyramid level and for each call of a motion extractor) do not allocate 
+ * memory. An image obtained from a workspace is valid until the same key 
+ * is requested again or the workspace is destroyed.
+ */
+class Workspace
+{
+public:
+  /// Constructs an empty workspace.
+  Workspace();
+  
+  ~Workspace();
+  
+  /// Assigns I as a w x h x c image that shares memory with the given buffer.
+  /**
+   * The contents of the image are undefined.
+   * @param[in] key identifier of the buffer
+   * @param[in] w width of the image
+   * @param[in] h height of the image
+   * @param[in] c number of channels of the image
+   * @param[out] I the resulting shared image
+   */
+  void getImage(int key, int w, int h, int c, CImg< double > &I);
+  
+  /// Assigns I as a w x h x c image that shares memory with the given buffer.
+  void getImage(int key, int w, int h, int c, CImg< float > &I);
+  
+  /// Releases the memory of all buffers.
+  void clear();
+private:
+  vector< CImg< double > * > doubleBuffers_;
+  vector< CImg< float > * > floatBuffers_;
+  
+  // Copying would leave shared images pointing to the buffers of the 
+  // original workspace, so it is disabled.
+  Workspace(const Workspace &);
+  Workspace &operator=(const Workspace &);
+};
+
+#define WORKSPACE_H
+
+#endif
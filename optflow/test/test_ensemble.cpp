@@ -0,0 +1,237 @@
+
+#include "EnsembleImageExtrapolator.h"
+#include "InverseDenseImageExtrapolator.h"
+
+#include "CImg_config.h"
+#include <CImg.h>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <math.h>
+#include <string.h>
+#include <vector>
+#ifdef WITH_OPENMP
+#include <omp.h>
+#endif
+
+using namespace std;
+
+static const int W = 32;
+static const int H = 24;
+
+static void perturbation_(unsigned long long seed, int member, CImg< double > &P)
+{
+  InverseDenseImageExtrapolator e;
+  EnsembleImageExtrapolator::Options options;
+  options.seed = seed;
+  options.correlationLength = 4.0;
+  
+  EnsembleImageExtrapolator(e, options).generatePerturbation(W, H, member, P);
+}
+
+template < class T >
+static bool equal_(const CImg< T > &P1, const CImg< T > &P2)
+{
+  if(P1.size() != P2.size())
+    return false;
+  
+  for(size_t i = 0; i < P1.size(); i++)
+  {
+    if(P1[i] != P2[i])
+      return false;
+  }
+  
+  return true;
+}
+
+// Returns true if slice k of channel m of the ensemble E equals the image I.
+static bool sliceEquals_(const CImg< unsigned char > &E, int k, int m,
+                         const CImg< unsigned char > &I)
+{
+  return memcmp(E.data(0, 0, k, m), I.data(), (size_t)W * H) == 0;
+}
+
+static EnsembleImageExtrapolator::Options options_()
+{
+  EnsembleImageExtrapolator::Options options;
+  options.numMembers = 5;
+  options.numLeadTimes = 3;
+  options.timeStep = 0.5;
+  options.perturbationStdDev = 1.0;
+  options.correlationLength = 4.0;
+  options.seed = 11;
+  
+  return options;
+}
+
+static int testPerturbations_()
+{
+  CImg< double > P1, P2;
+  
+  // The perturbations are reproducible.
+  perturbation_(7, 3, P1);
+  perturbation_(7, 3, P2);
+  if(!equal_(P1, P2))
+  {
+    cerr << "The perturbations are not reproducible." << endl;
+    return EXIT_FAILURE;
+  }
+  
+  // Swapping the seed and the member index gives a different perturbation.
+  perturbation_(3, 7, P2);
+  if(equal_(P1, P2))
+  {
+    cerr << "Swapping the seed and the member gives the same perturbation." << endl;
+    return EXIT_FAILURE;
+  }
+  
+  // The members of an ensemble differ from each other.
+  perturbation_(7, 4, P2);
+  if(equal_(P1, P2))
+  {
+    cerr << "Different members have the same perturbation." << endl;
+    return EXIT_FAILURE;
+  }
+  
+  return EXIT_SUCCESS;
+}
+
+static int testExtrapolation_(const CImg< unsigned char > &I0, const CImg< double > &V)
+{
+  InverseDenseImageExtrapolator e;
+  EnsembleImageExtrapolator::Options options = options_();
+  const EnsembleImageExtrapolator ensemble(e, options);
+  CImg< unsigned char > E, Ie;
+  CImg< double > P;
+  
+  ensemble.extrapolate(I0, V, E);
+  if(E.width() != W || E.height() != H || E.depth() != options.numLeadTimes ||
+     E.spectrum() != options.numMembers)
+  {
+    cerr << "The ensemble is not a W x H x numLeadTimes x numMembers stack." << endl;
+    return EXIT_FAILURE;
+  }
+  
+  // Member m at lead time k is extrapolated with the motion field V+P_m, 
+  // and it is stored in slice k of channel m.
+  for(int m = 0; m < options.numMembers; m++)
+  {
+    ensemble.generatePerturbation(W, H, m, P);
+    P += V;
+    
+    for(int k = 0; k < options.numLeadTimes; k++)
+    {
+      e.extrapolate(I0, P, (k + 1) * options.timeStep, Ie);
+      if(!sliceEquals_(E, k, m, Ie))
+      {
+        cerr << "Member " << m << " at lead time " << k
+             << " is not in slice " << k << " of channel " << m << "." << endl;
+        return EXIT_FAILURE;
+      }
+    }
+  }
+
+#ifdef WITH_OPENMP
+  // The ensemble does not depend on the number of threads.
+  const int NUM_THREADS = omp_get_max_threads();
+  CImg< unsigned char > E2;
+  
+  for(int numThreads = 1; numThreads <= 4; numThreads++)
+  {
+    omp_set_num_threads(numThreads);
+    ensemble.extrapolate(I0, V, E2);
+    if(!equal_(E, E2))
+    {
+      cerr << "The ensemble differs with " << numThreads << " threads." << endl;
+      return EXIT_FAILURE;
+    }
+  }
+  omp_set_num_threads(NUM_THREADS);
+#endif
+  
+  // Without perturbations, all members equal the unperturbed extrapolation.
+  options.perturbationStdDev = 0.0;
+  EnsembleImageExtrapolator(e, options).extrapolate(I0, V, E);
+  for(int k = 0; k < options.numLeadTimes; k++)
+  {
+    e.extrapolate(I0, V, (k + 1) * options.timeStep, Ie);
+    for(int m = 0; m < options.numMembers; m++)
+    {
+      if(!sliceEquals_(E, k, m, Ie))
+      {
+        cerr << "A member without perturbations differs from the extrapolator." << endl;
+        return EXIT_FAILURE;
+      }
+    }
+  }
+  
+  return EXIT_SUCCESS;
+}
+
+static int testFileWriter_(const CImg< unsigned char > &I0, const CImg< double > &V)
+{
+  InverseDenseImageExtrapolator e;
+  const EnsembleImageExtrapolator::Options OPTIONS = options_();
+  const EnsembleImageExtrapolator ensemble(e, OPTIONS);
+  const string FILE_NAME = "test_ensemble.pgm";
+  const size_t SIZE = (size_t)W * H * OPTIONS.numLeadTimes * OPTIONS.numMembers;
+  CImg< unsigned char > E;
+  string magic, comment;
+  int width, height, maxValue;
+  
+  ensemble.extrapolate(I0, V, E);
+  ensemble.extrapolate(I0, V, FILE_NAME);
+  
+  ifstream inputStream(FILE_NAME.c_str(), ios::in | ios::binary);
+  getline(inputStream, magic);
+  getline(inputStream, comment);
+  inputStream >> width >> height >> maxValue;
+  inputStream.get();
+  
+  vector< char > data(SIZE + 1);
+  inputStream.read(&data[0], data.size());
+  const size_t NUM_READ = inputStream.gcount();
+  inputStream.close();
+  remove(FILE_NAME.c_str());
+  
+  if(magic != "P5" || width != W || height != H * OPTIONS.numLeadTimes * OPTIONS.numMembers ||
+     maxValue != 255 || NUM_READ != SIZE)
+  {
+    cerr << "The ensemble file has an invalid header or size." << endl;
+    return EXIT_FAILURE;
+  }
+  
+  // The members are written in order, each member in the order of lead 
+  // times, which is also the memory layout of the ensemble stack.
+  if(memcmp(&data[0], E.data(), SIZE) != 0)
+  {
+    cerr << "The ensemble file does not contain the members in order." << endl;
+    return EXIT_FAILURE;
+  }
+  
+  return EXIT_SUCCESS;
+}
+
+int main()
+{
+  CImg< unsigned char > I0(W, H);
+  CImg< double > V(W, H, 1, 2);
+  
+  for(int y = 0; y < H; y++)
+  {
+    for(int x = 0; x < W; x++)
+    {
+      I0(x, y) = (unsigned char)(127.5 + 127.5 * sin(0.4 * x) * cos(0.3 * y));
+      V(x, y, 0, 0) = 1.5 + 0.05 * y;
+      V(x, y, 0, 1) = -0.8 + 0.03 * x;
+    }
+  }
+  
+  if(testPerturbations_() != EXIT_SUCCESS ||
+     testExtrapolation_(I0, V) != EXIT_SUCCESS ||
+     testFileWriter_(I0, V) != EXIT_SUCCESS)
+    return EXIT_FAILURE;
+  
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,126 @@
+
+#include "ForwardDenseImageExtrapolator.h"
+
+#include "CImg_config.h"
+#include <CImg.h>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <math.h>
+#ifdef WITH_OPENMP
+#include <omp.h>
+#endif
+
+using namespace std;
+
+static const int W = 16;
+static const int H = 12;
+
+// Checks whether Ie(x+dx,y+dy) = I(x,y) for all destination pixels inside 
+// the image. The pixels not reachable from the source are not checked.
+static bool translated_(const CImg< float > &I, const CImg< float > &Ie, int dx, int dy)
+{
+  for(int y = max(dy, 0); y < H + min(dy, 0); y++)
+  {
+    for(int x = max(dx, 0); x < W + min(dx, 0); x++)
+    {
+      if(fabs(Ie(x, y) - I(x - dx, y - dy)) > 1e-3f)
+        return false;
+    }
+  }
+  
+  return true;
+}
+
+static int test_(int numThreads)
+{
+  ForwardDenseImageExtrapolator e;
+  CImg< unsigned char > I8(W, H), I8e;
+  CImg< float > I(W, H), Ie;
+  CImg< double > V(W, H, 1, 2, 0.0);
+
+#ifdef WITH_OPENMP
+  omp_set_num_threads(numThreads);
+#endif
+  
+  for(int y = 0; y < H; y++)
+  {
+    for(int x = 0; x < W; x++)
+    {
+      I(x, y) = 10.0f * x + 3.0f * y;
+      I8(x, y) = (unsigned char)(7 * x + 11 * y);
+    }
+  }
+  
+  // A zero motion field gives the identity.
+  e.extrapolate(I8, V, 1.0, I8e);
+  for(size_t i = 0; i < I8.size(); i++)
+  {
+    if(I8e[i] != I8[i])
+    {
+      cerr << "A zero motion field does not give the identity." << endl;
+      return EXIT_FAILURE;
+    }
+  }
+  
+  // A translation by (2,1) pixels. The time step scales the motion field.
+  V.get_shared_channel(0).fill(4.0);
+  V.get_shared_channel(1).fill(2.0);
+  e.extrapolate(I, V, 0.5, Ie);
+  if(!translated_(I, Ie, 2, 1))
+  {
+    cerr << "A translation does not move the image." << endl;
+    return EXIT_FAILURE;
+  }
+  
+  // The holes left by the translation are filled by the push-pull pass, 
+  // which preserves a constant image.
+  CImg< float > C(W, H, 1, 1, 50.0f), Ce;
+  e.extrapolate(C, V, 0.5, Ce);
+  for(size_t i = 0; i < Ce.size(); i++)
+  {
+    if(fabs(Ce[i] - 50.0f) > 1e-3f)
+    {
+      cerr << "A hole is not filled from the neighbouring pixels." << endl;
+      return EXIT_FAILURE;
+    }
+  }
+  
+  // Non-finite and huge vectors are not splatted, and they do not affect 
+  // the other pixels or the rows splatted by the same thread.
+  V.fill(0.0);
+  V(3, 2, 0, 0) = numeric_limits< double >::quiet_NaN();
+  V(9, 5, 0, 1) = numeric_limits< double >::quiet_NaN();
+  V(5, 7, 0, 0) = numeric_limits< double >::infinity();
+  V(12, 8, 0, 1) = -numeric_limits< double >::infinity();
+  V(7, 10, 0, 1) = 1e300;
+  e.extrapolate(I, V, 1.0, Ie);
+  for(int y = 0; y < H; y++)
+  {
+    for(int x = 0; x < W; x++)
+    {
+      const bool HOLE = (x == 3 && y == 2) || (x == 9 && y == 5) ||
+        (x == 5 && y == 7) || (x == 12 && y == 8) || (x == 7 && y == 10);
+      
+      if(!isfinite(Ie(x, y)) || (!HOLE && fabs(Ie(x, y) - I(x, y)) > 1e-3f))
+      {
+        cerr << "A non-finite vector affects the pixel (" << x << "," << y
+             << ") with " << numThreads << " threads." << endl;
+        return EXIT_FAILURE;
+      }
+    }
+  }
+  
+  return EXIT_SUCCESS;
+}
+
+int main()
+{
+  for(int numThreads = 1; numThreads <= 4; numThreads++)
+  {
+    if(test_(numThreads) != EXIT_SUCCESS)
+      return EXIT_FAILURE;
+  }
+  
+  return EXIT_SUCCESS;
+}
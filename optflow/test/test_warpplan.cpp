@@ -0,0 +1,56 @@
+
+#include "WarpPlan.h"
+
+#include "CImg_config.h"
+#include <CImg.h>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+
+using namespace std;
+
+int main()
+{
+  const int W = 8;
+  const int H = 6;
+  CImg< double > V(W, H, 1, 2, 0.0);
+  CImg< float > I(W, H, 1, 1), Ie;
+  
+  for(size_t i = 0; i < I.size(); i++)
+    I[i] = i;
+  
+  // NaN components are mapped to the first column or row like those 
+  // pointing beyond the upper-left corner, and infinite components are 
+  // clamped to the image.
+  V(2, 1, 0, 0) = numeric_limits< double >::quiet_NaN();
+  V(5, 3, 0, 1) = numeric_limits< double >::quiet_NaN();
+  V(6, 4, 0, 0) = numeric_limits< double >::infinity();
+  V(1, 4, 0, 0) = -numeric_limits< double >::infinity();
+  V(1, 4, 0, 1) = -numeric_limits< double >::infinity();
+  
+  WarpPlan plan(V, 1.0);
+  plan.apply(I, Ie);
+  
+  if(Ie(2, 1) != I(0, 1))
+  {
+    cerr << "A NaN u-component is not mapped to the first column." << endl;
+    return EXIT_FAILURE;
+  }
+  if(Ie(5, 3) != I(5, 0))
+  {
+    cerr << "A NaN v-component is not mapped to the first row." << endl;
+    return EXIT_FAILURE;
+  }
+  if(Ie(6, 4) != I(W - 1, 4))
+  {
+    cerr << "An infinite vector is not clamped to the last column." << endl;
+    return EXIT_FAILURE;
+  }
+  if(Ie(1, 4) != I(0, 0))
+  {
+    cerr << "A negative infinite vector is not clamped to the first pixel." << endl;
+    return EXIT_FAILURE;
+  }
+  
+  return EXIT_SUCCESS;
+}
@@ -3,9 +3,13 @@
 #include "CImg_config.h"
 #include <CImg.h>
 #include <numpy/ndarrayobject.h>
+#include "DenseImageMorpher.h"
+#include "IntensityTransform.h"
+#include "InverseDenseImageExtrapolator.h"
 #include "PyramidalHornSchunck.h"
 #include "PyramidalLucasKanade.h"
 #include "PyramidalProesmans.h"
+#include "SemiLagrangianDenseImageExtrapolator.h"
 #include "utils.hpp"
 
 #ifdef WITH_BROX
@@ -37,12 +41,20 @@ CImg< double > extract_motion_hornschunck(const CImg< unsigned char > &I1,
                                           int num_iter, 
                                           float alpha, 
                                           float relaxcoeff, 
-                                          int num_levels)
+                                          int num_levels, 
+                                          const object &mask, 
+                                          int mask_dilation)
 {
   PyramidalHornSchunck me(num_iter, alpha, relaxcoeff, num_levels, 
 			  HornSchunck::NEUMANN);
   CImg< double > V;
-  me.compute(I1, I2, V);
+  if(mask.is_none())
+    me.compute(I1, I2, V);
+  else
+  {
+    me.setMaskDilationRadius(mask_dilation);
+    me.compute(I1, I2, extract< CImg< unsigned char > >(mask)(), V);
+  }
   
   return V;
 }
@@ -54,12 +66,20 @@ CImg< double > extract_motion_lucaskanade(const CImg< unsigned char > &I1,
                                           float tau, 
                                           float sigmap, 
                                           int num_levels, 
-                                          bool use_weights)
+                                          bool use_weights, 
+                                          const object &mask, 
+                                          int mask_dilation)
 {
   PyramidalLucasKanade me(window_radius, num_iter, tau, sigmap, num_levels, 
                           use_weights);
   CImg< double > V;
-  me.compute(I1, I2, V);
+  if(mask.is_none())
+    me.compute(I1, I2, V);
+  else
+  {
+    me.setMaskDilationRadius(mask_dilation);
+    me.compute(I1, I2, extract< CImg< unsigned char > >(mask)(), V);
+  }
   
   return V;
 }
@@ -68,15 +88,260 @@ boost::python::tuple extract_motion_proesmans(const CImg< unsigned char > &I1,
                                               const CImg< unsigned char > &I2, 
                                               float lam, 
                                               int num_iter, 
-                                              int num_levels)
+                                              int num_levels, 
+                                              const object &mask, 
+                                              int mask_dilation)
 {
   PyramidalProesmans me(num_iter, lam, num_levels, Proesmans::NEUMANN);
   CImg< double > VF, VB;
-  me.compute(I1, I2, VF, VB);
+  if(mask.is_none())
+    me.compute(I1, I2, VF, VB);
+  else
+  {
+    me.setMaskDilationRadius(mask_dilation);
+    me.compute(I1, I2, extract< CImg< unsigned char > >(mask)(), VF, VB);
+  }
   
   return boost::python::make_tuple(VF, VB);
 }
 
+// Constructs the intensity transform from the keyword arguments. The 
+// default rmin_value is that of pyoptflow.utils.rainfall_to_ubyte, i.e. 
+// min_value-(max_value-min_value). It is nonpositive for typical rain rates, 
+// so min_value is used as the default with the logarithmic transform.
+static IntensityTransform make_transform(double min_value, 
+                                         double max_value, 
+                                         const object &rmin_value, 
+                                         bool log_transform)
+{
+  double rmin;
+  
+  if(!rmin_value.is_none())
+    rmin = extract< double >(rmin_value)();
+  else if(log_transform)
+    rmin = min_value;
+  else
+    rmin = min_value - (max_value - min_value);
+  
+  return IntensityTransform(min_value, max_value, rmin, log_transform);
+}
+
+// Applies the intensity transform used by the motion extraction functions 
+// to a 16-bit or floating-point image. Without the logarithmic transform, 
+// the result multiplied by 255 and truncated is equal to the output of 
+// pyoptflow.utils.rainfall_to_ubyte.
+template < class T >
+CImg< double > transform_intensity(const CImg< T > &I, 
+                                   double min_value, 
+                                   double max_value, 
+                                   const object &rmin_value, 
+                                   bool log_transform)
+{
+  const IntensityTransform TRANSFORM = 
+    make_transform(min_value, max_value, rmin_value, log_transform);
+  CImg< double > R(I.width(), I.height(), I.depth(), I.spectrum());
+  
+  for(size_t i = 0; i < I.size(); i++)
+    R[i] = TRANSFORM.apply(I[i]);
+  
+  return R;
+}
+
+// Computes motion from 16-bit or floating-point images. The thresholding 
+// and scaling of pyoptflow.utils.rainfall_to_ubyte (without quantization) 
+// and the Gaussian filter are applied when the image pyramids are built.
+template < class T >
+static void compute_transformed(PyramidalDenseMotionExtractor &me, 
+                                const CImg< T > &I1, 
+                                const CImg< T > &I2, 
+                                const object &mask, 
+                                int mask_dilation, 
+                                double min_value, 
+                                double max_value, 
+                                const object &rmin_value, 
+                                bool log_transform, 
+                                double filter_stddev, 
+                                CImg< double > &VF, 
+                                CImg< double > &VB)
+{
+  IntensityTransform transform = 
+    make_transform(min_value, max_value, rmin_value, log_transform);
+  transform.setFilterStdDev(filter_stddev);
+  
+  if(mask.is_none())
+    me.compute(I1, I2, transform, VF, VB);
+  else
+  {
+    CImg< unsigned char > M = extract< CImg< unsigned char > >(mask)();
+    me.setMaskDilationRadius(mask_dilation);
+    me.compute(I1, I2, transform, VF, VB, &M);
+  }
+}
+
+template < class T >
+CImg< double > extract_motion_hornschunck_t(const CImg< T > &I1, 
+                                            const CImg< T > &I2, 
+                                            int num_iter, 
+                                            float alpha, 
+                                            float relaxcoeff, 
+                                            int num_levels, 
+                                            const object &mask, 
+                                            int mask_dilation, 
+                                            double min_value, 
+                                            double max_value, 
+                                            const object &rmin_value, 
+                                            bool log_transform, 
+                                            double filter_stddev)
+{
+  PyramidalHornSchunck me(num_iter, alpha, relaxcoeff, num_levels, 
+                          HornSchunck::NEUMANN);
+  CImg< double > V, VB;
+  compute_transformed(me, I1, I2, mask, mask_dilation, min_value, max_value, 
+                      rmin_value, log_transform, filter_stddev, V, VB);
+  
+  return V;
+}
+
+template < class T >
+CImg< double > extract_motion_lucaskanade_t(const CImg< T > &I1, 
+                                            const CImg< T > &I2, 
+                                            int window_radius, 
+                                            int num_iter, 
+                                            float tau, 
+                                            float sigmap, 
+                                            int num_levels, 
+                                            bool use_weights, 
+                                            const object &mask, 
+                                            int mask_dilation, 
+                                            double min_value, 
+                                            double max_value, 
+                                            const object &rmin_value, 
+                                            bool log_transform, 
+                                            double filter_stddev)
+{
+  PyramidalLucasKanade me(window_radius, num_iter, tau, sigmap, num_levels, 
+                          use_weights);
+  CImg< double > V, VB;
+  compute_transformed(me, I1, I2, mask, mask_dilation, min_value, max_value, 
+                      rmin_value, log_transform, filter_stddev, V, VB);
+  
+  return V;
+}
+
+template < class T >
+boost::python::tuple extract_motion_proesmans_t(const CImg< T > &I1, 
+                                                const CImg< T > &I2, 
+                                                float lam, 
+                                                int num_iter, 
+                                                int num_levels, 
+                                                const object &mask, 
+                                                int mask_dilation, 
+                                                double min_value, 
+                                                double max_value, 
+                                                const object &rmin_value, 
+                                                bool log_transform, 
+                                                double filter_stddev)
+{
+  PyramidalProesmans me(num_iter, lam, num_levels, Proesmans::NEUMANN);
+  CImg< double > VF, VB;
+  compute_transformed(me, I1, I2, mask, mask_dilation, min_value, max_value, 
+                      rmin_value, log_transform, filter_stddev, VF, VB);
+  
+  return boost::python::make_tuple(VF, VB);
+}
+
+// Extrapolates a floating-point image to multiple lead times by using the 
+// semi-Lagrangian scheme. The lead times are returned in the last dimension 
+// of the array.
+template < class T >
+CImg< double > extrapolate_semilagrangian(const CImg< T > &I, 
+                                          const CImg< double > &V, 
+                                          double t, 
+                                          int n_steps, 
+                                          int n_iter, 
+                                          bool inverse, 
+                                          int n_leadtimes)
+{
+  SemiLagrangianDenseImageExtrapolator e(n_steps, n_iter, inverse);
+  CImg< float > Ie;
+  e.extrapolate(CImg< float >(I), V, t, n_leadtimes, Ie);
+  
+  CImg< double > R(Ie.width(), Ie.height(), 1, n_leadtimes);
+  for(int k = 0; k < n_leadtimes; k++)
+  {
+    const float *src = Ie.data(0, 0, k);
+    double *dest = R.data(0, 0, 0, k);
+    for(int i = 0; i < Ie.width() * Ie.height(); i++)
+      dest[i] = src[i];
+  }
+  
+  return R;
+}
+
+template < class T >
+boost::python::tuple extrapolate_inverse(const CImg< T > &I, 
+                                         const CImg< double > &V, 
+                                         double t, 
+                                         const std::string &interpolation, 
+                                         const std::string &out_of_domain, 
+                                         float fill_value)
+{
+  InverseDenseImageExtrapolator e(ImageWarp::parseInterpolation(interpolation), 
+                                  ImageWarp::parseOutOfDomain(out_of_domain), 
+                                  fill_value);
+  CImg< float > Ie;
+  CImg< unsigned char > M;
+  e.extrapolate(CImg< float >(I), V, t, Ie, M);
+  
+  return boost::python::make_tuple(CImg< double >(Ie), CImg< double >(M));
+}
+
+template < class T >
+CImg< double > morph(const CImg< T > &I1, 
+                     const CImg< T > &I2, 
+                     const CImg< double > &V1, 
+                     const CImg< double > &V2, 
+                     double t, 
+                     const std::string &interpolation)
+{
+  CImg< float > M;
+  DenseImageMorpher::morph(CImg< float >(I1), CImg< float >(I2), V1, V2, t, M, 
+                           ImageWarp::parseInterpolation(interpolation));
+  
+  return CImg< double >(M);
+}
+
+// Computes n intermediate images at t=1/(n+1),...,n/(n+1) between two 
+// floating-point images. The frames are returned in the last dimension of 
+// the array.
+template < class T >
+CImg< double > interpolate(const CImg< T > &I1,
+                           const CImg< T > &I2,
+                           const CImg< double > &V1,
+                           const CImg< double > &V2,
+                           int n,
+                           const std::string &interpolation,
+                           const std::string &out_of_domain,
+                           float fill_value)
+{
+  CImg< float > M;
+  DenseImageMorpher::interpolate(CImg< float >(I1), CImg< float >(I2), V1, V2, n, M,
+                                 ImageWarp::parseInterpolation(interpolation),
+                                 ImageWarp::parseOutOfDomain(out_of_domain),
+                                 fill_value);
+  
+  CImg< double > R(M.width(), M.height(), 1, n);
+  for(int k = 0; k < n; k++)
+  {
+    const float *src = M.data(0, 0, k);
+    double *dest = R.data(0, 0, 0, k);
+    for(int i = 0; i < M.width() * M.height(); i++)
+      dest[i] = src[i];
+  }
+  
+  return R;
+}
+
 #ifdef WITH_BROX
 CImg< double > extract_motion_brox(const CImg< unsigned char > &I1, 
                                    const CImg< unsigned char > &I2, 
@@ -290,13 +555,18 @@ BOOST_PYTHON_MODULE(core)
   numeric::array::set_module_and_type("numpy", "ndarray");
   to_python_converter< CImg< double >, CImg_to_ndarray >();
   import_array();
-  ndarray_to_CImg();
+  ndarray_to_CImg< unsigned char >();
+  ndarray_to_CImg< unsigned short >();
+  ndarray_to_CImg< float >();
+  ndarray_to_CImg< double >();
   
   def("extract_motion_hornschunck", &extract_motion_hornschunck, 
       (boost::python::arg("num_iter")=500, 
        boost::python::arg("alpha")=0.7, 
        boost::python::arg("relaxcoeff")=1.9, 
-       boost::python::arg("num_levels")=4));
+       boost::python::arg("num_levels")=4, 
+       boost::python::arg("mask")=object(), 
+       boost::python::arg("mask_dilation")=8));
   
   def("extract_motion_lucaskanade", &extract_motion_lucaskanade, 
       (boost::python::arg("window_radius")=16, 
@@ -304,12 +574,145 @@ BOOST_PYTHON_MODULE(core)
        boost::python::arg("tau")=0.0025f, 
        boost::python::arg("sigmap")=0.0f, 
        boost::python::arg("num_levels")=4, 
-       boost::python::arg("use_weights")=false));
+       boost::python::arg("use_weights")=false, 
+       boost::python::arg("mask")=object(), 
+       boost::python::arg("mask_dilation")=8));
   
   def("extract_motion_proesmans", &extract_motion_proesmans, 
       (boost::python::arg("lam")=100.0f, 
        boost::python::arg("num_iter")=200, 
-       boost::python::arg("num_levels")=4));
+       boost::python::arg("num_levels")=4, 
+       boost::python::arg("mask")=object(), 
+       boost::python::arg("mask_dilation")=8));
+  
+  // Overloads for 16-bit and floating-point (float32) input arrays. The 
+  // 8-bit versions above are used for uint8 arrays.
+  def("extract_motion_hornschunck", &extract_motion_hornschunck_t< unsigned short >, 
+      (boost::python::arg("num_iter")=500, 
+       boost::python::arg("alpha")=0.7, 
+       boost::python::arg("relaxcoeff")=1.9, 
+       boost::python::arg("num_levels")=4, 
+       boost::python::arg("mask")=object(), 
+       boost::python::arg("mask_dilation")=8, 
+       boost::python::arg("min_value")=0.1, 
+       boost::python::arg("max_value")=40.0, 
+       boost::python::arg("rmin_value")=object(), 
+       boost::python::arg("log_transform")=false, 
+       boost::python::arg("filter_stddev")=0.0));
+  def("extract_motion_hornschunck", &extract_motion_hornschunck_t< float >, 
+      (boost::python::arg("num_iter")=500, 
+       boost::python::arg("alpha")=0.7, 
+       boost::python::arg("relaxcoeff")=1.9, 
+       boost::python::arg("num_levels")=4, 
+       boost::python::arg("mask")=object(), 
+       boost::python::arg("mask_dilation")=8, 
+       boost::python::arg("min_value")=0.1, 
+       boost::python::arg("max_value")=40.0, 
+       boost::python::arg("rmin_value")=object(), 
+       boost::python::arg("log_transform")=false, 
+       boost::python::arg("filter_stddev")=0.0));
+  
+  def("extract_motion_lucaskanade", &extract_motion_lucaskanade_t< unsigned short >, 
+      (boost::python::arg("window_radius")=16, 
+       boost::python::arg("num_iter")=5, 
+       boost::python::arg("tau")=0.0025f, 
+       boost::python::arg("sigmap")=0.0f, 
+       boost::python::arg("num_levels")=4, 
+       boost::python::arg("use_weights")=false, 
+       boost::python::arg("mask")=object(), 
+       boost::python::arg("mask_dilation")=8, 
+       boost::python::arg("min_value")=0.1, 
+       boost::python::arg("max_value")=40.0, 
+       boost::python::arg("rmin_value")=object(), 
+       boost::python::arg("log_transform")=false, 
+       boost::python::arg("filter_stddev")=0.0));
+  def("extract_motion_lucaskanade", &extract_motion_lucaskanade_t< float >, 
+      (boost::python::arg("window_radius")=16, 
+       boost::python::arg("num_iter")=5, 
+       boost::python::arg("tau")=0.0025f, 
+       boost::python::arg("sigmap")=0.0f, 
+       boost::python::arg("num_levels")=4, 
+       boost::python::arg("use_weights")=false, 
+       boost::python::arg("mask")=object(), 
+       boost::python::arg("mask_dilation")=8, 
+       boost::python::arg("min_value")=0.1, 
+       boost::python::arg("max_value")=40.0, 
+       boost::python::arg("rmin_value")=object(), 
+       boost::python::arg("log_transform")=false, 
+       boost::python::arg("filter_stddev")=0.0));
+  
+  def("extract_motion_proesmans", &extract_motion_proesmans_t< unsigned short >, 
+      (boost::python::arg("lam")=100.0f, 
+       boost::python::arg("num_iter")=200, 
+       boost::python::arg("num_levels")=4, 
+       boost::python::arg("mask")=object(), 
+       boost::python::arg("mask_dilation")=8, 
+       boost::python::arg("min_value")=0.1, 
+       boost::python::arg("max_value")=40.0, 
+       boost::python::arg("rmin_value")=object(), 
+       boost::python::arg("log_transform")=false, 
+       boost::python::arg("filter_stddev")=0.0));
+  def("extract_motion_proesmans", &extract_motion_proesmans_t< float >, 
+      (boost::python::arg("lam")=100.0f, 
+       boost::python::arg("num_iter")=200, 
+       boost::python::arg("num_levels")=4, 
+       boost::python::arg("mask")=object(), 
+       boost::python::arg("mask_dilation")=8, 
+       boost::python::arg("min_value")=0.1, 
+       boost::python::arg("max_value")=40.0, 
+       boost::python::arg("rmin_value")=object(), 
+       boost::python::arg("log_transform")=false, 
+       boost::python::arg("filter_stddev")=0.0));
+  
+  // uint16 and float32 input images
+  def("transform_intensity", &transform_intensity< unsigned short >, 
+      (boost::python::arg("min_value")=0.1, 
+       boost::python::arg("max_value")=40.0, 
+       boost::python::arg("rmin_value")=object(), 
+       boost::python::arg("log_transform")=false));
+  def("transform_intensity", &transform_intensity< float >, 
+      (boost::python::arg("min_value")=0.1, 
+       boost::python::arg("max_value")=40.0, 
+       boost::python::arg("rmin_value")=object(), 
+       boost::python::arg("log_transform")=false));
+  
+  // float32 and float64 input images
+  def("extrapolate_semilagrangian", &extrapolate_semilagrangian< float >, 
+      (boost::python::arg("n_steps")=1, 
+       boost::python::arg("n_iter")=3, 
+       boost::python::arg("inverse")=true, 
+       boost::python::arg("n_leadtimes")=1));
+  def("extrapolate_semilagrangian", &extrapolate_semilagrangian< double >, 
+      (boost::python::arg("n_steps")=1, 
+       boost::python::arg("n_iter")=3, 
+       boost::python::arg("inverse")=true, 
+       boost::python::arg("n_leadtimes")=1));
+  
+  // float32 and float64 input images
+  def("extrapolate_inverse", &extrapolate_inverse< float >, 
+      (boost::python::arg("interpolation")="bilinear", 
+       boost::python::arg("out_of_domain")="nan", 
+       boost::python::arg("fill_value")=0.0f));
+  def("extrapolate_inverse", &extrapolate_inverse< double >, 
+      (boost::python::arg("interpolation")="bilinear", 
+       boost::python::arg("out_of_domain")="nan", 
+       boost::python::arg("fill_value")=0.0f));
+  
+  // float32 and float64 input images
+  def("morph", &morph< float >, 
+      (boost::python::arg("interpolation")="bilinear"));
+  def("morph", &morph< double >, 
+      (boost::python::arg("interpolation")="bilinear"));
+  
+  // float32 and float64 input images
+  def("interpolate", &interpolate< float >,
+      (boost::python::arg("interpolation")="bilinear", 
+       boost::python::arg("out_of_domain")="nan", 
+       boost::python::arg("fill_value")=0.0f));
+  def("interpolate", &interpolate< double >,
+      (boost::python::arg("interpolation")="bilinear", 
+       boost::python::arg("out_of_domain")="nan", 
+       boost::python::arg("fill_value")=0.0f));
   
   #ifdef WITH_BROX
   def("extract_motion_brox", &extract_motion_brox, 
@@ -27,20 +27,35 @@ namespace utils
     }
   };
   
+  // numpy type characters of the supported pixel types
+  template < class T > struct ndarray_type;
+  template <> struct ndarray_type< unsigned char >  { static char type() { return 'B'; } };
+  template <> struct ndarray_type< unsigned short > { static char type() { return 'H'; } };
+  template <> struct ndarray_type< float >          { static char type() { return 'f'; } };
+  template <> struct ndarray_type< double >         { static char type() { return 'd'; } };
+  
+  template < class T >
   struct ndarray_to_CImg
   {
     ndarray_to_CImg()
     {
       boost::python::converter::registry::push_back(&convertible, &construct, 
-        boost::python::type_id< CImg< unsigned char > >());
+        boost::python::type_id< CImg< T > >());
     }
     
     static void *convertible(PyObject *obj_ptr)
     {
       if(!PyArray_Check(obj_ptr))
         return NULL;
-      PyArray_Descr *dtype = PyArray_DESCR((PyArrayObject *)obj_ptr);
-      if(dtype->type != 'B' || dtype->kind != 'u')
+      PyArrayObject *array = (PyArrayObject *)obj_ptr;
+      PyArray_Descr *dtype = PyArray_DESCR(array);
+      if(dtype->type != ndarray_type< T >::type())
+        return NULL;
+      if(PyArray_NDIM(array) < 2 || PyArray_NDIM(array) > 3)
+        return NULL;
+      // the elements are read in place, so they must be aligned and in 
+      // native byte order
+      if(!PyArray_ISALIGNED(array) || !PyArray_ISNOTSWAPPED(array))
         return NULL;
       
       return obj_ptr;
@@ -51,17 +66,26 @@ namespace utils
     {
       const int m = PyArray_DIM(obj_ptr, 0);
       const int n = PyArray_DIM(obj_ptr, 1);
+      // the third dimension of an array (e.g. a motion field) is mapped to 
+      // the channels of the image
+      const int d = PyArray_NDIM(obj_ptr) > 2 ? PyArray_DIM(obj_ptr, 2) : 1;
       
       void *storage = (
-        (boost::python::converter::rvalue_from_python_storage< CImg< unsigned char > > *)
+        (boost::python::converter::rvalue_from_python_storage< CImg< T > > *)
         data)->storage.bytes;
-      new (storage) CImg< unsigned char >(n, m);
-      CImg< unsigned char > *I = (CImg< unsigned char > *)storage;
-      unsigned char *array_data = (unsigned char *)PyArray_DATA(obj_ptr);
+      new (storage) CImg< T >(n, m, 1, d);
+      CImg< T > *I = (CImg< T > *)storage;
+      // the array is indexed through its strides, so it need not be 
+      // C-contiguous (e.g. a transposed array or a slice)
+      const char *array_data = (const char *)PyArray_DATA(obj_ptr);
+      const npy_intp *strides = PyArray_STRIDES((PyArrayObject *)obj_ptr);
+      const npy_intp cs = d > 1 ? strides[2] : 0;
       
       for(int i = 0; i < m; i++)
         for(int j = 0; j < n; j++)
-          (*I)(j, i) = array_data[j + i*n];
+          for(int c = 0; c < d; c++)
+            (*I)(j, i, 0, c) = 
+              *(const T *)(array_data + i*strides[0] + j*strides[1] + c*cs);
       data->convertible = storage;
     }
   };
@@ -3,7 +3,6 @@
 from numpy import arange, dstack, meshgrid, nan, reshape, size, zeros
 from scipy.ndimage.interpolation import map_coordinates
 
-# TODO: Allow the user to compute the extrapolated field for multiple time steps at once.
 def semilagrangian(I, V, t, n_steps, n_iter=3, inverse=True):
   """Apply semi-Lagrangian extrapolation to an image by using a motion field. 
   In this scheme, the extrapolation is done in a by integrating the motion 
@@ -34,6 +33,13 @@ def semilagrangian(I, V, t, n_steps, n_iter=3, inverse=True):
   -------
   out : ndarray
     The extrapolated image at time t.
+  
+  See also
+  --------
+  pyoptflow.core.extrapolate_semilagrangian, which implements the same scheme 
+  in C++ and computes multiple time steps t, 2t, ..., n_leadtimes*t from a 
+  single integration of the trajectories. The n_steps argument of that 
+  function is the number of integration steps per time step.
   """
   if len(I.shape) != 2:
     raise ValueError("I must be a two-dimensional array")
@@ -1,7 +1,7 @@
 """Methods for motion-based temporal interpolation between two input images."""
 
-from numpy import arange, dstack, meshgrid, nan, reshape, size
-from scipy.ndimage.interpolation import map_coordinates
+from numpy import ascontiguousarray, float64
+from pyoptflow import core
 
 def interpolate(I1, I2, VF, n, VB=None):
   """Interpolate n frames between two images by using forward and backward 
@@ -26,7 +26,15 @@ def interpolate(I1, I2, VF, n, VB=None):
   -------
   out : list
     List of length n containing the interpolated frames between the images. 
-    The input images are not included in the list.
+    The input images are not included in the list. The pixels whose motion 
+    vectors point outside either image are set to NaN. The frames are 
+    computed in single precision (float32) and returned as float64 arrays, 
+    so they have a relative precision of about 1e-7.
+  
+  See also
+  --------
+  pyoptflow.core.interpolate, which computes all frames in parallel in C++ 
+  and also supports bicubic and Lanczos interpolation.
   """
   if len(I1.shape) != 2:
     raise ValueError("I1 and I2 must be two-dimensional arrays")
@@ -36,25 +44,20 @@ def interpolate(I1, I2, VF, n, VB=None):
      (VB is not None and (VB.shape[0:2] != I1.shape or VB.shape[0:2] != I2.shape)):
     raise ValueError("V must have the same shape as I1 and I2")
   
+  # No frames are interpolated (as in the NumPy implementation).
+  if n <= 0:
+    return []
+  
   if VB is None:
     VB = -VF
   
-  X,Y = meshgrid(arange(size(I1, 1)), arange(size(I1, 0)))
-  XY = dstack([X, Y])
-  
-  tws = 1.0*arange(1, n+1) / (n + 1)
-  
-  I_result = []
-  for tw in tws:
-    XYW = XY + tw*VB[:,:,0:2]
-    XYW = [XYW[:, :, 1], XYW[:, :, 0]]
-    I1_warped = reshape(map_coordinates(I1, XYW, order=1, mode="constant", 
-                        cval=nan), I1.shape)
-    XYW = XY + (1.0-tw)*VF[:,:,0:2]
-    XYW = [XYW[:, :, 1], XYW[:, :, 0]]
-    I2_warped = reshape(map_coordinates(I2, XYW, order=1, mode="constant", 
-                        cval=nan), I2.shape)
-    
-    I_result.append((1.0-tw)*I1_warped + tw*I2_warped)
-  
-  return I_result
+  # The C++ implementation samples I1 at x+t*VB and I2 at x+(1-t)*VF, and 
+  # the pixels sampled outside either image are set to NaN.
+  I1 = ascontiguousarray(I1, dtype=float64)
+  I2 = ascontiguousarray(I2, dtype=float64)
+  VB = ascontiguousarray(VB[:, :, 0:2], dtype=float64)
+  VF = ascontiguousarray(VF[:, :, 0:2], dtype=float64)
+  
+  I_result = core.interpolate(I1, I2, VB, VF, n, out_of_domain="nan")
+  
+  return [I_result[:, :, i] for i in range(n)]
@@ -0,0 +1,46 @@
+# A test script for checking that the C++ implementation of semi-Lagrangian 
+# extrapolation (core.extrapolate_semilagrangian) gives the same results as 
+# the Python implementation (extrapolation.semilagrangian).
+
+from numpy import abs, allclose, array_equal, asfortranarray, isfinite, mean
+import h5py
+from pyoptflow import utils
+from pyoptflow.core import extract_motion_proesmans, extrapolate_semilagrangian
+from pyoptflow.extrapolation import semilagrangian
+
+# Read precipitation fields from HDF5 files (in the ODIM format).
+I1 = h5py.File("precipfield1.h5", 'r')["dataset1"]["data1"]["data"][...]
+I2 = h5py.File("precipfield2.h5", 'r')["dataset1"]["data1"]["data"][...]
+
+I1_ubyte = utils.rainfall_to_ubyte(I1, R_min=0.05, R_max=10.0, filter_stddev=3.0)
+I2_ubyte = utils.rainfall_to_ubyte(I2, R_min=0.05, R_max=10.0, filter_stddev=3.0)
+
+V = extract_motion_proesmans(I1_ubyte, I2_ubyte, lam=25.0, num_iter=250, 
+                             num_levels=6)[0]
+
+# The n_steps argument of the C++ version is the number of integration steps 
+# per time step, so three steps correspond to 3*t steps in the Python version.
+I_extrap = extrapolate_semilagrangian(I1, V, 1.0, n_steps=3, n_iter=3, 
+                                      inverse=True, n_leadtimes=5)
+
+for t in range(1, 6):
+  I_py = semilagrangian(I1, V, t, 3*t, n_iter=3, inverse=True)
+  I_cpp = I_extrap[:, :, t-1]
+  
+  # The trajectories are computed in single precision in C++, so pixels very 
+  # close to the image boundary may be classified differently.
+  MASK = isfinite(I_py) & isfinite(I_cpp)
+  assert mean(isfinite(I_py) != isfinite(I_cpp)) < 1e-3, \
+    "the out-of-domain pixels differ at t=%d" % t
+  assert allclose(I_cpp[MASK], I_py[MASK], rtol=1e-4, atol=1e-3), \
+    "the extrapolated images differ by %f at t=%d" % \
+    (abs(I_cpp[MASK] - I_py[MASK]).max(), t)
+
+# Arrays that are not C-contiguous are indexed through their strides.
+I_extrap_f = extrapolate_semilagrangian(asfortranarray(I1), asfortranarray(V), 
+                                        1.0, n_steps=3, n_iter=3, 
+                                        inverse=True, n_leadtimes=5)
+assert array_equal(isfinite(I_extrap_f), isfinite(I_extrap))
+assert array_equal(I_extrap_f[isfinite(I_extrap)], I_extrap[isfinite(I_extrap)])
+
+print("The C++ and Python extrapolations are equal within the tolerance.")
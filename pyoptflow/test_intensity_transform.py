@@ -0,0 +1,27 @@
+# A test script for checking that the intensity transform applied by the C++ 
+# library to floating-point images is the same as utils.rainfall_to_ubyte.
+
+from numpy import abs, all, array, float32, isfinite, nan
+import h5py
+from pyoptflow import utils
+from pyoptflow.core import transform_intensity
+
+# Read a precipitation field from a HDF5 file (in the ODIM format), and add 
+# missing values and values below and above the thresholds.
+R = h5py.File("precipfield1.h5", 'r')["dataset1"]["data1"]["data"][...]
+R = R.astype(float32)
+R[0, 0:4] = array([nan, -1.0, 0.0, 1000.0])
+
+for R_min, R_max, R_rmin in [(0.1, 40.0, None), (0.05, 10.0, 0.0)]:
+  U = utils.rainfall_to_ubyte(R, R_min=R_min, R_max=R_max, R_rmin=R_rmin)
+  T = transform_intensity(R, min_value=R_min, max_value=R_max, 
+                          rmin_value=R_rmin)[:, :, 0]
+  
+  # rainfall_to_ubyte truncates the scaled values, and the C++ transform is 
+  # computed in single precision.
+  D = T * 255.0 - U
+  assert all(isfinite(T))
+  assert all(D > -1e-3) and all(D < 1.0 + 1e-3), \
+    "the transforms differ by %f" % abs(D).max()
+
+print("The intensity transforms are equal.")